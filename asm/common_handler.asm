@@ -4,6 +4,7 @@ section .text
 
 extern _ZN16InterruptManager15handleInterruptEhj
 extern _ZN16InterruptManager15handleExceptionEhj
+extern _ZN14SyscallHandler14HandleSysenterEj
 
 ;----------------------------------------
 ; Macro for exceptions without error code
@@ -81,6 +82,7 @@ HandleInterruptRequest 0x0C
 HandleInterruptRequest 0x0D
 HandleInterruptRequest 0x0E
 HandleInterruptRequest 0x0F
+HandleInterruptRequest 0x10     ; Kernel yield (int 0x30)
 HandleInterruptRequest 0x31
 
 HandleInterruptRequest 0x80
@@ -176,6 +178,62 @@ exc_common_handler:
     iret
 
 
+;------------------------
+; SYSENTER system call entry
+;------------------------
+; IA32_SYSENTER_ESP points at g_tss.esp0, so the first load puts us on the
+; current thread's kernel stack. User space passes its ESP in EBP and the
+; return address in EDI, EAX-ESI carry the usual int 0x80 arguments.
+; The frame is the same CPUState the interrupt path builds.
+; SYSEXIT needs ECX/EDX, so the extra results (EDX/ECX in the frame) go
+; back in EBX/ESI instead.
+global sysenter_entry
+sysenter_entry:
+    mov esp, [esp]
+
+    ; Return state (only used if the thread never goes back to user space)
+    push dword 0x23         ; SS  (user data)
+    push ebp                ; ESP
+    push dword 0x202        ; EFLAGS
+    push dword 0x1B         ; CS  (user code)
+    push edi                ; EIP
+    push dword 0            ; Error code
+
+    push gs
+    push fs
+    push es
+    push ds
+
+    push ebp
+    push edi
+    push esi
+    push edx
+    push ecx
+    push ebx
+    push eax
+
+    push esp                ; Pass pointer to CPUState
+    call _ZN14SyscallHandler14HandleSysenterEj
+    add esp, 4
+
+    mov eax, [esp]          ; Result
+    mov ebx, [esp + 12]     ; Extra result 0 (EDX slot)
+    mov esi, [esp + 8]      ; Extra result 1 (ECX slot)
+    mov ebp, [esp + 24]
+    mov edx, [esp + 48]     ; SYSEXIT: EIP = EDX
+    mov ecx, [esp + 60]     ; SYSEXIT: ESP = ECX
+    add esp, 28             ; General purpose registers
+
+    pop ds
+    pop es
+    pop fs
+    pop gs
+
+    add esp, 24             ; Error code and return state
+    sti                     ; Takes effect after SYSEXIT
+    sysexit
+
+
 global _ZN16InterruptManager22IgnoreInterruptRequestEv
 _ZN16InterruptManager22IgnoreInterruptRequestEv:
     iret
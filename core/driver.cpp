@@ -68,6 +68,21 @@ DriverManager::DriverManager() {
     EXPORT_SYMBOL_ASM("_ZN41PeripheralComponentInterconnectController5WriteEtttjj");
     EXPORT_SYMBOL_ASM(
         "_ZN41PeripheralComponentInterconnectController22GetBaseAddressRegisterEtttt");
+    EXPORT_SYMBOL_ASM("_ZN41PeripheralComponentInterconnectController15FindClassDeviceEhh");
+
+    // Export sync primitives
+    EXPORT_SYMBOL_ASM("_ZN9WaitQueue7WakeAllEv");
+    EXPORT_SYMBOL_ASM("_ZN9Semaphore4WaitEj");
+    EXPORT_SYMBOL_ASM("_ZN9Semaphore7TryWaitEv");
+    EXPORT_SYMBOL_ASM("_ZN9Semaphore6SignalEv");
+    EXPORT_SYMBOL_ASM("_ZN5Mutex4LockEv");
+    EXPORT_SYMBOL_ASM("_ZN5Mutex6UnlockEv");
+
+    // Export DMA memory helpers
+    EXPORT_SYMBOL_ASM("_Z19pmm_alloc_block_lowj");
+    EXPORT_SYMBOL_ASM("_Z20pmm_alloc_blocks_lowjj");
+    EXPORT_SYMBOL_ASM("_ZN6Paging18GetPhysicalAddressEPjj");
+    EXPORT_SYMBOL_ASM("_ZN9Scheduler14activeInstanceE");
 
     // Export GraphicsDriver Methods
     EXPORT_SYMBOL_ASM("_ZN14GraphicsDriverC2EjjjPj");  // Constructor
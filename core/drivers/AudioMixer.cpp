@@ -7,8 +7,10 @@
  */
 
 #include <core/drivers/AudioMixer.h>
+#include <core/scheduler.h>
 
-AudioMixer::AudioMixer(AudioDriver* drv) : driver(drv), mixBuffer(nullptr), bufferSize(0) {
+AudioMixer::AudioMixer(AudioDriver* drv)
+    : driver(drv), mixBuffer(nullptr), bufferSize(0), threadStarted(false), reportedUnderruns(0) {
     memset(streams, 0, sizeof(streams));
 
     bufferSize = driver->GetBufferSize();
@@ -19,6 +21,40 @@ AudioMixer::AudioMixer(AudioDriver* drv) : driver(drv), mixBuffer(nullptr), buff
     }
 }
 
+void AudioMixer::StartThread(Scheduler* scheduler) {
+    if (threadStarted || !scheduler) return;
+    ProcessControlBlock* pcb = scheduler->CreateProcess(true, MixerThread, this);
+    scheduler->SetPriority(pcb->threads.GetFront(), THREAD_PRIORITY_REALTIME);
+    threadStarted = true;
+}
+
+// Mixing happens here, never in IRQ context. The driver's buffer-complete IRQ
+// wakes this thread, which as a realtime thread runs at that IRQ's exit.
+void AudioMixer::MixerThread(void* arg) {
+    AudioMixer* self = (AudioMixer*)arg;
+    AudioDriver* drv = self->driver;
+
+    while (true) {
+        // Nothing drains the hardware queue while stopped; PlayBuffer wakes us
+        uint32_t flags = self->playWait.lock.Lock();
+        if (!drv->IsPlaying()) {
+            self->playWait.SleepLocked(flags);
+            continue;
+        }
+        self->playWait.lock.Unlock(flags);
+
+        drv->WaitForBufferSpace(AUDIO_THREAD_TIMEOUT_MS);
+        self->Update();
+
+        uint32_t underruns = drv->GetUnderruns();
+        if (underruns != self->reportedUnderruns) {
+            DEBUG_LOG("AudioMixer: %d underrun(s), %d total", underruns - self->reportedUnderruns,
+                      underruns);
+            self->reportedUnderruns = underruns;
+        }
+    }
+}
+
 void AudioMixer::SetOutputSampleRate(uint32_t rate) {
     if (driver) driver->SetSampleRate(rate);
 }
@@ -26,6 +62,7 @@ void AudioMixer::SetOutputSampleRate(uint32_t rate) {
 void AudioMixer::PlayBuffer(uint8_t* data, uint32_t length, bool loop) {
     if (!data || length == 0) return;
 
+    MutexGuard guard(mixLock);
     for (int i = 0; i < 8; i++) {
         if (!streams[i].active) {
             streams[i].data = data;
@@ -43,12 +80,14 @@ void AudioMixer::PlayBuffer(uint8_t* data, uint32_t length, bool loop) {
             ProcessAudio();
         }
         driver->Start();
+        playWait.WakeAll();
     }
 }
 
 void AudioMixer::Update() {
     if (!driver || !mixBuffer) return;
 
+    MutexGuard guard(mixLock);
     // Keep filling as long as hardware has space
     while (driver->IsReadyForData()) {
         ProcessAudio();
@@ -0,0 +1,251 @@
+/**
+ * @file        BlockQueue.cpp
+ * @brief       Asynchronous block request queue with merging and elevator ordering
+ *
+ * @date        18/10/2026
+ * @version     1.0.0
+ */
+
+#include <core/drivers/BlockQueue.h>
+#include <core/globals.h>
+#include <core/paging.h>
+#include <core/scheduler.h>
+#include <debug.h>
+
+BlockQueue::BlockQueue(BlockDevice* dev) {
+    this->dev = dev;
+    pending = nullptr;
+    active = nullptr;
+    pendingCount = 0;
+    inFlight = 0;
+    nextSeq = 0;
+    headPosition = 0;
+    started = false;
+    memset(&stats, 0, sizeof(stats));
+}
+
+BlockQueue::~BlockQueue() {}
+
+void BlockQueue::Start(Scheduler* scheduler) {
+    if (started || !scheduler) return;
+
+    uint32_t workers = dev->GetQueueDepth();
+    if (workers < 1) workers = 1;
+    if (workers > BLOCK_QUEUE_MAX_WORKERS) workers = BLOCK_QUEUE_MAX_WORKERS;
+    for (uint32_t i = 0; i < workers; i++) scheduler->CreateProcess(true, Worker, this);
+
+    started = true;
+    DEBUG_LOG("BlockQueue: %d worker(s), device depth %d", workers, dev->GetQueueDepth());
+}
+
+static bool Overlaps(BlockRequest* a, BlockRequest* b) {
+    return (a->write || b->write) && a->lba < b->lba + b->count && b->lba < a->lba + a->count;
+}
+
+// --- Internal helpers, all called with 'lock' held ---
+
+// A request may go only once nothing older that it overlaps is still queued or running
+bool BlockQueue::Eligible(BlockRequest* request) {
+    for (BlockRequest* other = active; other; other = other->queueNext) {
+        if (Overlaps(request, other)) return false;
+    }
+    for (BlockRequest* other = pending; other; other = other->queueNext) {
+        if (other->queueSeq < request->queueSeq && Overlaps(request, other)) return false;
+    }
+    return true;
+}
+
+// Unlink the next command's requests from 'pending' into 'batch'. Returns how many.
+uint32_t BlockQueue::TakeBatch(BlockRequest** batch) {
+    // Deadline first: the eligible request that expired the longest ago
+    uint32_t now = (uint32_t)timerTicks;
+    BlockRequest* first = nullptr;
+    for (BlockRequest* r = pending; r; r = r->queueNext) {
+        if ((int32_t)(now - r->queueDeadline) < 0) continue;
+        if (first && (int32_t)(r->queueDeadline - first->queueDeadline) >= 0) continue;
+        if (Eligible(r)) first = r;
+    }
+    if (first) {
+        stats.expired++;
+    } else {
+        // C-LOOK: the lowest eligible LBA at or past the head, else the lowest overall
+        BlockRequest* wrap = nullptr;
+        for (BlockRequest* r = pending; r; r = r->queueNext) {
+            if (!Eligible(r)) continue;
+            if (r->lba >= headPosition) {
+                first = r;
+                break;
+            }
+            if (!wrap) wrap = r;
+        }
+        if (!first) first = wrap;
+    }
+    if (!first) return 0;
+
+    // Requests that continue it on disk, in the same direction, join the command
+    uint32_t count = 0;
+    uint32_t sectors = 0;
+    uint32_t max = dev->GetMaxSectors();
+    BlockRequest* r = first;
+    while (r && count < BLOCK_QUEUE_MAX_MERGE) {
+        if (count > 0) {
+            BlockRequest* last = batch[count - 1];
+            if (r->write != first->write || r->lba != last->lba + last->count) break;
+            if (sectors + r->count > max || !Eligible(r)) break;
+        }
+        batch[count++] = r;
+        sectors += r->count;
+        r = r->queueNext;
+    }
+
+    // Unlink them (they are consecutive in the sorted list) and mark them active
+    BlockRequest** link = &pending;
+    while (*link != first) link = &(*link)->queueNext;
+    *link = batch[count - 1]->queueNext;
+    for (uint32_t i = 0; i < count; i++) {
+        batch[i]->queueNext = active;
+        active = batch[i];
+    }
+    pendingCount -= count;
+    inFlight++;
+    headPosition = first->lba + sectors;
+    stats.dispatched++;
+    stats.merged += count - 1;
+    return count;
+}
+
+// Run one command for 'batch', outside the lock
+void BlockQueue::Execute(BlockRequest** batch, uint32_t count) {
+    bool write = batch[0]->write;
+    bool ok;
+    if (count == 1) {
+        ok = write ? dev->WriteSectors(batch[0]->lba, batch[0]->count, batch[0]->data)
+                   : dev->ReadSectors(batch[0]->lba, batch[0]->count, batch[0]->data);
+    } else {
+        BlockVector vec[BLOCK_QUEUE_MAX_MERGE];
+        for (uint32_t i = 0; i < count; i++) {
+            vec[i].data = batch[i]->data;
+            vec[i].count = batch[i]->count;
+        }
+        ok = write ? dev->WriteVector(batch[0]->lba, vec, count)
+                   : dev->ReadVector(batch[0]->lba, vec, count);
+    }
+    for (uint32_t i = 0; i < count; i++) batch[i]->ok = ok;
+}
+
+void BlockQueue::Worker(void* arg) {
+    BlockQueue* self = (BlockQueue*)arg;
+    BlockRequest* batch[BLOCK_QUEUE_MAX_MERGE];
+
+    while (true) {
+        self->lock.Lock();
+        uint32_t count;
+        while ((count = self->TakeBatch(batch)) == 0) self->work.Wait(self->lock);
+        self->lock.Unlock();
+
+        self->Execute(batch, count);
+
+        self->lock.Lock();
+        for (uint32_t i = 0; i < count; i++) {
+            BlockRequest** link = &self->active;
+            while (*link != batch[i]) link = &(*link)->queueNext;
+            *link = batch[i]->queueNext;
+        }
+        self->inFlight--;
+        if (self->pendingCount == 0 && self->inFlight == 0) self->idle.Broadcast();
+        // Requests held back by an overlap with this command may go now
+        if (self->pendingCount > 0) self->work.Broadcast();
+        self->lock.Unlock();
+
+        for (uint32_t i = 0; i < count; i++) Complete(batch[i], batch[i]->ok);
+    }
+}
+
+// --- Public API ---
+// Workers run on the kernel page directory, where the submitting process's user
+// pages are not mapped
+static bool IsUserBuffer(const uint8_t* data) {
+    return (uint32_t)data >= USER_SPACE_START && (uint32_t)data < USER_SPACE_END;
+}
+
+void BlockQueue::Submit(BlockRequest* request) {
+    request->done = false;
+
+    // Nobody could sleep waiting for a worker (early boot): do it in place
+    Scheduler* sched = Scheduler::activeInstance;
+    if (!started || !sched || !sched->CanBlock()) {
+        dev->Submit(request);
+        return;
+    }
+
+    if (IsUserBuffer(request->data)) {
+        DEBUG_LOG("BlockQueue: Submit() with user buffer 0x%x refused", request->data);
+        Complete(request, false);
+        return;
+    }
+
+    lock.Lock();
+    request->queueSeq = nextSeq++;
+    uint32_t age = request->write ? BLOCK_QUEUE_WRITE_DEADLINE_MS : BLOCK_QUEUE_READ_DEADLINE_MS;
+    request->queueDeadline = (uint32_t)timerTicks + age;
+
+    // Sorted insert, after requests with the same LBA so equal ones stay in order
+    BlockRequest** link = &pending;
+    while (*link && (*link)->lba <= request->lba) link = &(*link)->queueNext;
+    request->queueNext = *link;
+    *link = request;
+
+    pendingCount++;
+    stats.submitted++;
+    if (pendingCount > stats.maxPending) stats.maxPending = pendingCount;
+    work.Signal();
+    lock.Unlock();
+}
+
+static void SignalRequestDone(BlockRequest* request) {
+    ((Semaphore*)request->context)->Signal();
+}
+
+bool BlockQueue::Transfer(uint32_t lba, uint32_t count, uint8_t* data, bool write) {
+    // A user buffer is staged in kernel memory, copied here in the caller's address space
+    uint8_t* buffer = data;
+    uint32_t bytes = count * GetSectorSize();
+    if (IsUserBuffer(data)) {
+        buffer = new uint8_t[bytes];
+        if (!buffer) return false;
+        if (write) memcpy(buffer, data, bytes);
+    }
+
+    Semaphore done;
+    BlockRequest request = {lba, count, buffer, write};
+    request.callback = SignalRequestDone;
+    request.context = &done;
+    Submit(&request);
+    done.Wait();
+
+    if (buffer != data) {
+        if (!write && request.ok) memcpy(data, buffer, bytes);
+        delete[] buffer;
+    }
+    return request.ok;
+}
+
+bool BlockQueue::ReadSectors(uint32_t lba, uint32_t count, uint8_t* data) {
+    return Transfer(lba, count, data, false);
+}
+
+bool BlockQueue::WriteSectors(uint32_t lba, uint32_t count, const uint8_t* data) {
+    return Transfer(lba, count, (uint8_t*)data, true);
+}
+
+void BlockQueue::Flush() {
+    lock.Lock();
+    while (pendingCount > 0 || inFlight > 0) idle.Wait(lock);
+    lock.Unlock();
+    dev->Flush();
+}
+
+void BlockQueue::GetStats(BlockQueueStats* out) {
+    MutexGuard guard(lock);
+    *out = stats;
+}
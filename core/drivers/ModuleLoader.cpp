@@ -50,6 +50,33 @@ void* ModuleLoader::LoadMatchingDriver(File* file, uint16_t target_vid, uint16_t
     }
 }
 
+void* ModuleLoader::LoadMatchingClassDriver(File* file, uint8_t target_class,
+                                            uint8_t target_subclass) {
+    if (!file) return 0;
+
+    DriverManifest manifest;
+    if (!ModuleLoader::Probe(file, &manifest)) {
+        printf("[ModuleLoader] Error: File is not a valid driver (Missing .driver_info)\n");
+        return 0;
+    }
+
+    uint16_t classId = DRIVER_CLASS_ID(target_class, target_subclass);
+    for (int i = 0; i < 4; i++) {
+        if (manifest.devices[i].vendor_id == 0) break;
+
+        if (manifest.devices[i].vendor_id == DRIVER_MATCH_CLASS &&
+            manifest.devices[i].device_id == classId) {
+            printf("[ModuleLoader] Match: %s v%s supports class %x:%x. Loading...\n",
+                   manifest.name, manifest.version, target_class, target_subclass);
+            return ModuleLoader::LoadDriver(file);
+        }
+    }
+
+    printf("[ModuleLoader] Skip: %s does not support class %x:%x\n", manifest.name, target_class,
+           target_subclass);
+    return 0;
+}
+
 void* ModuleLoader::LoadDriver(File* file) {
     if (!file) return 0;
 
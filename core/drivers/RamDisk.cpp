@@ -0,0 +1,69 @@
+/**
+ * @file        RamDisk.cpp
+ * @brief       Block device backed by physical memory pages
+ *
+ * @date        18/10/2026
+ * @version     1.0.0
+ */
+
+#include <core/drivers/RamDisk.h>
+#include <core/memory.h>
+#include <debug.h>
+
+RamDisk::RamDisk(uint32_t sizeInSectors) {
+    pageCount = (sizeInSectors + RAMDISK_SECTORS_PER_PAGE - 1) / RAMDISK_SECTORS_PER_PAGE;
+    pages = new uint8_t*[pageCount];
+    if (!pages) {
+        HALT("CRITICAL: Failed to allocate the RAM disk page table!\n");
+    }
+
+    uint32_t allocated = 0;
+    while (allocated < pageCount) {
+        uint8_t* page = (uint8_t*)pmm_alloc_block_low(RAMDISK_PHYS_LIMIT);
+        if (!page) break;
+        memset(page, 0, PMM_BLOCK_SIZE);
+        pages[allocated++] = page;
+    }
+    if (allocated < pageCount) {
+        DEBUG_LOG("RamDisk: out of memory after %d of %d pages", allocated, pageCount);
+        pageCount = allocated;
+        sizeInSectors = allocated * RAMDISK_SECTORS_PER_PAGE;
+    }
+    sectors = sizeInSectors;
+    DEBUG_LOG("RamDisk: %d sectors in %d pages", sectors, pageCount);
+}
+
+RamDisk::~RamDisk() {
+    for (uint32_t i = 0; i < pageCount; i++) pmm_free_block(pages[i]);
+    delete[] pages;
+}
+
+bool RamDisk::Copy(uint32_t lba, uint32_t count, uint8_t* buffer, bool write) {
+    if (count == 0 || lba >= sectors || count > sectors - lba) return false;
+
+    // One memcpy per page touched
+    while (count > 0) {
+        uint32_t offset = lba % RAMDISK_SECTORS_PER_PAGE;
+        uint32_t n = RAMDISK_SECTORS_PER_PAGE - offset;
+        if (n > count) n = count;
+
+        uint8_t* page = pages[lba / RAMDISK_SECTORS_PER_PAGE] + offset * BLOCK_SECTOR_SIZE;
+        if (write)
+            memcpy(page, buffer, n * BLOCK_SECTOR_SIZE);
+        else
+            memcpy(buffer, page, n * BLOCK_SECTOR_SIZE);
+
+        buffer += n * BLOCK_SECTOR_SIZE;
+        lba += n;
+        count -= n;
+    }
+    return true;
+}
+
+bool RamDisk::ReadSectors(uint32_t lba, uint32_t count, uint8_t* data) {
+    return Copy(lba, count, data, false);
+}
+
+bool RamDisk::WriteSectors(uint32_t lba, uint32_t count, const uint8_t* data) {
+    return Copy(lba, count, (uint8_t*)data, true);
+}
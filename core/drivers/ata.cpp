@@ -7,6 +7,22 @@
  */
 
 #include <core/drivers/ata.h>
+#include <core/pci.h>
+#include <core/pmm.h>
+
+ATAChannelIRQ* AdvancedTechnologyAttachment::channels[2] = {nullptr, nullptr};
+
+ATAChannelIRQ::ATAChannelIRQ(uint8_t irq, uint16_t portBase, InterruptManager* interruptManager)
+    : InterruptHandler(irq, interruptManager) {
+    this->statusPort = portBase + 0x7;
+}
+
+uint32_t ATAChannelIRQ::HandleInterrupt(uint32_t esp) {
+    // Reading STATUS acknowledges the drive's INTRQ
+    inb(statusPort);
+    done.Signal();
+    return esp;
+}
 
 AdvancedTechnologyAttachment::AdvancedTechnologyAttachment(bool master, uint16_t portBase)
     : dataPort(portBase),
@@ -19,6 +35,11 @@ AdvancedTechnologyAttachment::AdvancedTechnologyAttachment(bool master, uint16_t
       commandPort(portBase + 0x7),
       controlPort(portBase + 0x206) {
     this->master = master;
+    this->channel = nullptr;
+    this->multipleSectors = 0;
+    this->dmaCapable = false;
+    this->busMasterPort = 0;
+    this->prdTable = nullptr;
 }
 
 AdvancedTechnologyAttachment::~AdvancedTechnologyAttachment() {}
@@ -55,12 +76,19 @@ uint32_t AdvancedTechnologyAttachment::Identify() {
     }
 
     uint32_t totalSectors = 0;
+    uint8_t multipleMax = 0;
 
     for (int i = 0; i < 256; i++) {
         uint16_t data = dataPort.Read();
 
+        // Word 47 (low byte) is the largest DRQ block READ/WRITE MULTIPLE accepts.
+        // Word 49 bit 8 is DMA support.
         // Words 60 and 61 contain the total sector count for LBA28
-        if (i == 60) {
+        if (i == 47) {
+            multipleMax = data & 0xFF;
+        } else if (i == 49) {
+            this->dmaCapable = (data & 0x0100) != 0;
+        } else if (i == 60) {
             totalSectors = data;
         } else if (i == 61) {
             totalSectors |= ((uint32_t)data << 16);
@@ -70,90 +98,309 @@ uint32_t AdvancedTechnologyAttachment::Identify() {
     printf("HDD Identified. Size: %d Sectors (%d MB)\n", (int32_t)totalSectors,
            (int32_t)(totalSectors * 512) / 1024 / 1024);
     this->ata_size = totalSectors;
+
+    if (multipleMax > 1) SetMultipleMode(multipleMax);
     return totalSectors;
 }
 
-void AdvancedTechnologyAttachment::Read28(uint32_t sectorNum, uint8_t* data, int count) {
-    if (sectorNum > 0x0FFFFFFF) return;
-
-    devicePort.Write((master ? 0xE0 : 0xF0) | ((sectorNum & 0x0F000000) >> 24));
-    errorPort.Write(0);
-    sectorCountPort.Write(1);
-    lbaLowPort.Write(sectorNum & 0x000000FF);
-    lbaMidPort.Write((sectorNum & 0x0000FF00) >> 8);
-    lbaHiPort.Write((sectorNum & 0x00FF0000) >> 16);
-    commandPort.Write(0x20);
+// Ask the drive to move 'sectors' sectors per DRQ block (and per IRQ)
+void AdvancedTechnologyAttachment::SetMultipleMode(uint8_t sectors) {
+    // Drives only take powers of two
+    uint8_t block = 1;
+    while (block * 2 <= sectors && block < 128) block *= 2;
+    if (block < 2) return;
 
-    uint8_t status = commandPort.Read();
-    uint8_t status2 = commandPort.Read();
-    uint8_t status3 = commandPort.Read();
-    uint8_t status4 = commandPort.Read();
+    BeginCommand();
+    devicePort.Write(master ? 0xE0 : 0xF0);
+    sectorCountPort.Write(block);
+    commandPort.Write(0xC6);
+    WaitForIRQ();
+    uint8_t status = WaitNotBusy();
+    EndCommand();
 
-    while ((status & 0x80) == 0x80) status = commandPort.Read();
-    if ((status & 0x01) == 0x01) {
-        printf("ATA READ ERROR\n");
+    if (status & 0x01) {
+        DEBUG_LOG("ATA: SET MULTIPLE %d rejected, using single-sector transfers", block);
         return;
     }
-    while ((status & 0x08) != 0x08) status = commandPort.Read();
-
-    // --- OPTIMIZED READ ---
-    if (count == 512) {
-        // Fast Path
-        insw(dataPort.getPortNumber(), data, 256);
-    } else {
-        // Slow Path
-        uint8_t sectorBuffer[512];
-        insw(dataPort.getPortNumber(), sectorBuffer, 256);
-
-        for (int i = 0; i < count; i++) {
-            data[i] = sectorBuffer[i];
+    this->multipleSectors = block;
+    DEBUG_LOG("ATA: %d sectors per block (READ/WRITE MULTIPLE)", block);
+}
+
+void AdvancedTechnologyAttachment::EnableInterrupts(InterruptManager* interruptManager) {
+    bool primary = (dataPort.getPortNumber() == 0x1F0);
+    int index = primary ? 0 : 1;
+    if (!channels[index]) {
+        channels[index] = new ATAChannelIRQ(primary ? 0x2E : 0x2F, dataPort.getPortNumber(),
+                                            interruptManager);
+        if (!channels[index]) {
+            HALT("CRITICAL: Failed to allocate ATA channel IRQ handler!\n");
+        }
+    }
+    this->channel = channels[index];
+    controlPort.Write(0);  // nIEN = 0
+}
+
+bool AdvancedTechnologyAttachment::EnableDMA() {
+    if (!dmaCapable) return false;
+
+    // Any mass storage controller (class 01h) of the IDE subclass (01h)
+    PeripheralComponentInterconnectController pci;
+    for (int bus = 0; bus < 8; bus++) {
+        for (int device = 0; device < 32; device++) {
+            int numFunctions = pci.DeviceHasFunctions(bus, device) ? 8 : 1;
+            for (int function = 0; function < numFunctions; function++) {
+                uint16_t vendor = pci.Read(bus, device, function, 0x00) & 0xFFFF;
+                if (vendor == 0x0000 || vendor == 0xFFFF) continue;
+                if ((pci.Read(bus, device, function, 0x0B) & 0xFF) != 0x01) continue;
+                if ((pci.Read(bus, device, function, 0x0A) & 0xFF) != 0x01) continue;
+
+                // Programming interface bit 7: bus mastering supported
+                if (!(pci.Read(bus, device, function, 0x09) & 0x80)) continue;
+                BaseAddressRegister bar = pci.GetBaseAddressRegister(bus, device, function, 4);
+                if (bar.type != InputOutput || !bar.address) continue;
+
+                if (!prdTable) {
+                    // Read by the controller through its physical address
+                    prdTable = (ATAPhysicalRegion*)pmm_alloc_block_low(256 * 1024 * 1024);
+                    if (!prdTable) return false;
+                }
+
+                // Command register bit 2: bus master enable
+                uint32_t command = pci.Read(bus, device, function, 0x04) & 0xFFFF;
+                pci.Write(bus, device, function, 0x04, command | 0x0004);
+
+                bool primary = (dataPort.getPortNumber() == 0x1F0);
+                busMasterPort = (uint16_t)(uint32_t)bar.address + (primary ? 0 : 8);
+                DEBUG_LOG("ATA: bus-master DMA at port 0x%x", busMasterPort);
+                return true;
+            }
         }
     }
+    return false;
 }
 
-void AdvancedTechnologyAttachment::Write28(uint32_t sectorNum, uint8_t* data, uint32_t count) {
-    if (sectorNum > 0x0FFFFFFF) return;
-    if (count > 512) count = 512;
+void AdvancedTechnologyAttachment::BeginCommand() {
+    if (!channel) return;
+    channel->busy.Lock();
+    // Forget completions nobody waited for (e.g. a previous polled command)
+    while (channel->done.TryWait()) {
+    }
+}
 
+// Sleep until the drive raises its IRQ. The status polling that follows still
+// runs, so a missed or stale interrupt only costs a few spins.
+void AdvancedTechnologyAttachment::WaitForIRQ() {
+    if (!channel) return;
+    if (!Scheduler::activeInstance || !Scheduler::activeInstance->CanBlock()) return;
+    channel->done.Wait(ATA_IRQ_TIMEOUT_MS);
+}
+
+void AdvancedTechnologyAttachment::EndCommand() {
+    if (channel) channel->busy.Unlock();
+}
+
+void AdvancedTechnologyAttachment::SelectLBA28(uint32_t sectorNum, uint32_t count) {
     devicePort.Write((master ? 0xE0 : 0xF0) | ((sectorNum & 0x0F000000) >> 24));
     errorPort.Write(0);
-    sectorCountPort.Write(1);
+    sectorCountPort.Write(count & 0xFF);  // 256 is sent as 0
     lbaLowPort.Write(sectorNum & 0x000000FF);
     lbaMidPort.Write((sectorNum & 0x0000FF00) >> 8);
     lbaHiPort.Write((sectorNum & 0x00FF0000) >> 16);
-    commandPort.Write(0x30);
+}
 
+// Give the drive its 400ns to update STATUS (four ALT STATUS reads), then spin
+// while it is busy. Returns the last status.
+uint8_t AdvancedTechnologyAttachment::WaitNotBusy() {
+    for (int i = 0; i < 4; i++) controlPort.Read();
     uint8_t status = commandPort.Read();
-    uint8_t status2 = commandPort.Read();
-    uint8_t status3 = commandPort.Read();
-    uint8_t status4 = commandPort.Read();
-
     while ((status & 0x80) == 0x80) status = commandPort.Read();
-    while ((status & 0x08) != 0x08) status = commandPort.Read();
-
-    // --- OPTIMIZED WRITE ---
-    // If we are writing a full sector, use outsw
-    if (count == 512) {
-        outsw(dataPort.getPortNumber(), data, 256);
-    } else {
-        // Partial write: Copy to padded buffer first
-        uint8_t sectorBuffer[512];
-        for (int i = 0; i < 512; i++) {
-            if (i < (int)count)
-                sectorBuffer[i] = data[i];
-            else
-                sectorBuffer[i] = 0;
+    return status;
+}
+
+// Wait until the drive wants data moved (DRQ) or reports an error (ERR)
+uint8_t AdvancedTechnologyAttachment::WaitDataRequest() {
+    uint8_t status = WaitNotBusy();
+    while ((status & 0x09) == 0) status = commandPort.Read();
+    return status;
+}
+
+// Describe 'buffer' to the bus-master engine. Fails (and the caller uses PIO)
+// when DMA is off or a page of the buffer cannot be translated.
+bool AdvancedTechnologyAttachment::BuildPRDTable(const BlockVector* vec, uint32_t vecCount) {
+    if (!busMasterPort || !channel) return false;
+    Scheduler* sched = Scheduler::activeInstance;
+    if (!sched || !sched->GetPager()) return false;
+
+    // The buffers are either kernel memory or the current process's user memory
+    uint32_t* directory;
+    asm volatile("mov %%cr3, %0" : "=r"(directory));
+
+    uint32_t entries = 0;
+    for (uint32_t v = 0; v < vecCount; v++) {
+        if ((uint32_t)vec[v].data & 1) return false;  // The engine moves 16-bit words
+        uint32_t addr = (uint32_t)vec[v].data;
+        uint32_t remaining = vec[v].count * 512;
+        while (remaining > 0) {
+            uint32_t phys = sched->GetPager()->GetPhysicalAddress(directory, addr);
+            if (!phys) return false;
+            uint32_t chunk = PAGE_SIZE - (addr & (PAGE_SIZE - 1));
+            if (chunk > remaining) chunk = remaining;
+
+            // Grow the previous entry while memory stays contiguous inside one 64 KB region
+            ATAPhysicalRegion* last = entries ? &prdTable[entries - 1] : nullptr;
+            uint32_t lastBytes = last ? (last->byteCount ? last->byteCount : 0x10000) : 0;
+            if (last && last->address + lastBytes == phys &&
+                (last->address >> 16) == ((phys + chunk - 1) >> 16)) {
+                last->byteCount = (uint16_t)(lastBytes + chunk);  // 64 KB wraps to 0
+            } else {
+                if (entries == ATA_PRD_MAX) return false;
+                prdTable[entries].address = phys;
+                prdTable[entries].byteCount = (uint16_t)chunk;
+                prdTable[entries].flags = 0;
+                entries++;
+            }
+            addr += chunk;
+            remaining -= chunk;
+        }
+    }
+    if (entries == 0) return false;
+    prdTable[entries - 1].flags = ATA_PRD_EOT;
+    return true;
+}
+
+// Run one READ DMA / WRITE DMA over the PRD table and sleep until IRQ14/15
+bool AdvancedTechnologyAttachment::TransferDMA(uint32_t sectorNum, uint32_t count, bool write) {
+    uint16_t bm = busMasterPort;
+    outb(bm + ATA_BM_COMMAND, 0);
+    outl(bm + ATA_BM_PRDT, (uint32_t)prdTable);
+    outb(bm + ATA_BM_STATUS, ATA_BM_STATUS_ERROR | ATA_BM_STATUS_IRQ);  // Write 1 to clear
+
+    SelectLBA28(sectorNum, count);
+    commandPort.Write(write ? 0xCA : 0xC8);  // WRITE DMA / READ DMA
+    outb(bm + ATA_BM_COMMAND, ATA_BM_CMD_START | (write ? 0 : ATA_BM_CMD_READ));
+
+    // The CPU is free for other threads until the drive interrupts
+    uint8_t bmStatus = inb(bm + ATA_BM_STATUS);
+    while ((bmStatus & ATA_BM_STATUS_ACTIVE) &&
+           !(bmStatus & (ATA_BM_STATUS_IRQ | ATA_BM_STATUS_ERROR))) {
+        WaitForIRQ();
+        bmStatus = inb(bm + ATA_BM_STATUS);
+    }
+
+    outb(bm + ATA_BM_COMMAND, 0);
+    uint8_t status = WaitNotBusy();
+    outb(bm + ATA_BM_STATUS, ATA_BM_STATUS_ERROR | ATA_BM_STATUS_IRQ);
+
+    if ((bmStatus & ATA_BM_STATUS_ERROR) || (status & 0x21)) {
+        printf("ATA DMA %s ERROR\n", write ? "WRITE" : "READ");
+        return false;
+    }
+    return true;
+}
+
+bool AdvancedTechnologyAttachment::ReadSectors(uint32_t sectorNum, uint32_t count, uint8_t* data) {
+    if (count == 0 || count > ATA_MAX_SECTORS) return false;
+    if (sectorNum > 0x0FFFFFFF || sectorNum + count - 1 > 0x0FFFFFFF) return false;
+    BlockVector vec = {data, count};
+    BeginCommand();
+    bool ok = BuildPRDTable(&vec, 1) ? TransferDMA(sectorNum, count, false)
+                                     : ReadPIO(sectorNum, count, data);
+    EndCommand();
+    return ok;
+}
+
+bool AdvancedTechnologyAttachment::WriteSectors(uint32_t sectorNum, uint32_t count,
+                                                const uint8_t* data) {
+    if (count == 0 || count > ATA_MAX_SECTORS) return false;
+    if (sectorNum > 0x0FFFFFFF || sectorNum + count - 1 > 0x0FFFFFFF) return false;
+    BlockVector vec = {(uint8_t*)data, count};
+    BeginCommand();
+    bool ok = BuildPRDTable(&vec, 1) ? TransferDMA(sectorNum, count, true)
+                                     : WritePIO(sectorNum, count, data);
+    EndCommand();
+    return ok;
+}
+
+bool AdvancedTechnologyAttachment::ReadVector(uint32_t sectorNum, const BlockVector* vec,
+                                              uint32_t vecCount) {
+    return TransferVector(sectorNum, vec, vecCount, false);
+}
+
+bool AdvancedTechnologyAttachment::WriteVector(uint32_t sectorNum, const BlockVector* vec,
+                                               uint32_t vecCount) {
+    return TransferVector(sectorNum, vec, vecCount, true);
+}
+
+// One DMA command for the whole vector when the PRD table can describe it,
+// otherwise one command per piece
+bool AdvancedTechnologyAttachment::TransferVector(uint32_t sectorNum, const BlockVector* vec,
+                                                  uint32_t vecCount, bool write) {
+    uint32_t count = VectorSectors(vec, vecCount);
+    if (count == 0) return true;
+    if (count <= ATA_MAX_SECTORS && sectorNum + count - 1 <= 0x0FFFFFFF) {
+        BeginCommand();
+        bool dma = BuildPRDTable(vec, vecCount);
+        bool ok = dma && TransferDMA(sectorNum, count, write);
+        EndCommand();
+        if (dma) return ok;
+    }
+    return TransferEach(sectorNum, vec, vecCount, write);
+}
+
+bool AdvancedTechnologyAttachment::ReadPIO(uint32_t sectorNum, uint32_t count, uint8_t* data) {
+    SelectLBA28(sectorNum, count);
+    uint32_t block = multipleSectors > 1 ? multipleSectors : 1;
+    commandPort.Write(block > 1 ? 0xC4 : 0x20);  // READ MULTIPLE / READ SECTORS
+
+    // One IRQ and one DRQ block per 'block' sectors, the last block may be shorter
+    bool ok = true;
+    for (uint32_t done = 0; done < count; done += block) {
+        if (block > count - done) block = count - done;
+        WaitForIRQ();
+        uint8_t status = WaitDataRequest();
+        if (status & 0x01) {
+            printf("ATA READ ERROR\n");
+            ok = false;
+            break;
         }
-        outsw(dataPort.getPortNumber(), sectorBuffer, 256);
+        insw(dataPort.getPortNumber(), data + done * 512, block * 256);
     }
+    return ok;
+}
+
+bool AdvancedTechnologyAttachment::WritePIO(uint32_t sectorNum, uint32_t count,
+                                            const uint8_t* data) {
+    SelectLBA28(sectorNum, count);
+    uint32_t block = multipleSectors > 1 ? multipleSectors : 1;
+    commandPort.Write(block > 1 ? 0xC5 : 0x30);  // WRITE MULTIPLE / WRITE SECTORS
 
-    Flush();
+    // The drive asks for each block with DRQ and raises an IRQ once it took it
+    bool ok = true;
+    for (uint32_t done = 0; done < count; done += block) {
+        if (block > count - done) block = count - done;
+        uint8_t status = WaitDataRequest();
+        if (status & 0x01) {
+            ok = false;
+            break;
+        }
+        outsw(dataPort.getPortNumber(), (void*)(data + done * 512), block * 256);
+        WaitForIRQ();
+    }
+    if (ok && (WaitNotBusy() & 0x21)) ok = false;  // ERR or device fault
+    if (!ok) printf("ATA WRITE ERROR\n");
+    return ok;
 }
 
 void AdvancedTechnologyAttachment::Flush() {
+    BeginCommand();
     devicePort.Write(master ? 0xE0 : 0xF0);
     commandPort.Write(0xE7);
+    WaitForIRQ();
     uint8_t status = commandPort.Read();
-    if (status == 0x00) return;
+    if (status == 0x00) {
+        EndCommand();
+        return;
+    }
     while (((status & 0x80) == 0x80) && ((status & 0x01) != 0x01)) status = commandPort.Read();
+    EndCommand();
 }
@@ -7,7 +7,9 @@
  */
 
 #include <core/drivers/keyboard.h>
+#include <core/input.h>
 #include <core/memory.h>
+#include <core/softirq.h>
 
 KeyboardDriver* KeyboardDriver::activeInstance = nullptr;
 
@@ -55,7 +57,12 @@ KeyboardDriver::KeyboardDriver(InterruptManager* manager, KeyboardEventHandler*
     this->eventHandler = handler;
     this->driverName = "Generic Keyboard Driver  ";
     memset(this->keyStates, 0, sizeof(this->keyStates));
+    this->queueHead = 0;
+    this->queueTail = 0;
+    this->irqExtended = false;
     activeInstance = this;
+
+    SoftIRQ::Register(SOFTIRQ_KEYBOARD, ProcessScancodes, this);
 }
 
 /**
@@ -85,7 +92,7 @@ void KeyboardDriver::Activate() {
 }
 
 /**
- * Handles keyboard interrupts and processes key events
+ * Handles keyboard interrupts: reads the scancode and queues it
  *
  * @param esp Current stack pointer
  * @return Updated stack pointer after handling interrupt
@@ -93,14 +100,50 @@ void KeyboardDriver::Activate() {
 uint32_t KeyboardDriver::HandleInterrupt(uint32_t esp) {
     uint8_t key = dataPort.Read();
 
+    // Timestamped here, handed to sys_input_wait processes by the input softirq
+    if (key == 0xE0) {
+        irqExtended = true;
+    } else if (key != 0xE1) {
+        InputQueue::KeyEvent(key, irqExtended);
+        irqExtended = false;
+    }
+
     if (this->eventHandler == 0) return esp;
 
+    // Decoding and the GUI callbacks run in the keyboard softirq
+    if (queueHead - queueTail < KEYBOARD_QUEUE_SIZE) {
+        scancodes[queueHead % KEYBOARD_QUEUE_SIZE] = key;
+        queueHead++;
+    }
+    SoftIRQ::Raise(SOFTIRQ_KEYBOARD);
+
+    return esp;
+}
+
+/**
+ * Keyboard softirq: decodes queued scancodes in arrival order
+ */
+void KeyboardDriver::ProcessScancodes(void* arg) {
+    KeyboardDriver* self = (KeyboardDriver*)arg;
+    while (self->queueTail != self->queueHead) {
+        uint8_t key = self->scancodes[self->queueTail % KEYBOARD_QUEUE_SIZE];
+        self->queueTail++;
+        self->ProcessScancode(key);
+    }
+}
+
+/**
+ * Updates modifier / key state and calls the event handler for one scancode
+ *
+ * @param key Raw scancode from the controller
+ */
+void KeyboardDriver::ProcessScancode(uint8_t key) {
     // printf(WHITE, "\nKey is 0x%x\n", key);
     static bool isExtendedScancode = false;
 
     if (key == 0xE0) {
         isExtendedScancode = true;  // Mark the next scancode as extended
-        return esp;                 // Skip processing for now
+        return;                     // Skip processing for now
     }
 
     // Key mappings
@@ -190,7 +233,7 @@ uint32_t KeyboardDriver::HandleInterrupt(uint32_t esp) {
                 // DEBUG_LOG("Error : Unhandled extended key: 0x%x", key);
                 break;
         }
-        return esp;
+        return;
     }
 
     // Normal scancodes
@@ -399,6 +442,4 @@ uint32_t KeyboardDriver::HandleInterrupt(uint32_t esp) {
                 break;
         }
     }
-
-    return esp;
 }
@@ -7,6 +7,8 @@
  */
 
 #include <core/drivers/mouse.h>
+#include <core/input.h>
+#include <core/softirq.h>
 
 MouseDriver* MouseDriver::activeInstance = nullptr;
 
@@ -46,7 +48,12 @@ MouseDriver::MouseDriver(InterruptManager* manager, MouseEventHandler* handler)
     this->buttons = 0;
     this->accumDX = 0;
     this->accumDY = 0;
+    this->queueHead = 0;
+    this->queueTail = 0;
+    this->eventButtons = 0;
     activeInstance = this;
+
+    SoftIRQ::Register(SOFTIRQ_MOUSE, ProcessPackets, this);
 }
 
 /**
@@ -75,7 +82,10 @@ void MouseDriver::Activate() {
 }
 
 /**
- * @brief Handles mouse interrupts and processes mouse events.
+ * @brief Handles mouse interrupts: assembles packets and queues them.
+ *
+ * The polling state (accumulated delta, buttons) is updated here, the event
+ * handler is called later from the mouse softirq.
  *
  * @param esp Current stack pointer.
  * @return Updated stack pointer after handling the interrupt.
@@ -91,24 +101,59 @@ uint32_t MouseDriver::HandleInterrupt(uint32_t esp) {
     offset = (offset + 1) % 3;
 
     if (offset == 0) {
-        if (buffer[1] != 0 || buffer[2] != 0) {
-            int32_t dx = (int8_t)buffer[1];
-            int32_t dy = -((int8_t)buffer[2]);
-            accumDX += dx;
-            accumDY += dy;
-            eventHandler->OnMouseMove(dx, dy);
+        accumDX += (int8_t)buffer[1];
+        accumDY -= (int8_t)buffer[2];
+        InputQueue::MousePacket(buffer);
+        buttons = buffer[0];
+
+        // Drop the packet if the softirq has fallen this far behind
+        if (queueHead - queueTail < MOUSE_QUEUE_SIZE) {
+            uint8_t* slot = packets[queueHead % MOUSE_QUEUE_SIZE];
+            slot[0] = buffer[0];
+            slot[1] = buffer[1];
+            slot[2] = buffer[2];
+            queueHead++;
         }
+        SoftIRQ::Raise(SOFTIRQ_MOUSE);
+    }
+
+    return esp;
+}
+
+/**
+ * @brief Mouse softirq: delivers queued packets to the event handler.
+ *
+ * Consecutive moves without a button change are merged into one OnMouseMove,
+ * so a burst of packets walks the widget tree once.
+ */
+void MouseDriver::ProcessPackets(void* arg) {
+    MouseDriver* self = (MouseDriver*)arg;
+    MouseEventHandler* handler = self->eventHandler;
+    int32_t dx = 0, dy = 0;
+
+    while (self->queueTail != self->queueHead) {
+        uint8_t* slot = self->packets[self->queueTail % MOUSE_QUEUE_SIZE];
+        uint8_t packetButtons = slot[0];
+        dx += (int8_t)slot[1];
+        dy -= (int8_t)slot[2];
+        self->queueTail++;
+
+        if (packetButtons == self->eventButtons) continue;
+
+        // Buttons act at the pointer position, so flush the move first
+        if (dx != 0 || dy != 0) handler->OnMouseMove(dx, dy);
+        dx = dy = 0;
 
         for (uint8_t i = 0; i < 3; i++) {
-            if ((buffer[0] & (0x1 << i)) != (buttons & (0x1 << i))) {
-                if (buttons & (0x1 << i))
-                    eventHandler->OnMouseUp(i + 1);
+            if ((packetButtons & (0x1 << i)) != (self->eventButtons & (0x1 << i))) {
+                if (self->eventButtons & (0x1 << i))
+                    handler->OnMouseUp(i + 1);
                 else
-                    eventHandler->OnMouseDown(i + 1);
+                    handler->OnMouseDown(i + 1);
             }
         }
-        buttons = buffer[0];
+        self->eventButtons = packetButtons;
     }
 
-    return esp;
+    if (dx != 0 || dy != 0) handler->OnMouseMove(dx, dy);
 }
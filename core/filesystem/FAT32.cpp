@@ -9,15 +9,18 @@
 #include <console.h>
 #include <core/filesystem/FAT32.h>
 
-FAT32::FAT32(AdvancedTechnologyAttachment* hd, uint32_t partitionOffset) {
+FAT32::FAT32(BlockDevice* hd, uint32_t partitionOffset, uint32_t cacheBlocks) {
     this->hd = hd;
     this->partitionOffset = partitionOffset;
     this->valid = false;
+    this->nextFree = 2;
+    memset(&readaheadStats, 0, sizeof(readaheadStats));
 
     uint8_t buffer[512];
-    hd->Read28(partitionOffset, buffer, 512);
+    hd->ReadSectors(partitionOffset, 1, buffer);
     BiosParameterBlock32* bpbPtr = (BiosParameterBlock32*)buffer;
     this->bpb = *bpbPtr;
+    this->cache = new SectorCache(hd, cacheBlocks);
 
     if (bpb.bootSignature != 0x28 && bpb.bootSignature != 0x29) {
         printf("FAT32 Error: Invalid Boot Signature\n");
@@ -32,7 +35,9 @@ FAT32::FAT32(AdvancedTechnologyAttachment* hd, uint32_t partitionOffset) {
     printf("FAT32  Mounted.\n");
 }
 
-FAT32::~FAT32() {}
+FAT32::~FAT32() {
+    delete cache;
+}
 
 // --- Utils ---
 // "test.txt" -> "TEST    TXT"
@@ -136,37 +141,38 @@ uint32_t FAT32::GetFATEntry(uint32_t cluster) {
     uint32_t fatSector = fatStart + (fatOffset / 512);
     uint32_t entOffset = fatOffset % 512;
     uint8_t buffer[512];
-    hd->Read28(fatSector, buffer, 512);
+    if (!cache->Read(fatSector, buffer)) return 0x0FFFFFFF;  // Treat as end of chain
     uint32_t tableValue = *(uint32_t*)&buffer[entOffset];
     return tableValue & 0x0FFFFFFF;
 }
 
-void FAT32::SetFATEntry(uint32_t cluster, uint32_t value) {
+// False if the entry could not be read or the cache refused the update
+bool FAT32::SetFATEntry(uint32_t cluster, uint32_t value) {
     uint32_t fatOffset = cluster * 4;
     uint32_t fatSector = fatStart + (fatOffset / 512);
     uint32_t entOffset = fatOffset % 512;
     uint8_t buffer[512];
-    hd->Read28(fatSector, buffer, 512);
+    if (!cache->Read(fatSector, buffer)) return false;  // Never write back what we could not read
     *(uint32_t*)&buffer[entOffset] = value;
-    hd->Write28(fatSector, buffer, 512);
+    return cache->Write(fatSector, buffer, FAT32_PASS_FAT);
 }
 
+// Marks a free cluster as end of chain. Its contents are left as they are: callers
+// either write the whole cluster (WriteCluster) or never read past what they wrote.
 uint32_t FAT32::AllocateCluster() {
     uint8_t buffer[512];
-    uint32_t currentSector = fatStart;
-    for (int i = 0; i < bpb.tableSize; i++) {
-        hd->Read28(currentSector + i, buffer, 512);
+    // Scan from where the last allocation left off, wrapping once
+    uint32_t first = nextFree / 128;
+    for (uint32_t n = 0; n < bpb.tableSize; n++) {
+        uint32_t i = (first + n) % bpb.tableSize;
+        if (!cache->Read(fatStart + i, buffer)) continue;  // Unreadable is not free
+        uint32_t* entries = (uint32_t*)buffer;
         for (int j = 0; j < 128; j++) {
-            uint32_t* entries = (uint32_t*)buffer;
             if (i == 0 && j < 2) continue;
             if ((entries[j] & 0x0FFFFFFF) == 0) {
                 uint32_t clusterIdx = (i * 128) + j;
-                SetFATEntry(clusterIdx, 0x0FFFFFFF);
-                // Zero Disk
-                uint32_t sector = ClusterToSector(clusterIdx);
-                uint8_t zeros[512];
-                memset(zeros, 0, 512);
-                for (int k = 0; k < bpb.sectorsPerCluster; k++) hd->Write28(sector + k, zeros, 512);
+                if (!SetFATEntry(clusterIdx, 0x0FFFFFFF)) return 0;
+                nextFree = clusterIdx + 1;
                 return clusterIdx;
             }
         }
@@ -174,11 +180,41 @@ uint32_t FAT32::AllocateCluster() {
     return 0;
 }
 
+// Writes 'length' bytes at the start of a cluster and zeroes the rest, in one command.
+// False on a device error.
+bool FAT32::WriteCluster(uint32_t cluster, const uint8_t* data, uint32_t length) {
+    uint32_t clusterSize = bpb.sectorsPerCluster * 512;
+    uint8_t* padded = new uint8_t[clusterSize];
+    if (!padded) {
+        HALT("CRITICAL: Failed to allocate a cluster buffer!\n");
+    }
+    if (length) memcpy(padded, data, length);
+    memset(padded + length, 0, clusterSize - length);
+    bool ok = cache->WriteThrough(ClusterToSector(cluster), bpb.sectorsPerCluster, padded);
+    delete[] padded;
+    return ok;
+}
+
+// End of a mutating operation: once the flusher runs the changes stay in the
+// cache for it, before that they are written back right away
+void FAT32::Commit() {
+    if (!cache->IsWriteBack()) cache->Flush();
+}
+
+void FAT32::StartFlusher(Scheduler* scheduler) {
+    cache->Start(scheduler);
+}
+
+void FAT32::Sync() {
+    cache->Flush();
+}
+
 void FAT32::FreeChain(uint32_t startCluster) {
     uint32_t current = startCluster;
     while (current >= 0x00000002 && current < 0x0FFFFFF8) {
         uint32_t next = GetFATEntry(current);
-        SetFATEntry(current, 0x00000000);
+        if (!SetFATEntry(current, 0x00000000)) return;  // Leak the rest rather than guess
+        if (current < nextFree) nextFree = current;
         current = next;
     }
 }
@@ -196,7 +232,7 @@ bool FAT32::FindEntryInCluster(uint32_t cluster, char* name, uint32_t& sectorOut
     while (currentCluster < 0x0FFFFFF8) {
         uint32_t sector = ClusterToSector(currentCluster);
         for (int s = 0; s < bpb.sectorsPerCluster; s++) {
-            hd->Read28(sector + s, buffer, 512);
+            if (!cache->Read(sector + s, buffer)) return false;
             DirectoryEntryFat32* dirents = (DirectoryEntryFat32*)buffer;
 
             for (int i = 0; i < 16; i++) {
@@ -230,7 +266,7 @@ bool FAT32::FindFreeEntryInCluster(uint32_t dirCluster, uint32_t& sectorOut, uin
         uint32_t sector = ClusterToSector(currentCluster);
 
         for (int i = 0; i < bpb.sectorsPerCluster; i++) {
-            hd->Read28(sector + i, buffer, 512);
+            if (!cache->Read(sector + i, buffer)) return false;
             DirectoryEntryFat32* dirent = (DirectoryEntryFat32*)buffer;
             for (int j = 0; j < 16; j++) {
                 if (dirent[j].name[0] == 0x00 || dirent[j].name[0] == 0xE5) {
@@ -244,7 +280,8 @@ bool FAT32::FindFreeEntryInCluster(uint32_t dirCluster, uint32_t& sectorOut, uin
         if (next >= 0x0FFFFFF8) {
             uint32_t newCluster = AllocateCluster();
             if (newCluster == 0) return false;
-            SetFATEntry(currentCluster, newCluster);
+            if (!WriteCluster(newCluster, 0, 0)) return false;  // No entries yet
+            if (!SetFATEntry(currentCluster, newCluster)) return false;
             currentCluster = newCluster;
             sectorOut = ClusterToSector(newCluster);
             offsetOut = 0;
@@ -261,7 +298,7 @@ bool FAT32::IsDirectoryEmpty(uint32_t dirCluster) {
     while (currentCluster < 0x0FFFFFF8) {
         uint32_t sector = ClusterToSector(currentCluster);
         for (int s = 0; s < bpb.sectorsPerCluster; s++) {
-            hd->Read28(sector + s, buffer, 512);
+            if (!cache->Read(sector + s, buffer)) return false;  // Unknown, so not empty
             DirectoryEntryFat32* dirents = (DirectoryEntryFat32*)buffer;
 
             for (int i = 0; i < 16; i++) {
@@ -314,50 +351,271 @@ File* FAT32::Open(char* path) {
     return file;
 }
 
-// Reads from the file's CURRENT position (offset) using the Cluster ID directly
-void FAT32::ReadStream(File* file, uint8_t* buffer, uint32_t length) {
-    if (!file) return;
+// Walks the file's cluster chain once and records it as runs of contiguous clusters
+bool FAT32::BuildRunList(File* file) {
+    file->Close();
+    file->extentsBuilt = true;
 
-    uint32_t currentCluster = file->id;
-    uint32_t offset = file->position;
     uint32_t clusterSize = bpb.sectorsPerCluster * 512;
+    uint32_t maxClusters = (file->size + clusterSize - 1) / clusterSize;
+    uint32_t capacity = 0;
+    uint32_t index = 0;
+    uint32_t cluster = file->id;
+
+    // maxClusters also bounds the walk if the chain loops back on itself
+    while (index < maxClusters && cluster >= 0x00000002 && cluster < 0x0FFFFFF8) {
+        FileExtent* last = file->extentCount ? &file->extents[file->extentCount - 1] : 0;
+        if (last && last->diskCluster + last->length == cluster) {
+            last->length++;
+        } else {
+            if (file->extentCount == capacity) {
+                capacity = capacity ? capacity * 2 : 8;
+                FileExtent* grown = new FileExtent[capacity];
+                if (!grown) return false;
+                for (uint32_t i = 0; i < file->extentCount; i++) grown[i] = file->extents[i];
+                if (file->extents) delete[] file->extents;
+                file->extents = grown;
+            }
+            FileExtent* extent = &file->extents[file->extentCount++];
+            extent->fileCluster = index;
+            extent->diskCluster = cluster;
+            extent->length = 1;
+        }
+        index++;
+        cluster = GetFATEntry(cluster);
+    }
+    return true;
+}
 
-    // Skip clusters to reach the offset
-    uint32_t clustersToSkip = offset / clusterSize;
-    uint32_t clusterOffset = offset % clusterSize;
-
-    for (int i = 0; i < clustersToSkip; i++) {
-        if (currentCluster >= 0x0FFFFFF8) return;  // End of file reached prematurely
-        currentCluster = GetFATEntry(currentCluster);
+// Binary search for the run holding file cluster 'clusterIndex'
+FileExtent* FAT32::FindExtent(File* file, uint32_t clusterIndex) {
+    uint32_t low = 0;
+    uint32_t high = file->extentCount;
+    while (low < high) {
+        uint32_t mid = (low + high) / 2;
+        FileExtent* extent = &file->extents[mid];
+        if (clusterIndex < extent->fileCluster)
+            high = mid;
+        else if (clusterIndex >= extent->fileCluster + extent->length)
+            low = mid + 1;
+        else
+            return extent;
     }
+    return 0;
+}
 
-    // Read Loop
+// Reads 'length' bytes at 'offset' from the device through the cached run-list.
+// False on a device error.
+bool FAT32::ReadDirect(File* file, uint32_t offset, uint8_t* buffer, uint32_t length) {
+    uint32_t clusterSize = bpb.sectorsPerCluster * 512;
     uint32_t bytesRead = 0;
     uint8_t secBuff[512];
 
-    while (bytesRead < length && currentCluster < 0x0FFFFFF8) {
-        uint32_t sector = ClusterToSector(currentCluster);
+    // One lookup per run, then straight through its sectors
+    while (bytesRead < length) {
+        uint32_t clusterIndex = offset / clusterSize;
+        FileExtent* extent = FindExtent(file, clusterIndex);
+        if (!extent) return true;  // End of file reached prematurely
+
+        uint32_t diskCluster = extent->diskCluster + (clusterIndex - extent->fileCluster);
+        uint32_t sector = ClusterToSector(diskCluster) + (offset % clusterSize) / 512;
+        uint32_t runEnd = ClusterToSector(extent->diskCluster + extent->length);
+
+        while (sector < runEnd && bytesRead < length) {
+            uint32_t sectorOffset = offset % 512;
+            uint32_t whole = (length - bytesRead) / 512;
+            if (whole > runEnd - sector) whole = runEnd - sector;
+            if (whole > hd->GetMaxSectors()) whole = hd->GetMaxSectors();
+
+            // Aligned whole sectors go straight into the caller's buffer, one command each
+            if (sectorOffset == 0 && whole > 0) {
+                if (!cache->ReadThrough(sector, whole, buffer + bytesRead)) return false;
+                sector += whole;
+                bytesRead += whole * 512;
+                offset += whole * 512;
+                continue;
+            }
 
-        // Read all sectors in this cluster
-        for (int i = 0; i < bpb.sectorsPerCluster; i++) {
-            hd->Read28(sector + i, secBuff, 512);
+            uint32_t chunk = 512 - sectorOffset;
+            if (chunk > length - bytesRead) chunk = length - bytesRead;
+            if (!cache->ReadThrough(sector, 1, secBuff)) return false;
+            memcpy(buffer + bytesRead, secBuff + sectorOffset, chunk);
+            sector++;
+            bytesRead += chunk;
+            offset += chunk;
+        }
+    }
+    return true;
+}
 
-            for (int b = 0; b < 512; b++) {
-                // If we are still skipping the initial offset bytes within this cluster
-                if (clusterOffset > 0) {
-                    clusterOffset--;
-                    continue;
-                }
+static void SignalReadahead(BlockRequest* request) {
+    ((Semaphore*)request->context)->Signal();
+}
 
-                if (bytesRead < length) {
-                    buffer[bytesRead++] = secBuff[b];
-                } else {
-                    return;  // Done
-                }
-            }
+// Waits for a prefetch to land and checks it against the sector cache.
+// False if there is nothing usable in the buffer.
+bool FAT32::WaitReadahead(ReadaheadBuffer* buffer) {
+    if (buffer->inFlight) {
+        if (!buffer->request.done) readaheadStats.waits++;
+        buffer->done.Wait();
+        buffer->inFlight = false;
+        if (!buffer->request.ok) buffer->length = 0;
+    }
+    if (buffer->length && !buffer->reconciled) {
+        BlockRequest* request = &buffer->request;
+        if (!cache->Reconcile(request->lba, request->count, request->data, buffer->generation) &&
+            !cache->ReadThrough(request->lba, request->count, request->data)) {
+            buffer->length = 0;
+            return false;
         }
-        currentCluster = GetFATEntry(currentCluster);
+        buffer->reconciled = true;
     }
+    return buffer->length != 0;
+}
+
+// Starts fetching the window at 'offset' into the buffer that is not 'keep'
+void FAT32::Prefetch(File* file, FileReadahead* ra, uint32_t offset, ReadaheadBuffer* keep) {
+    offset &= ~511u;
+    if (offset >= file->size) return;
+    for (int i = 0; i < 2; i++) {
+        ReadaheadBuffer* buffer = &ra->buffers[i];
+        if (buffer->length && offset >= buffer->start && offset - buffer->start < buffer->length)
+            return;  // Already there or on its way
+    }
+
+    // Without a buffer to keep, reuse the one further back in the file
+    ReadaheadBuffer* buffer = &ra->buffers[0];
+    ReadaheadBuffer* other = &ra->buffers[1];
+    if (buffer == keep || (!keep && other->start < buffer->start)) buffer = other;
+
+    // Whatever it still holds, or is still fetching, is no longer wanted
+    if (buffer->inFlight) {
+        buffer->done.Wait();
+        buffer->inFlight = false;
+    }
+    buffer->length = 0;
+    if (!buffer->data) {
+        buffer->data = new uint8_t[FAT32_READAHEAD_MAX];
+        if (!buffer->data) return;
+    }
+
+    // Only as far as the run holding 'offset' goes, so it is one device command
+    uint32_t clusterSize = bpb.sectorsPerCluster * 512;
+    uint32_t clusterIndex = offset / clusterSize;
+    FileExtent* extent = FindExtent(file, clusterIndex);
+    if (!extent) return;
+
+    uint32_t diskCluster = extent->diskCluster + (clusterIndex - extent->fileCluster);
+    uint32_t sector = ClusterToSector(diskCluster) + (offset % clusterSize) / 512;
+    uint32_t runEnd = ClusterToSector(extent->diskCluster + extent->length);
+
+    uint32_t count = ra->window / 512;
+    uint32_t left = (file->size - offset + 511) / 512;
+    if (count > left) count = left;
+    if (count > runEnd - sector) count = runEnd - sector;
+    if (count > hd->GetMaxSectors()) count = hd->GetMaxSectors();
+
+    buffer->start = offset;
+    buffer->length = count * 512;
+    buffer->inFlight = true;
+    buffer->reconciled = false;
+    buffer->generation = cache->ReadGeneration();
+
+    BlockRequest* request = &buffer->request;
+    memset(request, 0, sizeof(BlockRequest));
+    request->lba = sector;
+    request->count = count;
+    request->data = buffer->data;
+    request->write = false;
+    request->callback = SignalReadahead;
+    request->context = &buffer->done;
+    readaheadStats.prefetches++;
+    hd->Submit(request);
+
+    // The reader kept up with the last window, so ask for more next time
+    ra->window *= 2;
+    if (ra->window > FAT32_READAHEAD_MAX) ra->window = FAT32_READAHEAD_MAX;
+}
+
+// Reads from the file's CURRENT position (offset). Sequential readers are served
+// from two readahead buffers that are refilled asynchronously through hd->Submit(),
+// so the device works on the next window while the caller processes this one.
+// False on a device error.
+bool FAT32::ReadStream(File* file, uint8_t* buffer, uint32_t length) {
+    if (!file) return false;
+    if (!file->extentsBuilt) BuildRunList(file);
+
+    uint32_t offset = file->position;
+    FileReadahead* ra = file->readahead;
+    if (!ra) {
+        ra = new FileReadahead();
+        if (!ra) return ReadDirect(file, offset, buffer, length);
+        for (int i = 0; i < 2; i++) {
+            ra->buffers[i].data = 0;
+            ra->buffers[i].start = 0;
+            ra->buffers[i].length = 0;
+            ra->buffers[i].inFlight = false;
+        }
+        ra->nextOffset = 0;
+        ra->streak = 0;
+        ra->window = FAT32_READAHEAD_MIN;
+        file->readahead = ra;
+    }
+
+    bool sequential = offset == ra->nextOffset;
+    if (sequential) {
+        ra->streak++;
+    } else {
+        // A seek: start over with a small window
+        ra->streak = 0;
+        ra->window = FAT32_READAHEAD_MIN;
+    }
+    ra->nextOffset = offset + length;
+
+    uint32_t bytesRead = 0;
+    while (bytesRead < length) {
+        uint32_t at = offset + bytesRead;
+        ReadaheadBuffer* hit = 0;
+        for (int i = 0; i < 2; i++) {
+            ReadaheadBuffer* candidate = &ra->buffers[i];
+            if (candidate->length && at >= candidate->start &&
+                at - candidate->start < candidate->length)
+                hit = candidate;
+        }
+        if (!hit || !WaitReadahead(hit)) break;
+
+        uint32_t chunk = hit->start + hit->length - at;
+        if (chunk > length - bytesRead) chunk = length - bytesRead;
+        memcpy(buffer + bytesRead, hit->data + (at - hit->start), chunk);
+        bytesRead += chunk;
+        readaheadStats.hitBytes += chunk;
+
+        // Keep the other buffer filling with what follows this one
+        if (sequential) Prefetch(file, ra, hit->start + hit->length, hit);
+    }
+
+    if (bytesRead < length) {
+        if (!ReadDirect(file, offset + bytesRead, buffer + bytesRead, length - bytesRead))
+            return false;
+        readaheadStats.missBytes += length - bytesRead;
+
+        // The second sequential read in a row starts the readahead
+        if (sequential && ra->streak >= 2) Prefetch(file, ra, offset + length, 0);
+    }
+    return true;
+}
+
+void FAT32::ReleaseReadahead(File* file) {
+    FileReadahead* ra = file->readahead;
+    if (!ra) return;
+
+    // The device may still be writing into the buffers
+    for (int i = 0; i < 2; i++) {
+        if (ra->buffers[i].inFlight) ra->buffers[i].done.Wait();
+        if (ra->buffers[i].data) delete[] ra->buffers[i].data;
+    }
+    delete ra;
+    file->readahead = 0;
 }
 
 void FAT32::ListRoot() {
@@ -378,7 +636,10 @@ void FAT32::ListDir(char* path) {
     while (currentCluster < 0x0FFFFFF8) {
         uint32_t sector = ClusterToSector(currentCluster);
         for (int s = 0; s < bpb.sectorsPerCluster; s++) {
-            hd->Read28(sector + s, buffer, 512);
+            if (!cache->Read(sector + s, buffer)) {
+                printf("I/O error\n");
+                return;
+            }
             DirectoryEntryFat32* dirents = (DirectoryEntryFat32*)buffer;
 
             for (int i = 0; i < 16; i++) {
@@ -429,6 +690,7 @@ void FAT32::CreateFile(char* path) {
     }
 
     if (!FindFreeEntryInCluster(parentCluster, s, o)) {
+        Commit();
         printf("Dir Full\n");
         return;
     }
@@ -441,11 +703,20 @@ void FAT32::CreateFile(char* path) {
     newEntry.firstClusterHi = (newCluster >> 16) & 0xFFFF;
 
     uint8_t buffer[512];
-    hd->Read28(s, buffer, 512);
+    if (!cache->Read(s, buffer)) {
+        Commit();
+        printf("I/O error\n");
+        return;
+    }
     uint8_t* dest = buffer + o;
     uint8_t* src = (uint8_t*)&newEntry;
     for (int i = 0; i < sizeof(DirectoryEntryFat32); i++) dest[i] = src[i];
-    hd->Write28(s, buffer, 512);
+    if (!cache->Write(s, buffer, FAT32_PASS_DIR)) {
+        Commit();
+        printf("I/O error\n");
+        return;
+    }
+    Commit();
 
     printf("Created.\n");
 }
@@ -473,14 +744,23 @@ void FAT32::DeleteFile(char* path) {
         return;
     }
 
-    // Mark Deleted
+    // Mark Deleted. The entry has to be gone on disk before its clusters can be
+    // handed out again, which the pass order alone would not guarantee.
     uint8_t buffer[512];
-    hd->Read28(s, buffer, 512);
+    if (!cache->Read(s, buffer)) {
+        printf("I/O error\n");
+        return;
+    }
     buffer[o] = 0xE5;
-    hd->Write28(s, buffer, 512);
+    if (!cache->Write(s, buffer, FAT32_PASS_DIR)) {
+        printf("I/O error\n");
+        return;
+    }
+    cache->Flush();
 
     uint32_t startCluster = ((uint32_t)entry.firstClusterHi << 16) | entry.firstClusterLow;
     if (startCluster != 0) FreeChain(startCluster);
+    Commit();
 
     printf("Done.\n");
 }
@@ -514,12 +794,21 @@ void FAT32::DeleteDirectory(char* path) {
         return;
     }
 
+    // Gone on disk before the clusters are freed, as in DeleteFile
     uint8_t buffer[512];
-    hd->Read28(s, buffer, 512);
+    if (!cache->Read(s, buffer)) {
+        printf("I/O error\n");
+        return;
+    }
     buffer[o] = 0xE5;
-    hd->Write28(s, buffer, 512);
+    if (!cache->Write(s, buffer, FAT32_PASS_DIR)) {
+        printf("I/O error\n");
+        return;
+    }
+    cache->Flush();
 
     if (startCluster != 0) FreeChain(startCluster);
+    Commit();
 
     printf("Done.\n");
 }
@@ -542,7 +831,10 @@ void FAT32::MakeDirectory(char* path) {
     uint32_t newCluster = AllocateCluster();
     if (newCluster == 0) return;
 
-    if (!FindFreeEntryInCluster(parentCluster, s, o)) return;
+    if (!FindFreeEntryInCluster(parentCluster, s, o)) {
+        Commit();
+        return;
+    }
 
     DirectoryEntryFat32 newEntry;
     memset(&newEntry, 0, sizeof(DirectoryEntryFat32));
@@ -551,17 +843,11 @@ void FAT32::MakeDirectory(char* path) {
     newEntry.firstClusterLow = newCluster & 0xFFFF;
     newEntry.firstClusterHi = (newCluster >> 16) & 0xFFFF;
 
-    uint8_t buffer[512];
-    hd->Read28(s, buffer, 512);
-    uint8_t* dest = buffer + o;
-    uint8_t* src = (uint8_t*)&newEntry;
-    for (int i = 0; i < sizeof(DirectoryEntryFat32); i++) dest[i] = src[i];
-    hd->Write28(s, buffer, 512);
-
-    // Init . and ..
-    memset(buffer, 0, 512);
-    DirectoryEntryFat32* dot = (DirectoryEntryFat32*)buffer;
-    DirectoryEntryFat32* dotdot = (DirectoryEntryFat32*)(buffer + sizeof(DirectoryEntryFat32));
+    // Init . and .. (the new cluster is written whole, before the entry that points at it)
+    DirectoryEntryFat32 dots[2];
+    memset(dots, 0, sizeof(dots));
+    DirectoryEntryFat32* dot = &dots[0];
+    DirectoryEntryFat32* dotdot = &dots[1];
 
     memset(dot->name, ' ', 11);
     dot->name[0] = '.';
@@ -577,7 +863,27 @@ void FAT32::MakeDirectory(char* path) {
     dotdot->firstClusterLow = parentCluster & 0xFFFF;
     dotdot->firstClusterHi = (parentCluster >> 16) & 0xFFFF;
 
-    hd->Write28(ClusterToSector(newCluster), buffer, 512);
+    if (!WriteCluster(newCluster, (uint8_t*)dots, sizeof(dots))) {
+        Commit();
+        printf("I/O error\n");
+        return;
+    }
+
+    uint8_t buffer[512];
+    if (!cache->Read(s, buffer)) {
+        Commit();
+        printf("I/O error\n");
+        return;
+    }
+    uint8_t* dest = buffer + o;
+    uint8_t* src = (uint8_t*)&newEntry;
+    for (int i = 0; i < sizeof(DirectoryEntryFat32); i++) dest[i] = src[i];
+    if (!cache->Write(s, buffer, FAT32_PASS_DIR)) {
+        Commit();
+        printf("I/O error\n");
+        return;
+    }
+    Commit();
     printf("Done.\n");
 }
 
@@ -592,19 +898,25 @@ void FAT32::Format() {
     fatStartArr[1] = 0x0FFFFFFF;
     fatStartArr[2] = 0x0FFFFFFF;
 
-    hd->Write28(this->fatStart, zeros, 512);
+    bool ok = cache->Write(this->fatStart, zeros, FAT32_PASS_FAT);
 
     memset(zeros, 0, 512);
-    for (int i = 1; i < 32; i++) {
-        hd->Write28(this->fatStart + i, zeros, 512);
+    for (int i = 1; i < 32 && ok; i++) {
+        ok = cache->Write(this->fatStart + i, zeros, FAT32_PASS_FAT);
     }
 
     uint32_t rootSec = ClusterToSector(bpb.rootCluster);
     memset(zeros, 0, 512);
-    for (int i = 0; i < bpb.sectorsPerCluster; i++) {
-        hd->Write28(rootSec + i, zeros, 512);
+    for (int i = 0; i < bpb.sectorsPerCluster && ok; i++) {
+        ok = cache->Write(rootSec + i, zeros, FAT32_PASS_DIR);
     }
+    cache->Flush();
+    nextFree = 2;
 
+    if (!ok) {
+        printf("I/O error\n");
+        return;
+    }
     printf("Done. Please Reboot.\n");
 }
 
@@ -629,10 +941,27 @@ void FAT32::ReadFile(char* path, uint8_t* buffer, uint32_t length) {
     uint32_t bytesRead = 0;
     uint8_t secBuff[512];
 
+    uint32_t clusterSize = bpb.sectorsPerCluster * 512;
+
     while (bytesRead < length && currentCluster < 0x0FFFFFF8) {
         uint32_t sector = ClusterToSector(currentCluster);
+
+        // Whole cluster in one command
+        if (length - bytesRead >= clusterSize) {
+            if (!cache->ReadThrough(sector, bpb.sectorsPerCluster, buffer + bytesRead)) {
+                printf("Read error\n");
+                return;
+            }
+            bytesRead += clusterSize;
+            currentCluster = GetFATEntry(currentCluster);
+            continue;
+        }
+
         for (int i = 0; i < bpb.sectorsPerCluster; i++) {
-            hd->Read28(sector + i, secBuff, 512);
+            if (!cache->ReadThrough(sector + i, 1, secBuff)) {
+                printf("Read error\n");
+                return;
+            }
             for (int b = 0; b < 512; b++) {
                 if (bytesRead < length)
                     buffer[bytesRead++] = secBuff[b];
@@ -663,38 +992,46 @@ void FAT32::WriteFile(char* path, uint8_t* buffer, uint32_t length) {
     }
 
     // Allocate First Cluster if Empty
-    uint32_t currentCluster = ((uint32_t)entry.firstClusterHi << 16) | entry.firstClusterLow;
-    if (currentCluster == 0) {
-        currentCluster = AllocateCluster();
-        if (currentCluster == 0) return;
-
-        entry.firstClusterLow = currentCluster & 0xFFFF;
-        entry.firstClusterHi = (currentCluster >> 16) & 0xFFFF;
-
-        uint8_t dirBuff[512];
-        hd->Read28(dirSector, dirBuff, 512);
-        DirectoryEntryFat32* onDisk = (DirectoryEntryFat32*)(dirBuff + dirOffset);
-        onDisk->firstClusterLow = entry.firstClusterLow;
-        onDisk->firstClusterHi = entry.firstClusterHi;
-        hd->Write28(dirSector, dirBuff, 512);
+    uint32_t firstCluster = ((uint32_t)entry.firstClusterHi << 16) | entry.firstClusterLow;
+    if (firstCluster == 0) {
+        firstCluster = AllocateCluster();
+        if (firstCluster == 0) {
+            Commit();
+            return;
+        }
     }
 
-    // Write Data
+    // Write Data: runs of consecutive whole clusters in one command each (the
+    // allocator hands them out in order), the partial last cluster zero padded.
+    // The chain is extended in the FAT as we go.
+    uint32_t clusterSize = bpb.sectorsPerCluster * 512;
+    uint32_t maxRun = hd->GetMaxSectors() / bpb.sectorsPerCluster;
+    if (maxRun == 0) maxRun = 1;
+    uint32_t currentCluster = firstCluster;
     uint32_t bytesWritten = 0;
-    uint8_t secBuff[512];
+    uint32_t runStart = 0;
+    uint32_t runLength = 0;
+    uint32_t runOffset = 0;
+    bool ok = true;
 
     while (bytesWritten < length) {
-        uint32_t sector = ClusterToSector(currentCluster);
-
-        for (int i = 0; i < bpb.sectorsPerCluster; i++) {
-            memset(secBuff, 0, 512);
-            for (int b = 0; b < 512; b++) {
-                if (bytesWritten < length) {
-                    secBuff[b] = buffer[bytesWritten++];
-                }
+        if (length - bytesWritten >= clusterSize) {
+            if (runLength > 0 && (currentCluster != runStart + runLength || runLength == maxRun)) {
+                ok = cache->WriteThrough(ClusterToSector(runStart),
+                                         runLength * bpb.sectorsPerCluster, buffer + runOffset);
+                runLength = 0;
+                if (!ok) break;
+            }
+            if (runLength == 0) {
+                runStart = currentCluster;
+                runOffset = bytesWritten;
             }
-            hd->Write28(sector + i, secBuff, 512);
-            if (bytesWritten >= length) break;
+            runLength++;
+            bytesWritten += clusterSize;
+        } else {
+            ok = WriteCluster(currentCluster, buffer + bytesWritten, length - bytesWritten);
+            if (!ok) break;
+            bytesWritten = length;
         }
 
         if (bytesWritten >= length) break;
@@ -703,17 +1040,40 @@ void FAT32::WriteFile(char* path, uint8_t* buffer, uint32_t length) {
         if (next >= 0x0FFFFFF8) {
             next = AllocateCluster();
             if (next == 0) break;  // Disk Full
-            SetFATEntry(currentCluster, next);
+            if (!SetFATEntry(currentCluster, next)) break;
         }
         currentCluster = next;
     }
+    if (ok && runLength > 0) {
+        ok = cache->WriteThrough(ClusterToSector(runStart), runLength * bpb.sectorsPerCluster,
+                                 buffer + runOffset);
+    }
+
+    // The entry must never point at data that did not reach the disk
+    if (!ok) {
+        Commit();
+        printf("I/O error\n");
+        return;
+    }
 
-    // Update File Size
+    // One update of the entry for the first cluster and the size, behind the data
+    // and the FAT changes it describes
     uint8_t dirBuff[512];
-    hd->Read28(dirSector, dirBuff, 512);
+    if (!cache->Read(dirSector, dirBuff)) {
+        Commit();
+        printf("I/O error\n");
+        return;
+    }
     DirectoryEntryFat32* onDisk = (DirectoryEntryFat32*)(dirBuff + dirOffset);
-    onDisk->size = length;
-    hd->Write28(dirSector, dirBuff, 512);
+    onDisk->firstClusterLow = firstCluster & 0xFFFF;
+    onDisk->firstClusterHi = (firstCluster >> 16) & 0xFFFF;
+    onDisk->size = bytesWritten;
+    if (!cache->Write(dirSector, dirBuff, FAT32_PASS_DIR)) {
+        Commit();
+        printf("I/O error\n");
+        return;
+    }
+    Commit();
 
     printf("Done.\n");
 }
@@ -740,8 +1100,7 @@ uint32_t FAT32::GetFileSize(char* path) {
     return entry.size;
 }
 
-void FAT32::FormatRaw(AdvancedTechnologyAttachment* hd, uint32_t startSector,
-                      uint32_t sizeSectors) {
+void FAT32::FormatRaw(BlockDevice* hd, uint32_t startSector, uint32_t sizeSectors) {
     printf("Formatting Raw Partition at %d (Size: %d)... ", startSector, sizeSectors);
 
     // Calculate FAT32 Geometry
@@ -800,7 +1159,7 @@ void FAT32::FormatRaw(AdvancedTechnologyAttachment* hd, uint32_t startSector,
     for (int i = 0; i < 8; i++) bpb->fileSystemType[i] = sysType[i];
 
     // Write Boot Sector
-    hd->Write28(startSector, buffer, 512);
+    hd->WriteSectors(startSector, 1, buffer);
 
     // Initialize FAT Tables
     // Only clear the first few sectors to ensure chains are broken.
@@ -813,15 +1172,15 @@ void FAT32::FormatRaw(AdvancedTechnologyAttachment* hd, uint32_t startSector,
     fatEntries[2] = 0x0FFFFFFF;  // EOC (End of Root Dir Chain)
 
     // Write start of FAT 1
-    hd->Write28(startSector + reserved, buffer, 512);
+    hd->WriteSectors(startSector + reserved, 1, buffer);
     // Write start of FAT 2
-    hd->Write28(startSector + reserved + sectorsPerFat, buffer, 512);
+    hd->WriteSectors(startSector + reserved + sectorsPerFat, 1, buffer);
 
     // Clear following sectors
     memset(buffer, 0, 512);
     for (int i = 1; i < 16; i++) {
-        hd->Write28(startSector + reserved + i, buffer, 512);
-        hd->Write28(startSector + reserved + sectorsPerFat + i, buffer, 512);
+        hd->WriteSectors(startSector + reserved + i, 1, buffer);
+        hd->WriteSectors(startSector + reserved + sectorsPerFat + i, 1, buffer);
     }
 
     // Clear Root Directory Cluster (Cluster 2)
@@ -829,8 +1188,9 @@ void FAT32::FormatRaw(AdvancedTechnologyAttachment* hd, uint32_t startSector,
     uint32_t dataStart = startSector + reserved + (sectorsPerFat * fats);
     // Cluster 2 is the very first cluster in Data Area
     for (int i = 0; i < secPerClus; i++) {
-        hd->Write28(dataStart + i, buffer, 512);
+        hd->WriteSectors(dataStart + i, 1, buffer);
     }
+    hd->Flush();
 
     printf("Done.\n");
 }
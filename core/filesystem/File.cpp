@@ -15,6 +15,10 @@ File::File() {
     this->position = 0;
     this->filesystem = 0;
     this->flags = 0;
+    this->extents = 0;
+    this->extentCount = 0;
+    this->extentsBuilt = false;
+    this->readahead = 0;
     for (int i = 0; i < 128; i++) this->name[i] = 0;
 }
 
@@ -34,7 +38,7 @@ int File::Read(uint8_t* buffer, uint32_t length) {
         length = this->size - this->position;
     }
 
-    this->filesystem->ReadStream(this, buffer, length);
+    if (!this->filesystem->ReadStream(this, buffer, length)) return -1;  // Device error
 
     this->position += length;
     return length;
@@ -48,5 +52,10 @@ void File::Seek(uint32_t pos) {
 void File::Write(uint8_t* buffer, uint32_t length) {}
 
 void File::Close() {
-    // Cleanup
+    // Cleanup (may run twice: explicit Close() followed by delete)
+    if (this->readahead && this->filesystem) this->filesystem->ReleaseReadahead(this);
+    if (this->extents) delete[] this->extents;
+    this->extents = 0;
+    this->extentCount = 0;
+    this->extentsBuilt = false;
 }
@@ -0,0 +1,90 @@
+/**
+ * @file        FileTable.cpp
+ * @brief       Per-process file descriptor table
+ *
+ * @date        18/10/2026
+ * @version     1.0.0
+ */
+
+#include <core/filesystem/FAT32.h>
+#include <core/filesystem/FileTable.h>
+
+FileTable::FileTable() {
+    for (int i = 0; i < FD_MAX; i++) files[i] = nullptr;
+}
+
+FileTable::~FileTable() {
+    for (int i = FD_FIRST_FILE; i < FD_MAX; i++) {
+        if (files[i]) {
+            files[i]->Close();
+            delete files[i];
+            files[i] = nullptr;
+        }
+    }
+}
+
+int32_t FileTable::Open(FAT32* fs, char* path, uint32_t& sizeOut) {
+    if (!fs || !path) return FD_EINVAL;
+
+    MutexGuard guard(lock);
+    int32_t fd = FD_FIRST_FILE;
+    while (fd < FD_MAX && files[fd]) fd++;
+    if (fd == FD_MAX) return FD_EMFILE;
+
+    File* file = fs->Open(path);
+    if (!file) return FD_ENOENT;
+    if (file->flags & 1) {
+        delete file;
+        return FD_EISDIR;
+    }
+
+    files[fd] = file;
+    sizeOut = file->size;
+    return fd;
+}
+
+int32_t FileTable::Read(int32_t fd, uint8_t* buffer, uint32_t length) {
+    MutexGuard guard(lock);
+    File* file = Get(fd);
+    if (!file) return FD_EBADF;
+    if (length > 0x7FFFFFFF) length = 0x7FFFFFFF;
+    int32_t read = file->Read(buffer, length);
+    return read < 0 ? FD_EIO : read;
+}
+
+int32_t FileTable::Seek(int32_t fd, int32_t offset, uint32_t whence) {
+    MutexGuard guard(lock);
+    File* file = Get(fd);
+    if (!file) return FD_EBADF;
+
+    int64_t base;
+    switch (whence) {
+        case FD_SEEK_SET:
+            base = 0;
+            break;
+        case FD_SEEK_CUR:
+            base = file->position;
+            break;
+        case FD_SEEK_END:
+            base = file->size;
+            break;
+        default:
+            return FD_EINVAL;
+    }
+
+    int64_t target = base + offset;
+    if (target < 0) return FD_EINVAL;
+    // File::Seek clamps to the size, there is nothing to read past the end
+    file->Seek(target > file->size ? file->size : (uint32_t)target);
+    return (int32_t)file->position;
+}
+
+int32_t FileTable::Close(int32_t fd) {
+    MutexGuard guard(lock);
+    File* file = Get(fd);
+    if (!file) return FD_EBADF;
+    files[fd] = nullptr;
+    file->Close();
+    delete file;
+    return 0;
+}
@@ -0,0 +1,370 @@
+/**
+ * @file        SectorCache.cpp
+ * @brief       Hashed LRU sector cache between FAT32 and the block device
+ *
+ * @date        18/10/2026
+ * @version     1.0.0
+ */
+
+#include <core/filesystem/SectorCache.h>
+#include <core/scheduler.h>
+#include <debug.h>
+
+SectorCache::SectorCache(BlockDevice* hd, uint32_t blocks) {
+    if (blocks < 8) blocks = 8;
+    this->hd = hd;
+    this->blockCount = blocks;
+
+    uint32_t bucketCount = 1;
+    while (bucketCount < blocks) bucketCount <<= 1;
+    this->bucketMask = bucketCount - 1;
+
+    this->blocks = new Block[blocks];
+    this->storage = new uint8_t[blocks * SECTOR_CACHE_SECTOR_SIZE];
+    this->buckets = new Block*[bucketCount];
+    this->order = new Block*[blocks];
+    this->staging = new uint8_t[SECTOR_CACHE_MAX_RUN * SECTOR_CACHE_SECTOR_SIZE];
+    if (!this->blocks || !this->storage || !this->buckets || !this->order || !this->staging) {
+        HALT("CRITICAL: Failed to allocate the sector cache!\n");
+    }
+    for (uint32_t i = 0; i < bucketCount; i++) buckets[i] = nullptr;
+
+    // Every block starts invalid on the LRU list, so the first misses take them in order
+    lruHead = nullptr;
+    lruTail = nullptr;
+    for (uint32_t i = 0; i < blocks; i++) {
+        Block* block = &this->blocks[i];
+        block->lba = 0;
+        block->valid = false;
+        block->dirty = false;
+        block->pass = 0;
+        block->hashNext = nullptr;
+        block->data = storage + i * SECTOR_CACHE_SECTOR_SIZE;
+        block->lruPrev = lruTail;
+        block->lruNext = nullptr;
+        if (lruTail)
+            lruTail->lruNext = block;
+        else
+            lruHead = block;
+        lruTail = block;
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    stats.blocks = blocks;
+    generation = 0;
+    driveDirty = false;
+    flusherStarted = false;
+    DEBUG_LOG("SectorCache: %d blocks, %d buckets", blocks, bucketCount);
+}
+
+SectorCache::~SectorCache() {
+    Flush();
+    delete[] staging;
+    delete[] order;
+    delete[] buckets;
+    delete[] storage;
+    delete[] blocks;
+}
+
+// --- Internal helpers, all called with 'lock' held ---
+SectorCache::Block* SectorCache::Lookup(uint32_t lba) {
+    for (Block* block = buckets[Hash(lba)]; block; block = block->hashNext) {
+        if (block->lba == lba) return block;
+    }
+    return nullptr;
+}
+
+void SectorCache::HashInsert(Block* block) {
+    uint32_t bucket = Hash(block->lba);
+    block->hashNext = buckets[bucket];
+    buckets[bucket] = block;
+}
+
+void SectorCache::HashRemove(Block* block) {
+    Block** link = &buckets[Hash(block->lba)];
+    while (*link) {
+        if (*link == block) {
+            *link = block->hashNext;
+            block->hashNext = nullptr;
+            return;
+        }
+        link = &(*link)->hashNext;
+    }
+}
+
+// Move a block to the head of the LRU list
+void SectorCache::Touch(Block* block) {
+    if (block == lruHead) return;
+
+    block->lruPrev->lruNext = block->lruNext;
+    if (block->lruNext)
+        block->lruNext->lruPrev = block->lruPrev;
+    else
+        lruTail = block->lruPrev;
+
+    block->lruPrev = nullptr;
+    block->lruNext = lruHead;
+    lruHead->lruPrev = block;
+    lruHead = block;
+}
+
+// Write 'count' dirty blocks with consecutive LBAs in one command. On a device
+// error they stay dirty for the next attempt.
+void SectorCache::WriteRun(Block** run, uint32_t count) {
+    bool ok;
+    if (count == 1) {
+        ok = hd->WriteSectors(run[0]->lba, 1, run[0]->data);
+    } else {
+        for (uint32_t i = 0; i < count; i++)
+            memcpy(staging + i * SECTOR_CACHE_SECTOR_SIZE, run[i]->data, SECTOR_CACHE_SECTOR_SIZE);
+        ok = hd->WriteSectors(run[0]->lba, count, staging);
+    }
+    if (!ok) {
+        DEBUG_LOG("SectorCache: write-back of %d sector(s) at %d failed", count, run[0]->lba);
+        return;
+    }
+
+    for (uint32_t i = 0; i < count; i++) run[i]->dirty = false;
+    driveDirty = true;
+    generation++;
+    stats.writebacks += count;
+    stats.writeRuns++;
+    stats.dirty -= count;
+}
+
+// Pass by pass, with a drive flush in front of each one so nothing written
+// earlier (including WriteThrough data) can land after it
+void SectorCache::FlushLocked() {
+    uint32_t maxRun = hd->GetMaxSectors();
+    if (maxRun > SECTOR_CACHE_MAX_RUN) maxRun = SECTOR_CACHE_MAX_RUN;
+
+    for (uint32_t pass = 0; pass < SECTOR_CACHE_PASSES && stats.dirty > 0; pass++) {
+        // Insertion sort by LBA: the dirty set is small
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < blockCount; i++) {
+            Block* block = &blocks[i];
+            if (!block->valid || !block->dirty || block->pass != pass) continue;
+            uint32_t j = count++;
+            while (j > 0 && order[j - 1]->lba > block->lba) {
+                order[j] = order[j - 1];
+                j--;
+            }
+            order[j] = block;
+        }
+        if (count == 0) continue;
+
+        if (driveDirty) {
+            hd->Flush();
+            driveDirty = false;
+        }
+
+        // Consecutive sectors go out together
+        for (uint32_t start = 0; start < count;) {
+            uint32_t end = start + 1;
+            while (end < count && end - start < maxRun &&
+                   order[end]->lba == order[start]->lba + (end - start))
+                end++;
+            WriteRun(order + start, end - start);
+            start = end;
+        }
+    }
+
+    if (driveDirty) {
+        hd->Flush();
+        driveDirty = false;
+    }
+}
+
+// Recycle the least recently used clean block for 'lba'. The caller fills its data.
+// Null when every block is dirty and the device refuses to take any of them back.
+SectorCache::Block* SectorCache::Claim(uint32_t lba) {
+    Block* block = lruTail;
+    while (block && block->valid && block->dirty) block = block->lruPrev;
+    if (!block) {
+        // All dirty: write them back in order rather than one out of turn
+        FlushLocked();
+        block = lruTail;
+        while (block && block->valid && block->dirty) block = block->lruPrev;
+        if (!block) {
+            // Dropping one would lose data the filesystem already counts as written
+            DEBUG_LOG("SectorCache: no clean block for sector %d, write-back failing", lba);
+            return nullptr;
+        }
+    }
+
+    if (block->valid) {
+        HashRemove(block);
+        stats.evictions++;
+    }
+    block->lba = lba;
+    block->valid = true;
+    block->dirty = false;
+    HashInsert(block);
+    Touch(block);
+    return block;
+}
+
+void SectorCache::Flusher(void* arg) {
+    SectorCache* self = (SectorCache*)arg;
+    while (true) {
+        self->wake.Wait(SECTOR_CACHE_FLUSH_INTERVAL_MS);
+        self->Flush();
+    }
+}
+
+// --- Public API ---
+void SectorCache::Start(Scheduler* scheduler) {
+    if (flusherStarted || !scheduler) return;
+    scheduler->CreateProcess(true, Flusher, this);
+    flusherStarted = true;
+}
+
+bool SectorCache::Read(uint32_t lba, uint8_t* out) {
+    MutexGuard guard(lock);
+
+    Block* block = Lookup(lba);
+    if (block) {
+        stats.hits++;
+        Touch(block);
+    } else {
+        stats.misses++;
+        block = Claim(lba);
+        if (!block) {
+            memset(out, 0, SECTOR_CACHE_SECTOR_SIZE);
+            return false;
+        }
+        if (!hd->ReadSectors(lba, 1, block->data)) {
+            // Nothing valid to keep: drop the block rather than serve (or write back) junk
+            HashRemove(block);
+            block->valid = false;
+            memset(out, 0, SECTOR_CACHE_SECTOR_SIZE);
+            DEBUG_LOG("SectorCache: read of sector %d failed", lba);
+            return false;
+        }
+    }
+    memcpy(out, block->data, SECTOR_CACHE_SECTOR_SIZE);
+    return true;
+}
+
+bool SectorCache::Write(uint32_t lba, const uint8_t* data, uint32_t pass) {
+    MutexGuard guard(lock);
+
+    // Whole-sector write, so a miss needs no read from the disk
+    Block* block = Lookup(lba);
+    if (block)
+        Touch(block);
+    else
+        block = Claim(lba);
+    if (!block) return false;
+
+    memcpy(block->data, data, SECTOR_CACHE_SECTOR_SIZE);
+    if (!block->dirty) {
+        block->dirty = true;
+        block->pass = pass;
+        stats.dirty++;
+        if (flusherStarted && stats.dirty == blockCount / 2) wake.Signal();
+    } else if (pass > block->pass) {
+        block->pass = pass;
+    }
+    return true;
+}
+
+bool SectorCache::ReadThrough(uint32_t lba, uint32_t count, uint8_t* out) {
+    // The transfer runs without the lock, so other threads' reads and writes can
+    // queue at the device alongside it
+    uint32_t before;
+    do {
+        before = ReadGeneration();
+        if (!hd->ReadSectors(lba, count, out)) {
+            DEBUG_LOG("SectorCache: read of %d sector(s) at %d failed", count, lba);
+            return false;
+        }
+    } while (!Reconcile(lba, count, out, before));
+    return true;
+}
+
+uint32_t SectorCache::ReadGeneration() {
+    MutexGuard guard(lock);
+    return generation;
+}
+
+bool SectorCache::Reconcile(uint32_t lba, uint32_t count, uint8_t* data, uint32_t before) {
+    MutexGuard guard(lock);
+
+    // A write during the transfer may have put newer data on the disk (or evicted
+    // a block holding it) that the read missed
+    if (generation != before) return false;
+
+    // Cached copies are never older than the disk (they may be dirty)
+    for (uint32_t i = 0; i < count; i++) {
+        Block* block = Lookup(lba + i);
+        if (block) {
+            stats.hits++;
+            memcpy(data + i * SECTOR_CACHE_SECTOR_SIZE, block->data, SECTOR_CACHE_SECTOR_SIZE);
+        } else {
+            stats.bypassReads++;
+        }
+    }
+    return true;
+}
+
+bool SectorCache::WriteThrough(uint32_t lba, uint32_t count, const uint8_t* data) {
+    {
+        MutexGuard guard(lock);
+
+        // A cached copy (e.g. the zeroes AllocateCluster left behind) must not be
+        // written back over the new data later
+        for (uint32_t i = 0; i < count; i++) {
+            Block* block = Lookup(lba + i);
+            if (!block) continue;
+            memcpy(block->data, data + i * SECTOR_CACHE_SECTOR_SIZE, SECTOR_CACHE_SECTOR_SIZE);
+            if (block->dirty) {
+                block->dirty = false;
+                stats.dirty--;
+            }
+        }
+    }
+
+    // Unlocked, like ReadThrough
+    bool ok = hd->WriteSectors(lba, count, data);
+
+    MutexGuard guard(lock);
+    generation++;
+    driveDirty = true;
+    if (ok) return true;
+
+    // The disk may not have the new data: cached copies hold it, so they must be
+    // written back later rather than dropped as clean
+    DEBUG_LOG("SectorCache: write of %d sector(s) at %d failed", count, lba);
+    for (uint32_t i = 0; i < count; i++) {
+        Block* block = Lookup(lba + i);
+        if (!block || block->dirty) continue;
+        block->dirty = true;
+        block->pass = 0;
+        stats.dirty++;
+    }
+    return false;
+}
+
+void SectorCache::Flush() {
+    MutexGuard guard(lock);
+    FlushLocked();
+}
+
+void SectorCache::Invalidate() {
+    Flush();
+
+    MutexGuard guard(lock);
+    for (uint32_t i = 0; i < blockCount; i++) {
+        if (blocks[i].valid && blocks[i].dirty)
+            DEBUG_LOG("SectorCache: dropping sector %d, its write-back failed", blocks[i].lba);
+        if (blocks[i].valid) HashRemove(&blocks[i]);
+        blocks[i].valid = false;
+        blocks[i].dirty = false;
+    }
+}
+
+void SectorCache::GetStats(SectorCacheStats* out) {
+    MutexGuard guard(lock);
+    *out = stats;
+}
@@ -10,18 +10,20 @@
 
 FAT32* MSDOSPartitionTable::partitions[4] = {0, 0, 0, 0};
 MSDOSPartitionTable* MSDOSPartitionTable::activeInstance = nullptr;
+uint32_t MSDOSPartitionTable::partitionsCounter = 0;
 
-MSDOSPartitionTable::MSDOSPartitionTable(AdvancedTechnologyAttachment* ata) {
-    this->ata = ata;
-    this->activeInstance = this;
+MSDOSPartitionTable::MSDOSPartitionTable(BlockDevice* disk) {
+    this->disk = disk;
+    // The first table read is the boot disk's
+    if (!activeInstance) this->activeInstance = this;
 };
 MSDOSPartitionTable::~MSDOSPartitionTable(){};
 
 void MSDOSPartitionTable::Initialize() {
     printf("Initializing Disk...\n");
 
-    // Get Drive Size from ATA
-    uint32_t totalSectors = ata->GetSizeInSectors();
+    // Get Drive Size
+    uint32_t totalSectors = disk->GetSizeInSectors();
     if (totalSectors == 0) {
         printf("Error: Could not identify drive size.\n");
         return;
@@ -74,23 +76,54 @@ void MSDOSPartitionTable::Initialize() {
     }
 
     // Write MBR
-    ata->Write28(0, (uint8_t*)&mbr, 512);
+    disk->WriteSectors(0, 1, (uint8_t*)&mbr);
 
     // 5. FORMAT Partitions
-    FAT32::FormatRaw(ata, p1_start, p1_size);
-    FAT32::FormatRaw(ata, p2_start, p2_size);
+    FAT32::FormatRaw(disk, p1_start, p1_size);
+    FAT32::FormatRaw(disk, p2_start, p2_size);
 
     printf("Initialization Complete.\n");
 
     return;
 }
 
-void MSDOSPartitionTable::ReadPartitions() {
+FAT32* MSDOSPartitionTable::Mount(BlockDevice* disk, uint32_t startLBA) {
+    if (partitionsCounter >= 4) {
+        printf("No free mount slot, skipping.\n");
+        return nullptr;
+    }
+    FAT32* fat32 = new FAT32(disk, startLBA);
+    if (!fat32) {
+        HALT("CRITICAL: Failed to allocate FAT32 filesystem!\n");
+    }
+    partitions[partitionsCounter++] = fat32;
+    return fat32;
+}
+
+void MSDOSPartitionTable::StartFlushers(Scheduler* scheduler) {
+    for (uint32_t i = 0; i < partitionsCounter; i++) partitions[i]->StartFlusher(scheduler);
+}
+
+void MSDOSPartitionTable::SyncAll() {
+    for (uint32_t i = 0; i < partitionsCounter; i++) partitions[i]->Sync();
+}
+
+void MSDOSPartitionTable::ReadPartitions(bool initializeBlank) {
+    // FAT32 and the MBR layout here assume 512-byte sectors
+    if (disk->GetSectorSize() != BLOCK_SECTOR_SIZE) {
+        printf("Unsupported sector size %d, skipping disk.\n", disk->GetSectorSize());
+        return;
+    }
+
     MasterBootRecord mbr;
-    ata->Read28(0, (uint8_t*)&mbr, sizeof(MasterBootRecord));
+    disk->ReadSectors(0, 1, (uint8_t*)&mbr);
 
-    // Check Signature. If invalid, Initialize drive.
+    // Check Signature. If invalid, Initialize drive (only ever the boot disk).
     if (mbr.magicnumber != 0xAA55) {
+        if (!initializeBlank) {
+            printf("No MBR, skipping disk.\n");
+            return;
+        }
         printf("MBR Invalid. Initializing Drive...\n");
         Initialize();
         printf("Please copy the OS data files using 'make hdd' command.\n");
@@ -109,11 +142,7 @@ void MSDOSPartitionTable::ReadPartitions() {
         // Mount FAT32
         if (mbr.primaryPartition[i].partition_id == 0x0C ||
             mbr.primaryPartition[i].partition_id == 0x0B) {
-            FAT32* fat32 = new FAT32(ata, mbr.primaryPartition[i].start_lba);
-            if (!fat32) {
-                HALT("CRITICAL: Failed to allocate FAT32 filesystem!\n");
-            }
-            this->partitions[partitionsCounter++] = fat32;
+            Mount(disk, mbr.primaryPartition[i].start_lba);
 
             /*             fat32.CreateFile("file1.txt");
                         fat32.MakeDirectory("DIR1");
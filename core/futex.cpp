@@ -0,0 +1,97 @@
+/**
+ * @file        futex.cpp
+ * @brief       Futex wait/wake keyed on physical address
+ *
+ * @date        18/10/2026
+ * @version     1.0.0
+ */
+
+#include <core/futex.h>
+#include <core/paging.h>
+#include <core/scheduler.h>
+
+// User space window (programs link at 0x10001000, stacks end at 0xC0000000)
+#define FUTEX_USER_MIN 0x10000000
+#define FUTEX_USER_MAX 0xC0000000
+
+LinkedList<Futex::FutexQueue*> Futex::buckets[FUTEX_HASH_BUCKETS];
+Spinlock Futex::tableLock("futex-table", LOCK_LEVEL_FUTEX);
+
+static inline uint32_t HashKey(uint32_t key) {
+    // Words are 4-byte aligned, mix in the page number
+    return ((key >> 2) ^ (key >> 12)) % FUTEX_HASH_BUCKETS;
+}
+
+bool Futex::Translate(uint32_t* directory, uint32_t userAddr, uint32_t& key) {
+    if (userAddr & 0x3) return false;
+    if (userAddr < FUTEX_USER_MIN || userAddr >= FUTEX_USER_MAX) return false;
+    key = g_paging->GetPhysicalAddress(directory, userAddr);
+    return key != 0;
+}
+
+Futex::FutexQueue* Futex::Acquire(uint32_t key, bool create) {
+    SpinlockGuard guard(tableLock);
+    LinkedList<FutexQueue*>& bucket = buckets[HashKey(key)];
+
+    FutexQueue* fq = bucket.Find([key](FutexQueue* q) { return q->key == key; });
+    if (!fq) {
+        if (!create) return nullptr;
+        fq = new FutexQueue();
+        if (!fq) return nullptr;
+        fq->key = key;
+        fq->refs = 0;
+        bucket.PushBack(fq);
+    }
+    fq->refs++;
+    return fq;
+}
+
+void Futex::Release(FutexQueue* fq) {
+    SpinlockGuard guard(tableLock);
+    if (--fq->refs > 0 || fq->queue.HasWaiters()) return;
+
+    buckets[HashKey(fq->key)].Remove([fq](FutexQueue* q) { return q == fq; });
+    delete fq;
+}
+
+int32_t Futex::Wait(uint32_t* directory, uint32_t userAddr, uint32_t expected,
+                    uint32_t timeoutMs) {
+    uint32_t key;
+    if (!Translate(directory, userAddr, key)) return FUTEX_EINVAL;
+
+    FutexQueue* fq = Acquire(key, true);
+    if (!fq) return FUTEX_EINVAL;
+
+    // The value test and the enqueue happen under the queue lock; a waker has to
+    // take the same lock after changing the word, so the wake-up cannot slip between.
+    int32_t result;
+    uint32_t flags = fq->queue.lock.Lock();
+    if (*(volatile uint32_t*)userAddr != expected) {
+        fq->queue.lock.Unlock(flags);
+        result = FUTEX_EAGAIN;
+    } else {
+        bool woken = fq->queue.SleepLocked(flags, timeoutMs ? timeoutMs : WAIT_FOREVER);
+        result = woken ? FUTEX_OK : FUTEX_ETIMEDOUT;
+    }
+
+    Release(fq);
+    return result;
+}
+
+int32_t Futex::Wake(uint32_t* directory, uint32_t userAddr, uint32_t count) {
+    uint32_t key;
+    if (!Translate(directory, userAddr, key)) return FUTEX_EINVAL;
+
+    // Nobody ever waited here: nothing to do
+    FutexQueue* fq = Acquire(key, false);
+    if (!fq) return 0;
+
+    int32_t woken = 0;
+    {
+        SpinlockGuard guard(fq->queue.lock);
+        while ((uint32_t)woken < count && fq->queue.WakeOneLocked()) woken++;
+    }
+
+    Release(fq);
+    return woken;
+}
@@ -0,0 +1,210 @@
+/**
+ * @file        input.cpp
+ * @brief       Per-process keyboard and mouse event queues
+ *
+ * @date        18/10/2026
+ * @version     1.0.0
+ */
+
+#include <core/Iguard.h>
+#include <core/globals.h>
+#include <core/input.h>
+#include <core/paging.h>
+#include <core/softirq.h>
+#include <core/timing.h>
+
+InputQueue* InputQueue::queues[INPUT_MAX_QUEUES];
+InputQueue::RawInput InputQueue::raw[INPUT_RAW_SIZE];
+volatile uint32_t InputQueue::rawHead = 0;
+volatile uint32_t InputQueue::rawTail = 0;
+uint8_t InputQueue::mouseButtons = 0;
+
+InputQueue::InputQueue(uint32_t pid) : head(0), tail(0), dropped(0), pid(pid) {}
+
+void InputQueue::Push(const InputEvent& event) {
+    SpinlockGuard guard(wait.lock);
+
+    // Fold a move into an unread move with the same buttons, a burst of mouse
+    // packets then costs one slot
+    if (event.type == INPUT_MOUSE_MOVE && head != tail) {
+        InputEvent& last = events[(tail - 1) % INPUT_QUEUE_SIZE];
+        int32_t dx = last.dx + event.dx;
+        int32_t dy = last.dy + event.dy;
+        if (last.type == INPUT_MOUSE_MOVE && last.buttons == event.buttons && dx >= -32768 &&
+            dx <= 32767 && dy >= -32768 && dy <= 32767) {
+            last.dx = (int16_t)dx;
+            last.dy = (int16_t)dy;
+            last.tsc = event.tsc;
+            wait.WakeAllLocked();
+            return;
+        }
+    }
+
+    // Full: the oldest event goes, the reader learns how many it missed
+    if (tail - head == INPUT_QUEUE_SIZE) {
+        head++;
+        dropped++;
+    }
+    events[tail % INPUT_QUEUE_SIZE] = event;
+    tail++;
+    wait.WakeAllLocked();
+}
+
+void InputQueue::Deliver(const InputEvent& event) {
+    // A fullscreen app that took the GUI gets the input to itself
+    int owner = g_gui_owner_pid;
+    for (uint32_t i = 0; i < INPUT_MAX_QUEUES; i++) {
+        InputQueue* q = queues[i];
+        if (!q) continue;
+        if (owner >= 0 && q->pid != (uint32_t)owner) continue;
+        q->Push(event);
+    }
+}
+
+void InputQueue::Init() {
+    SoftIRQ::Register(SOFTIRQ_INPUT, ProcessRaw, nullptr);
+}
+
+void InputQueue::Capture(bool mouse, uint8_t b0, uint8_t b1, uint8_t b2) {
+    // Dropped if the softirq has fallen this far behind
+    if (rawHead - rawTail < INPUT_RAW_SIZE) {
+        RawInput& slot = raw[rawHead % INPUT_RAW_SIZE];
+        slot.tsc = ReadTSC();
+        slot.mouse = mouse;
+        slot.bytes[0] = b0;
+        slot.bytes[1] = b1;
+        slot.bytes[2] = b2;
+        rawHead++;
+    }
+    SoftIRQ::Raise(SOFTIRQ_INPUT);
+}
+
+void InputQueue::KeyEvent(uint8_t scancode, bool extended) {
+    Capture(false, scancode, extended, 0);
+}
+
+void InputQueue::MousePacket(const uint8_t* packet) {
+    Capture(true, packet[0], packet[1], packet[2]);
+}
+
+// Input softirq: turns the captured bytes into events, in arrival order
+void InputQueue::ProcessRaw(void* arg) {
+    while (rawTail != rawHead) {
+        RawInput& slot = raw[rawTail % INPUT_RAW_SIZE];
+        if (slot.mouse) {
+            MouseEvent(slot.tsc, (int8_t)slot.bytes[1], -(int8_t)slot.bytes[2],
+                       slot.bytes[0] & 0x7);
+        } else {
+            InputEvent event;
+            event.tsc = slot.tsc;
+            event.type = (slot.bytes[0] & 0x80) ? INPUT_KEY_UP : INPUT_KEY_DOWN;
+            event.code = slot.bytes[0] & 0x7F;
+            event.flags = slot.bytes[1] ? INPUT_FLAG_EXTENDED : 0;
+            event.buttons = 0;
+            event.dx = 0;
+            event.dy = 0;
+            Deliver(event);
+        }
+        rawTail++;
+    }
+}
+
+void InputQueue::MouseEvent(uint64_t tsc, int32_t dx, int32_t dy, uint8_t newButtons) {
+    uint8_t oldButtons = mouseButtons;
+    mouseButtons = newButtons;
+
+    InputEvent event;
+    event.tsc = tsc;
+    event.code = 0;
+    event.flags = 0;
+
+    // Buttons act at the pointer position, so the move goes first
+    if (dx != 0 || dy != 0) {
+        event.type = INPUT_MOUSE_MOVE;
+        event.buttons = oldButtons;
+        event.dx = (int16_t)dx;
+        event.dy = (int16_t)dy;
+        Deliver(event);
+    }
+
+    event.dx = 0;
+    event.dy = 0;
+    for (uint8_t i = 0; i < 3; i++) {
+        uint8_t bit = 1 << i;
+        if ((oldButtons ^ newButtons) & bit) {
+            oldButtons ^= bit;
+            event.type = (newButtons & bit) ? INPUT_MOUSE_DOWN : INPUT_MOUSE_UP;
+            event.code = i + 1;
+            event.buttons = oldButtons;
+            Deliver(event);
+        }
+    }
+}
+
+int32_t InputQueue::Wait(ProcessControlBlock* process, InputEvent* out, uint32_t max,
+                         uint32_t timeoutMs, uint32_t& lost) {
+    lost = 0;
+    if (!process) return INPUT_EINVAL;
+    if (max && !g_paging->IsUserRangeWritable(process->page_directory, (uint32_t)out,
+                                              max * sizeof(InputEvent))) {
+        return INPUT_EFAULT;
+    }
+
+    // The first call subscribes the process
+    InputQueue* q = process->inputQueue;
+    if (!q) {
+        q = new InputQueue(process->pid);
+        if (!q) return INPUT_EBUSY;
+
+        InterruptGuard guard;
+        uint32_t i = 0;
+        while (i < INPUT_MAX_QUEUES && queues[i]) i++;
+        if (i == INPUT_MAX_QUEUES) {
+            delete q;
+            return INPUT_EBUSY;
+        }
+        queues[i] = q;
+        process->inputQueue = q;
+    }
+
+    uint32_t deadline =
+        (timeoutMs == WAIT_FOREVER) ? WAIT_FOREVER : (uint32_t)timerTicks + timeoutMs;
+    while (true) {
+        uint32_t flags = q->wait.lock.Lock();
+        uint32_t n = 0;
+        while (n < max && q->head != q->tail) {
+            out[n++] = q->events[q->head % INPUT_QUEUE_SIZE];
+            q->head++;
+        }
+        if (n > 0 || max == 0) {
+            lost = q->dropped;
+            q->dropped = 0;
+            q->wait.lock.Unlock(flags);
+            return (int32_t)n;
+        }
+
+        uint32_t left = WAIT_FOREVER;
+        if (deadline != WAIT_FOREVER) {
+            int32_t remaining = (int32_t)(deadline - (uint32_t)timerTicks);
+            if (remaining <= 0) {
+                q->wait.lock.Unlock(flags);
+                return 0;
+            }
+            left = (uint32_t)remaining;
+        }
+        q->wait.SleepLocked(flags, left);
+    }
+}
+
+void InputQueue::Release(ProcessControlBlock* process) {
+    InputQueue* q = process->inputQueue;
+    if (!q) return;
+    {
+        InterruptGuard guard;
+        for (uint32_t i = 0; i < INPUT_MAX_QUEUES; i++) {
+            if (queues[i] == q) queues[i] = nullptr;
+        }
+        process->inputQueue = nullptr;
+    }
+    delete q;
+}
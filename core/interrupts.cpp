@@ -10,18 +10,21 @@
 #include <core/KernelSymbolResolver.h>
 #include <core/filesystem/FAT32.h>
 #include <core/interrupts.h>
+#include <core/kdata.h>
+#include <core/softirq.h>
 
 static uint16_t HWInterruptOffset = 0x20;
 extern void FlushSerial();
-uint32_t audioTickCounter = 0;
 
 InterruptHandler::InterruptHandler(uint8_t InterruptNumber, InterruptManager* interruptManager) {
     this->InterruptNumber = InterruptNumber;
     this->interruptManager = interruptManager;
+    WriteGuard guard(interruptManager->handlersLock);
     interruptManager->handlers[InterruptNumber] = this;
 }
 
 InterruptHandler::~InterruptHandler() {
+    WriteGuard guard(interruptManager->handlersLock);
     if (interruptManager->handlers[InterruptNumber] == this)
         interruptManager->handlers[InterruptNumber] = 0;
 }
@@ -32,6 +35,7 @@ uint32_t InterruptHandler::HandleInterrupt(uint32_t esp) {
 
 InterruptManager::GateDescriptor InterruptManager::interruptDescriptorTable[256];
 InterruptManager* InterruptManager::activeInstance = 0;
+volatile uint32_t InterruptManager::hwInterruptDepth = 0;
 
 void InterruptManager::SetInterruptDescriptorTableEntry(uint8_t interruptNumber,
                                                         uint16_t codeSegmentSelectorOffset,
@@ -137,6 +141,10 @@ InterruptManager::InterruptManager(Scheduler* scheduler, Paging* pager)
     SetInterruptDescriptorTableEntry(HWInterruptOffset + 0x0F, CodeSegment,
                                      &HandleInterruptRequest0x0F, 0, IDT_INTERRUPT_GATE);
 
+    // Kernel-only yield used by WaitQueue/Sleep to give up the CPU immediately
+    SetInterruptDescriptorTableEntry(HWInterruptOffset + 0x10, CodeSegment,
+                                     &HandleInterruptRequest0x10, 0, IDT_INTERRUPT_GATE);
+
     // Use TRAP GATE (0xF) for syscalls so interrupts remain enabled.
     // This prevents long syscalls (e.g. 2MB disk reads) from blocking
     // the timer, mouse, keyboard, and scheduler for seconds at a time.
@@ -195,7 +203,12 @@ void InterruptManager::Deactivate() {
 uint32_t InterruptManager::handleInterrupt(uint8_t interruptNumber, uint32_t esp) {
     InterruptGuard guard;
     if (activeInstance != 0) {
-        return activeInstance->DoHandleInterrupt(interruptNumber, esp);
+        bool hardware =
+            interruptNumber >= HWInterruptOffset && interruptNumber < HWInterruptOffset + 16;
+        if (hardware) hwInterruptDepth++;
+        esp = activeInstance->DoHandleInterrupt(interruptNumber, esp);
+        if (hardware) hwInterruptDepth--;
+        return esp;
     } else {
         return esp;
     }
@@ -227,7 +240,9 @@ uint32_t InterruptManager::handleException(uint8_t interruptNumber, uint32_t esp
 
 uint32_t InterruptManager::DoHandleInterrupt(uint8_t interruptNumber, uint32_t esp) {
     CPUState* cpu = (CPUState*)esp;
-    if (interruptNumber >= HWInterruptOffset && interruptNumber < HWInterruptOffset + 16) {
+    bool hardware =
+        interruptNumber >= HWInterruptOffset && interruptNumber < HWInterruptOffset + 16;
+    if (hardware) {
         picMasterCommand.Write(0x20);  // Send EOI to Master PIC
 
         if (interruptNumber >= HWInterruptOffset + 8)
@@ -237,16 +252,29 @@ uint32_t InterruptManager::DoHandleInterrupt(uint8_t interruptNumber, uint32_t e
     // Handle Timer
     if (interruptNumber == HWInterruptOffset) {
         timerTicks++;
+        KernelData::Tick();
     }
 
-    // Call Registered Handlers
-    if (handlers[interruptNumber] != nullptr) {
-        esp = handlers[interruptNumber]->HandleInterrupt(esp);
+    // Call Registered Handlers (the table lock only covers the lookup, a handler may register
+    // another one)
+    InterruptHandler* handler;
+    {
+        ReadGuard guard(handlersLock);
+        handler = handlers[interruptNumber];
+    }
+    if (handler != nullptr) {
+        esp = handler->HandleInterrupt(esp);
     } else if (interruptNumber != HWInterruptOffset && interruptNumber != 0x2E &&
-               interruptNumber != 0x2F) {
+               interruptNumber != 0x2F && interruptNumber != HWInterruptOffset + 0x10) {
         printf("UNHANDLED INTERRUPT: 0x%x\n", interruptNumber);
     }
 
+    // Bottom halves raised above run now with interrupts enabled, before any context
+    // switch. Nested IRQs leave theirs to the outermost one.
+    if (hardware && hwInterruptDepth == 1) {
+        SoftIRQ::RunPending();
+    }
+
     // After a syscall (int 0x80 arrives as 0xA0 because ASM adds IRQ_BASE=0x20),
     // check if the current thread was terminated or killed
     if (interruptNumber == HWInterruptOffset + 0x80) {
@@ -261,18 +289,21 @@ uint32_t InterruptManager::DoHandleInterrupt(uint8_t interruptNumber, uint32_t e
 
     // Timer Interrupt
     if (interruptNumber == HWInterruptOffset) {
-        // Call mixer every 10ms
-        audioTickCounter++;
-        if (audioTickCounter >= 10) {
-            audioTickCounter = 0;
-            if (g_AudioMixer) g_AudioMixer->Update();
-        }
+        // Don't preempt the thread whose IRQ exit is running softirqs
+        if (SoftIRQ::InProgress()) return esp;
 
         return (uint32_t)scheduler->Schedule((CPUState*)esp);
     }
 
     // Explicit Yield / Sleep
-    if (interruptNumber == 0x2E) {
+    if (interruptNumber == 0x2E || interruptNumber == HWInterruptOffset + 0x10) {
+        return (uint32_t)scheduler->Schedule((CPUState*)esp,
+                                             interruptNumber == HWInterruptOffset + 0x10);
+    }
+
+    // A device IRQ woke a realtime thread (e.g. audio): switch now, not at the next tick
+    if (hardware && hwInterruptDepth == 1 && scheduler->PreemptPending() &&
+        !SoftIRQ::InProgress()) {
         return (uint32_t)scheduler->Schedule((CPUState*)esp);
     }
 
@@ -0,0 +1,113 @@
+/**
+ * @file        ioring.cpp
+ * @brief       Batched system calls through shared submission/completion rings
+ *
+ * @date        18/10/2026
+ * @version     1.0.0
+ */
+
+#include <core/ioring.h>
+#include <core/paging.h>
+#include <core/scheduler.h>
+#include <core/syscalls.h>
+
+bool IORing::Validate(ProcessControlBlock* process, uint32_t addr, uint32_t entries) {
+    if (addr & 0x3) return false;
+    // Every page must be mapped and writable: the kernel posts completions into the
+    // ring without fault handling
+    return g_paging->IsUserRangeWritable(process->page_directory, addr, IORING_BYTES(entries));
+}
+
+int32_t IORing::Setup(ProcessControlBlock* process, uint32_t addr, uint32_t entries) {
+    if (!process) return IORING_EINVAL;
+    if (process->ringBusy) return IORING_EBUSY;
+
+    // Zero entries unregisters the ring
+    if (entries == 0) {
+        process->ringAddr = 0;
+        process->ringEntries = 0;
+        return 0;
+    }
+
+    if (entries > IORING_MAX_ENTRIES || (entries & (entries - 1))) return IORING_EINVAL;
+    if (!Validate(process, addr, entries)) return IORING_EINVAL;
+
+    IORingHeader* header = (IORingHeader*)addr;
+    memset(header, 0, sizeof(IORingHeader));
+    header->entries = entries;
+
+    process->ringAddr = addr;
+    process->ringEntries = entries;
+    DEBUG_LOG("IORing: PID %d registered %d entries at 0x%x", process->pid, entries, addr);
+    return 0;
+}
+
+void IORing::Execute(const IORingSQE& sqe, IORingCQE& cqe) {
+    bool hgui = sqe.opcode & IORING_OP_HGUI;
+    uint32_t number = sqe.opcode & SYSCALL_NUMBER_MASK;
+
+    cqe.userData = sqe.userData;
+    cqe.extra0 = 0;
+    cqe.extra1 = 0;
+
+    InterruptHandler* handler = hgui ? (InterruptHandler*)HguiHandler::activeInstance : g_sysCalls;
+    if (!handler || (!hgui && (number == sys_exit || number == sys_restart ||
+                               number == sys_ring_setup || number == sys_ring_enter))) {
+        cqe.result = SYSCALL_ENOSYS;
+        return;
+    }
+
+    // Same frame a v2 trap would build, the handlers cannot tell the difference
+    CPUState frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.eax = number | (SYSCALL_ABI_V2 << SYSCALL_ABI_SHIFT);
+    frame.ebx = sqe.args[0];
+    frame.ecx = sqe.args[1];
+    frame.esi = sqe.args[2];
+
+    handler->HandleInterrupt((uint32_t)&frame);
+
+    cqe.result = (int32_t)frame.eax;
+    cqe.extra0 = frame.edx;
+    cqe.extra1 = frame.ecx;
+}
+
+int32_t IORing::Enter(ProcessControlBlock* process, uint32_t toSubmit) {
+    if (!process || !process->ringAddr) return IORING_ENXIO;
+    if (process->ringBusy) return IORING_EBUSY;
+
+    uint32_t entries = process->ringEntries;
+    if (!Validate(process, process->ringAddr, entries)) return IORING_EINVAL;
+    process->ringBusy = true;
+
+    IORingHeader* header = (IORingHeader*)process->ringAddr;
+    IORingSQE* sq = (IORingSQE*)(header + 1);
+    IORingCQE* cq = (IORingCQE*)(sq + entries);
+    uint32_t mask = entries - 1;
+
+    // Only take what was queued when we came in, later SQEs wait for the next call
+    uint32_t tail = header->sqTail;
+    uint32_t queued = tail - header->sqHead;
+    if (queued > entries) queued = entries;  // User space corrupted the indices
+    if (toSubmit == 0 || toSubmit > queued) toSubmit = queued;
+
+    uint32_t done = 0;
+    while (done < toSubmit) {
+        // Completion queue full: leave the rest queued until user space reaps
+        if (header->cqTail - header->cqHead >= entries) break;
+
+        // Copy first, user space may rewrite the slot while the call runs
+        IORingSQE sqe = sq[header->sqHead & mask];
+        header->sqHead = header->sqHead + 1;
+
+        IORingCQE cqe;
+        Execute(sqe, cqe);
+
+        cq[header->cqTail & mask] = cqe;
+        header->cqTail = header->cqTail + 1;
+        done++;
+    }
+
+    process->ringBusy = false;
+    return (int32_t)done;
+}
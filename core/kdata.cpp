@@ -0,0 +1,64 @@
+/**
+ * @file        kdata.cpp
+ * @brief       Read-only kernel data page shared with user space
+ *
+ * @date        18/10/2026
+ * @version     1.0.0
+ */
+
+#include <core/Iguard.h>
+#include <core/globals.h>
+#include <core/kdata.h>
+#include <core/paging.h>
+#include <core/pmm.h>
+#include <core/timing.h>
+
+KernelDataPage* KernelData::page = nullptr;
+
+void KernelData::Init() {
+    // Must be in identity-mapped range (<256MB), the kernel writes it directly
+    page = (KernelDataPage*)pmm_alloc_block_low(256 * 1024 * 1024);
+    if (!page) {
+        HALT("CRITICAL: Failed to allocate the kernel data page!");
+    }
+    memset(page, 0, PAGE_SIZE);
+
+    page->magic = KDATA_MAGIC;
+    page->version = KDATA_VERSION;
+    page->timerTicks = timerTicks;
+    page->tscAtTick = ReadTSC();
+    page->totalPages = pmm_get_max_blocks();
+    page->usedPages = pmm_get_used_blocks();
+}
+
+void KernelData::Tick() {
+    if (!page) return;
+    // Runs in the timer IRQ, nothing else writes at the same time
+    BeginWrite();
+    page->timerTicks = timerTicks;
+    page->tscAtTick = ReadTSC();
+    EndWrite();
+}
+
+void KernelData::Calibrate(uint32_t tscPerMs, uint32_t contextSwitches, uint32_t idlePermille) {
+    if (!page) return;
+    InterruptGuard guard;
+    BeginWrite();
+    page->tscPerMs = tscPerMs;
+    // 1ms in ns, scaled by 2^KDATA_NS_SHIFT, still fits in 32 bits
+    page->nsPerTscMult = tscPerMs ? (1000000u << KDATA_NS_SHIFT) / tscPerMs : 0;
+    page->contextSwitches = contextSwitches;
+    page->idlePermille = idlePermille;
+    page->usedPages = pmm_get_used_blocks();
+    EndWrite();
+}
+
+void KernelData::SetScreen(uint32_t width, uint32_t height, uint32_t bpp) {
+    if (!page) return;
+    InterruptGuard guard;
+    BeginWrite();
+    page->screenWidth = width;
+    page->screenHeight = height;
+    page->screenBpp = bpp;
+    EndWrite();
+}
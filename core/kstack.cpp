@@ -0,0 +1,71 @@
+/**
+ * @file        kstack.cpp
+ * @brief       Kernel stack pool with guard pages
+ *
+ * @date        18/10/2026
+ * @version     1.0.0
+ */
+
+#include <core/kstack.h>
+
+KernelStackPool::FreeSlot* KernelStackPool::freeLists[KSTACK_CLASS_COUNT];
+uint32_t KernelStackPool::totalSlots[KSTACK_CLASS_COUNT];
+uint32_t KernelStackPool::freeSlots[KSTACK_CLASS_COUNT];
+Spinlock KernelStackPool::lock("kstack-pool", LOCK_LEVEL_KSTACK);
+Paging* KernelStackPool::pager = nullptr;
+
+void KernelStackPool::Init(Paging* paging) {
+    pager = paging;
+
+    const uint32_t prealloc[KSTACK_CLASS_COUNT] = {KSTACK_DEFAULT_PREALLOC, KSTACK_LARGE_PREALLOC};
+    for (uint32_t cls = 0; cls < KSTACK_CLASS_COUNT; cls++) {
+        for (uint32_t i = 0; i < prealloc[cls]; i++) {
+            uint8_t* stack = Grow((KernelStackClass)cls);
+            if (!stack) break;
+            Free(stack, (KernelStackClass)cls);
+        }
+    }
+    DEBUG_LOG("KernelStackPool: %d x %dKB + %d x %dKB stacks ready", freeSlots[KSTACK_DEFAULT],
+              KSTACK_DEFAULT_SIZE / 1024, freeSlots[KSTACK_LARGE], KSTACK_LARGE_SIZE / 1024);
+}
+
+// Maps a new slot. Called without 'lock'.
+uint8_t* KernelStackPool::Grow(KernelStackClass cls) {
+    uint32_t pages = SizeOf(cls) / PAGE_SIZE + 1;
+    uint8_t* slot = (uint8_t*)pmm_alloc_blocks_low(pages, KSTACK_PHYS_LIMIT);
+    if (!slot) {
+        DEBUG_LOG("KernelStackPool: out of low memory for a %dKB stack", SizeOf(cls) / 1024);
+        return nullptr;
+    }
+
+    // Guard page: the lowest page of the slot disappears from the identity map.
+    // The kernel page tables are shared by every process directory.
+    if (pager) pager->UnmapPage(pager->KernelPageDirectory, (uint32_t)slot);
+
+    SpinlockGuard guard(lock);
+    totalSlots[cls]++;
+    return slot + PAGE_SIZE;
+}
+
+uint8_t* KernelStackPool::Allocate(KernelStackClass cls) {
+    if (cls >= KSTACK_CLASS_COUNT) cls = KSTACK_DEFAULT;
+    {
+        SpinlockGuard guard(lock);
+        FreeSlot* slot = freeLists[cls];
+        if (slot) {
+            freeLists[cls] = slot->next;
+            freeSlots[cls]--;
+            return (uint8_t*)slot;
+        }
+    }
+    return Grow(cls);
+}
+
+void KernelStackPool::Free(uint8_t* base, KernelStackClass cls) {
+    if (!base || cls >= KSTACK_CLASS_COUNT) return;
+    SpinlockGuard guard(lock);
+    FreeSlot* slot = (FreeSlot*)base;
+    slot->next = freeLists[cls];
+    freeLists[cls] = slot;
+    freeSlots[cls]++;
+}
@@ -7,6 +7,7 @@
  */
 
 #include <core/memory.h>
+#include <core/spinlock.h>
 
 // --- SSE HELPERS ---
 static inline void __cpuid(int code, uint32_t* a, uint32_t* b, uint32_t* c, uint32_t* d) {
@@ -124,6 +125,9 @@ KHEAP_BLOCK* g_head = NULL;
 // Global flag to indicate if kheap is initialized
 static bool kheap_initialized = false;
 
+// Guards the block list and kbrk. Independent of the scheduler and log locks.
+static Spinlock heapLock("kheap", LOCK_LEVEL_HEAP);
+
 /**
  * initialize heap and set total memory size
  */
@@ -214,8 +218,7 @@ KHEAP_BLOCK* allocate_new_block(int size) {
  * otherwise try some memory allocation algorithm like best fit etc
  * to find best block to allocate
  */
-void* kmalloc(int size) {
-    InterruptGuard guard;
+static void* kmalloc_locked(int size) {
     if (size <= 0) return NULL;
     if (g_head == NULL) {
         g_head = (KHEAP_BLOCK*)kbrk(sizeof(KHEAP_BLOCK));
@@ -248,8 +251,12 @@ void* kmalloc(int size) {
     return NULL;
 }
 
+void* kmalloc(int size) {
+    SpinlockGuard guard(heapLock);
+    return kmalloc_locked(size);
+}
+
 void* aligned_kmalloc(size_t size, size_t alignment) {
-    InterruptGuard guard;
     uintptr_t raw_addr = (uintptr_t)kmalloc(size + alignment);
     if (!raw_addr) return nullptr;
 
@@ -261,7 +268,6 @@ void* aligned_kmalloc(size_t size, size_t alignment) {
  * allocate memory n * size & zeroing out
  */
 void* kcalloc(int n, int size) {
-    InterruptGuard guard;
     if (n < 0 || size < 0) return NULL;
     void* mem = kmalloc(n * size);
     if (mem) memset(mem, 0, n * size);
@@ -273,17 +279,18 @@ void* kcalloc(int n, int size) {
  * copy previous block data & set free the previous block
  */
 void* krealloc(void* ptr, int size) {
-    InterruptGuard guard;
     if (!ptr) return kmalloc(size);
     if (size <= 0) {
         kfree(ptr);
         return NULL;
     }
 
+    SpinlockGuard guard(heapLock);
+
     KHEAP_BLOCK* temp = g_head;
     while (temp != NULL) {
         if (temp->data == ptr) {
-            void* new_ptr = kmalloc(size);
+            void* new_ptr = kmalloc_locked(size);
             if (!new_ptr) return NULL;
 
             // Uses the optimized memcpy automatically
@@ -300,8 +307,8 @@ void* krealloc(void* ptr, int size) {
  * set free the block
  */
 void kfree(void* addr) {
-    InterruptGuard guard;
     if (!addr) return;
+    SpinlockGuard guard(heapLock);
 
     KHEAP_BLOCK* temp = g_head;
     while (temp != NULL) {
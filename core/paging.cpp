@@ -6,6 +6,7 @@
  * @version     1.0.0-beta
  */
 
+#include <core/kdata.h>
 #include <core/paging.h>
 
 Paging::Paging() : is_paging_active(false) {}
@@ -104,6 +105,11 @@ uint32_t* Paging::CreateProcessDirectory() {
         new_dir[i] = KernelPageDirectory[i];
     }
 
+    // Shared kernel data page, read-only for the process
+    if (KernelData::PhysicalAddress()) {
+        MapPage(new_dir, KDATA_USER_VIRT, KernelData::PhysicalAddress(), PAGE_PRESENT | PAGE_USER);
+    }
+
     return new_dir;
 }
 
@@ -143,6 +149,17 @@ bool Paging::MapPage(uint32_t* directory, uint32_t virtual_addr, uint32_t physic
     return true;
 }
 
+void Paging::UnmapPage(uint32_t* directory, uint32_t virtual_addr) {
+    uint32_t pd_idx = virtual_addr >> 22;
+    uint32_t pt_idx = (virtual_addr >> 12) & 0x03FF;
+
+    if (!(directory[pd_idx] & PAGE_PRESENT)) return;
+
+    uint32_t* table = (uint32_t*)(directory[pd_idx] & 0xFFFFF000);
+    table[pt_idx] = 0;
+    asm volatile("invlpg (%0)" ::"r"(virtual_addr) : "memory");
+}
+
 uint32_t Paging::GetPhysicalAddress(uint32_t* directory, uint32_t virtual_addr) {
     uint32_t pd_idx = virtual_addr >> 22;
     uint32_t pt_idx = (virtual_addr >> 12) & 0x03FF;
@@ -154,3 +171,25 @@ uint32_t Paging::GetPhysicalAddress(uint32_t* directory, uint32_t virtual_addr)
 
     return (table[pt_idx] & 0xFFFFF000) + (virtual_addr & 0xFFF);
 }
+
+// Every page of the range has 'flags' set in both its PDE and its PTE
+bool Paging::CheckUserRange(uint32_t* directory, uint32_t addr, uint32_t length, uint32_t flags) {
+    if (addr < USER_SPACE_START || addr + length > USER_SPACE_END || addr + length < addr) {
+        return false;
+    }
+    for (uint32_t page = addr & ~(PAGE_SIZE - 1); page < addr + length; page += PAGE_SIZE) {
+        uint32_t pde = directory[page >> 22];
+        if ((pde & flags) != flags) return false;
+        uint32_t* table = (uint32_t*)(pde & 0xFFFFF000);
+        if ((table[(page >> 12) & 0x03FF] & flags) != flags) return false;
+    }
+    return true;
+}
+
+bool Paging::IsUserRangeMapped(uint32_t* directory, uint32_t addr, uint32_t length) {
+    return CheckUserRange(directory, addr, length, PAGE_PRESENT | PAGE_USER);
+}
+
+bool Paging::IsUserRangeWritable(uint32_t* directory, uint32_t addr, uint32_t length) {
+    return CheckUserRange(directory, addr, length, PAGE_PRESENT | PAGE_USER | PAGE_RW);
+}
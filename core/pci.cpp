@@ -129,6 +129,34 @@ PeripheralComponentInterconnectController::FindHardwareDevice(uint16_t vendorID,
     return empty;
 }
 
+// Same as FindHardwareDevice, matching on class codes instead of IDs
+PeripheralComponentInterconnectDeviceDescriptor*
+PeripheralComponentInterconnectController::FindClassDevice(uint8_t classID, uint8_t subclassID) {
+    for (int bus = 0; bus < 8; bus++) {
+        for (int device = 0; device < 32; device++) {
+            int numFunctions = DeviceHasFunctions(bus, device) ? 8 : 1;
+            for (int function = 0; function < numFunctions; function++) {
+                PeripheralComponentInterconnectDeviceDescriptor* dev =
+                    GetDeviceDescriptor(bus, device, function);
+
+                if (dev->vendor_id != 0x0000 && dev->vendor_id != 0xFFFF &&
+                    dev->class_id == classID && dev->subclass_id == subclassID) {
+                    return dev;
+                }
+                delete dev;
+            }
+        }
+    }
+    // Return empty descriptor if not found
+    PeripheralComponentInterconnectDeviceDescriptor* empty =
+        new PeripheralComponentInterconnectDeviceDescriptor();
+    if (!empty) {
+        HALT("CRITICAL: Failed to allocate PCI device descriptor!\n");
+    }
+    empty->vendor_id = 0;
+    return empty;
+}
+
 extern "C" {
 // C type Function to find bar0
 uint32_t pci_find_bar0(uint16_t vendor, uint16_t device) {
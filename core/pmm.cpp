@@ -284,6 +284,33 @@ void* pmm_alloc_blocks(uint32_t size) {
     return (void*)addr;
 }
 
+void* pmm_alloc_blocks_low(uint32_t size, uint32_t limit_addr) {
+    if ((g_pmm_info.max_blocks - g_pmm_info.used_blocks) <= size) {
+        KDBG2("contiguous low allocation failed reason=no_free_blocks size=%u", size);
+        return NULL;
+    }
+
+    // The search returns the lowest fit, so if that one crosses the limit none fits
+    int frame = pmm_mmap_first_free_by_size(size);
+    if (frame == -1 || (uint32_t)(frame + size) > limit_addr / PMM_BLOCK_SIZE) {
+        KDBG2("contiguous low allocation failed reason=frame_not_found size=%u limit=0x%x", size,
+              limit_addr);
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < size; i++) pmm_mmap_set(frame + i);
+
+    // Use Absolute Addressing
+    PMM_PHYSICAL_ADDRESS addr = (frame * PMM_BLOCK_SIZE);
+
+    g_pmm_info.used_blocks += size;
+
+    KDBG2("contiguous low allocation size=%u addr=0x%x used=%u", size, addr,
+          g_pmm_info.used_blocks);
+
+    return (void*)addr;
+}
+
 void pmm_free_blocks(void* p, uint32_t size) {
     uint32_t i;
 
@@ -6,24 +6,44 @@
  * @version     1.0.0
  */
 
+#include <core/filesystem/FileTable.h>
+#include <core/input.h>
+#include <core/interrupts.h>
+#include <core/kdata.h>
+#include <core/kstack.h>
 #include <core/scheduler.h>
+#include <core/sync.h>
+#include <core/systrace.h>
 
 extern TaskStateSegment g_tss;
 
 // Virtual address for user-mode stacks (just below the 3GB hardware boundary)
 #define USER_STACK_VIRT_TOP 0xC0000000
 
-// Virtual address for the user-mode thread exit trampoline (1GB mark, in user space)
+// Virtual address for the user-mode thread exit trampoline (1GB mark, in user space).
+// The next page is the shared kernel data page (KDATA_USER_VIRT).
 #define USER_EXIT_TRAMPOLINE_VIRT 0x40000000
 
-#define KERNEL_STACK_SIZE (64 * 1024)
-
 // Number of pages per User-Mode stack (16KB)
 #define USER_STACK_PAGES 4
 
 Scheduler* Scheduler::activeInstance = nullptr;
 void FlushSerial();
 
+// 64 by 32 bit unsigned division (no libgcc in the kernel link)
+static uint64_t Div64(uint64_t n, uint32_t d) {
+    uint64_t q = 0;
+    uint64_t r = 0;
+    for (int i = 63; i >= 0; i--) {
+        r = (r << 1) | ((n >> i) & 1);
+        if (r >= d) {
+            r -= d;
+            q |= (1ULL << i);
+        }
+    }
+    return q;
+}
+
 void IdleTask(void* arg) {
     while (1) {
         // Clear the log buffer to the screen
@@ -52,6 +72,22 @@ Scheduler::Scheduler(Paging* pager) {
     currentThread = nullptr;
     activeInstance = this;
 
+    lastSwitchTsc = ReadTSC();
+    totalCycles = 0;
+    idleCycles = 0;
+    contextSwitches = 0;
+    memset(runQueueLatency, 0, sizeof(runQueueLatency));
+    windowStartTsc = lastSwitchTsc;
+    windowStartIdle = 0;
+    windowStartTick = (uint32_t)timerTicks;
+    idlePermille = 0;
+    tscPerMs = 0;
+    preemptPending = false;
+    dyingStack = nullptr;
+    retiredStack = nullptr;
+
+    KernelStackPool::Init(pager);
+
     // Allocate and write a user-mode exit trampoline
     // Must be in identity-mapped range (<256MB)
     _trampolinePhys = (uint32_t)pmm_alloc_block_low(256 * 1024 * 1024);
@@ -62,34 +98,42 @@ Scheduler::Scheduler(Paging* pager) {
 
     // Position-Independent Code
     /*
+    0x31 0xDB                  →   xor ebx, ebx  (exit status 0)
     0xB8 0x01 0x00 0x00 0x00   →   mov eax, 1
     0xCD 0x80                  →   int 0x80
     0xEB 0xFE                  →   jmp $ (relative jump to itself)
     */
     uint8_t* code = (uint8_t*)_trampolinePhys;
 
+    // xor ebx, ebx  (a thread returning from its entry point exits with 0)
+    code[0] = 0x31;
+    code[1] = 0xDB;
     // mov eax, 1  (sys_exit)
-    code[0] = 0xB8;
-    code[1] = 0x01;
-    code[2] = 0x00;
-    code[3] = 0x00;
+    code[2] = 0xB8;
+    code[3] = 0x01;
     code[4] = 0x00;
+    code[5] = 0x00;
+    code[6] = 0x00;
     // int 0x80
-    code[5] = 0xCD;
-    code[6] = 0x80;
+    code[7] = 0xCD;
+    code[8] = 0x80;
     // jmp $  (safe infinite loop — hlt is privileged and would #GP in Ring 3)
-    code[7] = 0xEB;
-    code[8] = 0xFE;
+    code[9] = 0xEB;
+    code[10] = 0xFE;
 
     idleThread = CreateThread(nullptr, IdleTask, nullptr);
 }
 
-ProcessControlBlock* Scheduler::CreateProcess(bool isKernel, void (*entrypoint)(void*), void* arg) {
+ProcessControlBlock* Scheduler::CreateProcess(bool isKernel, void (*entrypoint)(void*), void* arg,
+                                              KernelStackClass stackClass) {
     ProcessControlBlock* pcb = new ProcessControlBlock();
     if (!pcb) {
         HALT("CRITICAL: Failed to allocate ProcessControlBlock!\n");
     }
-    pcb->pid = _pidCounter++;
+    {
+        SpinlockGuard guard(lock);
+        pcb->pid = _pidCounter++;
+    }
     pcb->isKernelProcess = isKernel;
 
     // MEMORY SPACE SETUP
@@ -106,27 +150,38 @@ ProcessControlBlock* Scheduler::CreateProcess(bool isKernel, void (*entrypoint)(
     }
 
     // Create the main thread (Stack setup)
-    CreateThread(pcb, entrypoint, arg);
+    CreateThread(pcb, entrypoint, arg, stackClass);
 
     // Register
+    SpinlockGuard guard(lock);
     globalProcessList.PushBack(pcb);
     return pcb;
 }
 
 ThreadControlBlock* Scheduler::CreateThread(ProcessControlBlock* parent, void (*entrypoint)(void*),
-                                            void* arg) {
-    InterruptGuard guard;
+                                            void* arg, KernelStackClass stackClass) {
+    // Kernel stack from the pool (guard page below it)
+    uint8_t* stack = KernelStackPool::Allocate(stackClass);
+    if (!stack) {
+        DEBUG_LOG("CreateThread: Failed to allocate kernel stack!");
+        return nullptr;
+    }
+
     ThreadControlBlock* tcb = new ThreadControlBlock();
 
-    tcb->tid = _tidCounter++;
+    {
+        SpinlockGuard guard(lock);
+        tcb->tid = _tidCounter++;
+    }
     tcb->parent = parent;
     tcb->pid = parent ? parent->pid : 0;
 
-    // Allocate 64KB kernel stack
-    tcb->stack = (uint8_t*)kmalloc(KERNEL_STACK_SIZE);
+    tcb->stack = stack;
+    tcb->stackClass = stackClass;
+    tcb->stackSize = KernelStackPool::SizeOf(stackClass);
 
     // Calculate the TOP of the stack
-    uint32_t* stackTop = (uint32_t*)(tcb->stack + KERNEL_STACK_SIZE);
+    uint32_t* stackTop = (uint32_t*)(tcb->stack + tcb->stackSize);
 
     // Map the context struct to the top of the kernel stack
     tcb->context = (CPUState*)((uint8_t*)stackTop - sizeof(CPUState));
@@ -179,7 +234,7 @@ ThreadControlBlock* Scheduler::CreateThread(ProcessControlBlock* parent, void (*
                     uint32_t pf = _pager->GetPhysicalAddress(parent->page_directory, va);
                     if (pf) pmm_free_block((void*)pf);
                 }
-                kfree(tcb->stack);
+                KernelStackPool::Free(tcb->stack, stackClass);
                 delete tcb;
                 return nullptr;
             }
@@ -193,7 +248,7 @@ ThreadControlBlock* Scheduler::CreateThread(ProcessControlBlock* parent, void (*
                     uint32_t pf = _pager->GetPhysicalAddress(parent->page_directory, va);
                     if (pf) pmm_free_block((void*)pf);
                 }
-                kfree(tcb->stack);
+                KernelStackPool::Free(tcb->stack, stackClass);
                 delete tcb;
                 return nullptr;
             }
@@ -211,9 +266,9 @@ ThreadControlBlock* Scheduler::CreateThread(ProcessControlBlock* parent, void (*
     }
 
     if (parent != nullptr) {
+        SpinlockGuard guard(lock);
         parent->threads.PushBack(tcb);
-        tcb->state = THREAD_STATE_READY;
-        readyQueue.PushBack(tcb);
+        MakeReady(tcb, ReadTSC());
     }
 
     if (arg == nullptr) {
@@ -223,14 +278,22 @@ ThreadControlBlock* Scheduler::CreateThread(ProcessControlBlock* parent, void (*
     return tcb;
 }
 
+ProcessControlBlock* Scheduler::FindProcess(uint32_t pid) {
+    SpinlockGuard guard(lock);
+    return globalProcessList.Find([pid](ProcessControlBlock* p) { return p->pid == pid; });
+}
+
 bool Scheduler::KillProcess(uint32_t pid) {
     ProcessControlBlock* target = nullptr;
-    int pCount = globalProcessList.GetSize();
-    for (int i = 0; i < pCount; i++) {
-        ProcessControlBlock* temp = globalProcessList.PopFront();
-        if (temp->pid == pid) target = temp;
-        globalProcessList.PushBack(temp);
-        if (target) break;
+    {
+        SpinlockGuard guard(lock);
+        int pCount = globalProcessList.GetSize();
+        for (int i = 0; i < pCount; i++) {
+            ProcessControlBlock* temp = globalProcessList.PopFront();
+            if (temp->pid == pid) target = temp;
+            globalProcessList.PushBack(temp);
+            if (target) break;
+        }
     }
     if (!target) return false;
 
@@ -288,10 +351,27 @@ bool Scheduler::KillProcess(uint32_t pid) {
         pmm_free_block(target->page_directory);
     }
 
+    // Close open files (no thread of the process is left to be using them)
+    if (target->files) {
+        delete target->files;
+        target->files = nullptr;
+    }
+    SyscallTrace::ReleaseProcess(target);
+    InputQueue::Release(target);
+
     // RESOURCE CLEANUP END
 
+    // Drop exit statuses nobody joined
+    {
+        SpinlockGuard guard(joinWait.lock);
+        while (exitRecords.Remove([pid](const ThreadExitRecord& r) { return r.pid == pid; }));
+    }
+
     // Remove from Global List
-    globalProcessList.Remove([target](ProcessControlBlock* p) { return p == target; });
+    {
+        SpinlockGuard guard(lock);
+        globalProcessList.Remove([target](ProcessControlBlock* p) { return p == target; });
+    }
 
     delete target;
 
@@ -302,30 +382,46 @@ void Scheduler::TerminateThread(ThreadControlBlock* thread) {
     if (!thread) return;
     if (thread->state == THREAD_STATE_TERMINATED) return;
 
-    // Null out currentThread BEFORE freeing/deleting.
-    // Otherwise Schedule() will dereference dangling pointer.
-    if (thread == currentThread) {
-        currentThread = nullptr;
+    // Don't leave a dangling pointer behind in a WaitQueue
+    if (thread->waitQueue) {
+        thread->waitQueue->Remove(thread);
     }
 
-    thread->state = THREAD_STATE_TERMINATED;
-    readyQueue.Remove([thread](ThreadControlBlock* t) { return t == thread; });
-    blockedQueue.Remove([thread](ThreadControlBlock* t) { return t == thread; });
+    {
+        SpinlockGuard guard(lock);
+
+        // Null out currentThread BEFORE freeing/deleting.
+        // Otherwise Schedule() will dereference dangling pointer.
+        if (thread == currentThread) {
+            currentThread = nullptr;
 
-    // Remove from parent's thread list to prevent KillProcess from
-    // iterating over a dangling pointer later.
-    if (thread->parent) {
-        thread->parent->threads.Remove([thread](ThreadControlBlock* t) { return t == thread; });
+            // We are still running on this stack: Schedule() hands it back once
+            // it has switched away for good.
+            dyingStack = thread->stack;
+            dyingStackClass = (KernelStackClass)thread->stackClass;
+            thread->stack = nullptr;
+        }
+
+        thread->state = THREAD_STATE_TERMINATED;
+        readyQueue.Remove([thread](ThreadControlBlock* t) { return t == thread; });
+        blockedQueue.Remove([thread](ThreadControlBlock* t) { return t == thread; });
+
+        // Remove from parent's thread list to prevent KillProcess from
+        // iterating over a dangling pointer later.
+        if (thread->parent) {
+            thread->parent->threads.Remove(
+                [thread](ThreadControlBlock* t) { return t == thread; });
+        }
     }
 
     if (thread->stack) {
-        kfree((void*)thread->stack);
+        KernelStackPool::Free(thread->stack, (KernelStackClass)thread->stackClass);
         thread->stack = nullptr;
     }
     delete thread;
 }
 
-bool Scheduler::ExitCurrentThread() {
+bool Scheduler::ExitCurrentThread(int32_t exitCode) {
     if (!currentThread) return false;
 
     ProcessControlBlock* parent = currentThread->parent;
@@ -356,34 +452,186 @@ bool Scheduler::ExitCurrentThread() {
     } else {
         DEBUG_LOG("Thread TID %d exiting, %d threads remain in process PID %d", currentThread->tid,
                   activeThreadCount - 1, parent->pid);
+
+        // Leave the status for JoinThread before the thread disappears, a joiner that
+        // saw it alive is already queued and gets woken here
+        if (!parent->isKernelProcess) {
+            ThreadExitRecord record = {currentThread->tid, parent->pid, exitCode};
+            uint32_t flags = joinWait.lock.Lock();
+            exitRecords.PushBack(record);
+            joinWait.WakeAllLocked();
+            joinWait.lock.Unlock(flags);
+        }
+
         TerminateThread(currentThread);
         return false;
     }
 }
 
+bool Scheduler::IsLiveThread(ProcessControlBlock* process, uint32_t tid) {
+    SpinlockGuard guard(lock);
+    ThreadControlBlock* t = process->threads.Find([tid](ThreadControlBlock* t) {
+        return t->tid == tid && t->state != THREAD_STATE_TERMINATED;
+    });
+    return t != nullptr;
+}
+
+int32_t Scheduler::JoinThread(uint32_t tid, int32_t* exitCode) {
+    ThreadControlBlock* self = currentThread;
+    if (!self || !self->parent) return THREAD_JOIN_ESRCH;
+    if (tid == self->tid) return THREAD_JOIN_EDEADLK;
+
+    ProcessControlBlock* process = self->parent;
+    uint32_t pid = process->pid;
+
+    while (true) {
+        uint32_t flags = joinWait.lock.Lock();
+        ThreadExitRecord record = exitRecords.Take(
+            [tid, pid](const ThreadExitRecord& r) { return r.tid == tid && r.pid == pid; });
+        if (record.tid) {
+            joinWait.lock.Unlock(flags);
+            if (exitCode) *exitCode = record.exitCode;
+            return THREAD_JOIN_OK;
+        }
+
+        // Not exited and not alive: never existed, another process, or joined already
+        if (!IsLiveThread(process, tid)) {
+            joinWait.lock.Unlock(flags);
+            return THREAD_JOIN_ESRCH;
+        }
+
+        joinWait.SleepLocked(flags);
+    }
+}
+
 void Scheduler::Sleep(uint32_t milliseconds) {
-    InterruptGuard guard;
     if (!currentThread) return;
-    currentThread->wakeTime = timerTicks + milliseconds;
-    currentThread->state = THREAD_STATE_BLOCKED;
+    BlockCurrent(milliseconds);
+
+    // Give up the CPU now instead of running until the next tick
+    if (CanBlock()) Yield();
 }
 
 void Scheduler::WakeThread(ThreadControlBlock* thread) {
-    InterruptGuard guard;
     if (!thread) return;
+    SpinlockGuard guard(lock);
     if (thread->state != THREAD_STATE_BLOCKED) return;
-    thread->state = THREAD_STATE_READY;
     thread->wakeTime = 0;
     blockedQueue.Remove([thread](ThreadControlBlock* t) { return t == thread; });
-    readyQueue.PushBack(thread);
+    MakeReady(thread, ReadTSC());
 }
 
-CPUState* Scheduler::Schedule(CPUState* context) {
+bool Scheduler::CanBlock() {
+    if (!currentThread || currentThread == idleThread) return false;
+    if (!InterruptManager::activeInstance) return false;
+    // Never switch away from inside a hardware IRQ handler
+    return !InterruptManager::InHardwareInterrupt();
+}
+
+void Scheduler::BlockCurrent(uint32_t timeoutMs) {
+    SpinlockGuard guard(lock);
+    if (!currentThread) return;
+    currentThread->wakeTime =
+        (timeoutMs == WAIT_FOREVER) ? WAIT_FOREVER : (uint32_t)(timerTicks + timeoutMs);
+    currentThread->state = THREAD_STATE_BLOCKED;
+}
+
+void Scheduler::Yield() {
+    // Kernel-only software interrupt, ends up in Schedule()
+    asm volatile("int $0x30" ::: "memory");
+}
+
+// Caller holds 'lock'
+void Scheduler::MakeReady(ThreadControlBlock* thread, uint64_t now) {
+    // A realtime thread that was preempted waits its turn like everybody else,
+    // only a fresh wake-up jumps the queue
+    bool jumpQueue = thread->priority == THREAD_PRIORITY_REALTIME &&
+                     thread->state != THREAD_STATE_RUNNING;
+    thread->state = THREAD_STATE_READY;
+    thread->readySince = now;
+    if (jumpQueue) {
+        readyQueue.Add(thread);
+        if (thread != currentThread) preemptPending = true;
+    } else {
+        readyQueue.PushBack(thread);
+    }
+}
+
+void Scheduler::SetPriority(ThreadControlBlock* thread, ThreadPriority priority) {
+    if (!thread) return;
+    SpinlockGuard guard(lock);
+    thread->priority = priority;
+}
+
+// Caller holds 'lock'. Charges the slice that just ended and records how long
+// 'next' sat in the ready queue.
+void Scheduler::AccountSwitch(ThreadControlBlock* next, uint64_t now, bool voluntary) {
+    uint64_t slice = now - lastSwitchTsc;
+    lastSwitchTsc = now;
+    totalCycles += slice;
+
+    // currentThread is null if it was killed during this slice
+    if (currentThread) {
+        currentThread->cpuCycles += slice;
+        if (currentThread->parent) currentThread->parent->cpuCycles += slice;
+        if (currentThread == idleThread) idleCycles += slice;
+    }
+
+    if (next != currentThread) {
+        contextSwitches++;
+        if (currentThread && currentThread != idleThread) {
+            if (voluntary) {
+                currentThread->voluntarySwitches++;
+            } else {
+                currentThread->involuntarySwitches++;
+            }
+        }
+    }
+
+    if (next && next != idleThread && next->readySince) {
+        uint64_t wait = (now - next->readySince) >> SCHED_LATENCY_SHIFT;
+        uint32_t bucket = 0;
+        while (wait && bucket < SCHED_LATENCY_BUCKETS - 1) {
+            wait >>= 1;
+            bucket++;
+        }
+        runQueueLatency[bucket]++;
+        next->readySince = 0;
+    }
+
+    // Close the sample window for the idle percentage and the TSC rate
+    uint32_t ticks = (uint32_t)timerTicks - windowStartTick;
+    if (ticks >= SCHED_STATS_WINDOW_MS) {
+        uint64_t windowTotal = now - windowStartTsc;
+        uint64_t windowIdle = idleCycles - windowStartIdle;
+        tscPerMs = (uint32_t)Div64(windowTotal, ticks);
+        while (windowTotal >> 32) {
+            windowTotal >>= 1;
+            windowIdle >>= 1;
+        }
+        idlePermille = windowTotal ? (uint32_t)Div64(windowIdle * 1000, (uint32_t)windowTotal) : 0;
+        windowStartTsc = now;
+        windowStartIdle = idleCycles;
+        windowStartTick = (uint32_t)timerTicks;
+        KernelData::Calibrate(tscPerMs, contextSwitches, idlePermille);
+    }
+}
+
+CPUState* Scheduler::Schedule(CPUState* context, bool voluntary) {
+    SpinlockGuard guard(lock);
+    uint64_t now = ReadTSC();
+
+    // The previous pass switched off this stack, nothing can be on it any more
+    if (retiredStack) {
+        KernelStackPool::Free(retiredStack, retiredStackClass);
+        retiredStack = nullptr;
+    }
     if (currentThread) {
         currentThread->context = context;
+        // Blocking or exiting always counts as giving the CPU up
+        if (currentThread->state != THREAD_STATE_RUNNING) voluntary = true;
         if ((currentThread->state == THREAD_STATE_RUNNING) && currentThread != idleThread) {
-            currentThread->state = THREAD_STATE_READY;
-            readyQueue.PushBack(currentThread);
+            MakeReady(currentThread, now);
         } else if (currentThread->state == THREAD_STATE_BLOCKED) {
             blockedQueue.PushBack(currentThread);
         } else if (currentThread->state == THREAD_STATE_TERMINATED) {
@@ -395,33 +643,42 @@ CPUState* Scheduler::Schedule(CPUState* context) {
         int count = blockedQueue.GetSize();
         for (int i = 0; i < count; i++) {
             ThreadControlBlock* t = blockedQueue.PopFront();
-            if (t->state == THREAD_STATE_BLOCKED && t->wakeTime <= timerTicks) {
-                t->state = THREAD_STATE_READY;
+            if (t->state == THREAD_STATE_BLOCKED && t->wakeTime != WAIT_FOREVER &&
+                t->wakeTime <= timerTicks) {
                 t->wakeTime = 0;
-                readyQueue.PushBack(t);
+                MakeReady(t, now);
             } else {
                 blockedQueue.PushBack(t);
             }
         }
     }
 
+    // Whatever was woken is on the ready queue now, the pick below sees it
+    preemptPending = false;
+
     if (readyQueue.GetSize() == 0) {
         // No real work to do, Run the Idle Thread.
+        AccountSwitch(idleThread, now, voluntary);
         currentThread = idleThread;
         currentThread->state = THREAD_STATE_RUNNING;
+        g_tss.esp0 = (uint32_t)(currentThread->stack + currentThread->stackSize);
+        RetireDyingStack();
         _pager->SwitchDirectory((_pager->KernelPageDirectory));
         return currentThread->context;
 
     } else {
         // Normal Round Robin
-        currentThread = readyQueue.PopFront();
+        ThreadControlBlock* next = readyQueue.PopFront();
+        AccountSwitch(next, now, voluntary);
+        currentThread = next;
     }
     currentThread->state = THREAD_STATE_RUNNING;
 
     // DEBUG_LOG("Switching to TID=%d, PID=%d, EIP=0x%x, ESP=0x%x", currentThread->tid,
     // currentThread->pid, currentThread->context->eip, currentThread->context->esp);
 
-    g_tss.esp0 = (uint32_t)(currentThread->stack + KERNEL_STACK_SIZE);
+    g_tss.esp0 = (uint32_t)(currentThread->stack + currentThread->stackSize);
+    RetireDyingStack();
 
     if (currentThread->parent) {
         _pager->SwitchDirectory((currentThread->parent->page_directory));
@@ -431,3 +688,47 @@ CPUState* Scheduler::Schedule(CPUState* context) {
 
     return currentThread->context;
 }
+
+// Called under 'lock' once the next thread is picked. The interrupt stub is still
+// on the dying stack until it loads the new context, so it is freed one pass later.
+void Scheduler::RetireDyingStack() {
+    if (!dyingStack) return;
+    retiredStack = dyingStack;
+    retiredStackClass = dyingStackClass;
+    dyingStack = nullptr;
+}
+
+uint32_t Scheduler::GetStats(SchedStatsInfo* info, ThreadStatsInfo* threads, uint32_t maxThreads) {
+    SpinlockGuard guard(lock);
+    uint32_t written = 0;
+    uint32_t live = 0;
+
+    auto add = [&](ThreadControlBlock* t) {
+        live++;
+        if (!threads || written >= maxThreads) return;
+        ThreadStatsInfo& out = threads[written++];
+        out.tid = t->tid;
+        out.pid = t->pid;
+        out.state = t->state;
+        out.voluntarySwitches = t->voluntarySwitches;
+        out.involuntarySwitches = t->involuntarySwitches;
+        out.cpuCycles = t->cpuCycles;
+        out.processCycles = t->parent ? t->parent->cpuCycles : 0;
+    };
+
+    if (idleThread) add(idleThread);
+    globalProcessList.ForEach([&](ProcessControlBlock* p) {
+        p->threads.ForEach([&](ThreadControlBlock* t) { add(t); });
+    });
+
+    if (info) {
+        info->totalCycles = totalCycles;
+        info->idleCycles = idleCycles;
+        info->idlePermille = idlePermille;
+        info->tscPerMs = tscPerMs;
+        info->contextSwitches = contextSwitches;
+        info->threadCount = live;
+        memcpy(info->runQueueLatency, runQueueLatency, sizeof(runQueueLatency));
+    }
+    return written;
+}
@@ -0,0 +1,103 @@
+/**
+ * @file        softirq.cpp
+ * @brief       Deferred interrupt work (softirqs and the kernel worker thread)
+ *
+ * @date        18/10/2026
+ * @version     1.0.0
+ */
+
+#include <core/scheduler.h>
+#include <core/softirq.h>
+
+SoftIRQ::Action SoftIRQ::actions[SOFTIRQ_COUNT];
+volatile uint32_t SoftIRQ::pending = 0;
+volatile bool SoftIRQ::running = false;
+
+SoftIRQ::Action SoftIRQ::work[WORKQUEUE_SIZE];
+uint32_t SoftIRQ::workHead = 0;
+uint32_t SoftIRQ::workTail = 0;
+WaitQueue SoftIRQ::workerWait;
+bool SoftIRQ::workerStarted = false;
+
+void SoftIRQ::Register(SoftIRQVector vector, DeferredFunc func, void* arg) {
+    if (vector >= SOFTIRQ_COUNT) return;
+    uint32_t flags = IrqSave();
+    actions[vector].func = func;
+    actions[vector].arg = arg;
+    IrqRestore(flags);
+}
+
+void SoftIRQ::Raise(SoftIRQVector vector) {
+    __atomic_or_fetch(&pending, 1u << vector, __ATOMIC_RELEASE);
+}
+
+void SoftIRQ::RunPending() {
+    uint32_t flags = IrqSave();
+    // Raised from an IRQ nested in a running pass: that pass picks it up
+    if (running) {
+        IrqRestore(flags);
+        return;
+    }
+    running = true;
+
+    for (int pass = 0; pass < SOFTIRQ_MAX_RESTART; pass++) {
+        uint32_t mask = __atomic_exchange_n(&pending, 0, __ATOMIC_ACQ_REL);
+        if (!mask) break;
+
+        asm volatile("sti");
+        for (uint32_t v = 0; v < SOFTIRQ_COUNT; v++) {
+            if ((mask & (1u << v)) && actions[v].func) {
+                actions[v].func(actions[v].arg);
+            }
+        }
+        asm volatile("cli");
+    }
+
+    running = false;
+    bool leftover = pending != 0;
+    IrqRestore(flags);
+
+    // Device keeps raising faster than we drain: let the worker take the rest
+    if (leftover && workerStarted) workerWait.WakeOne();
+}
+
+bool SoftIRQ::QueueWork(DeferredFunc func, void* arg) {
+    if (!func) return false;
+    SpinlockGuard guard(workerWait.lock);
+    if (workHead - workTail >= WORKQUEUE_SIZE) return false;
+
+    work[workHead % WORKQUEUE_SIZE].func = func;
+    work[workHead % WORKQUEUE_SIZE].arg = arg;
+    workHead++;
+    workerWait.WakeOneLocked();
+    return true;
+}
+
+void SoftIRQ::Worker(void* arg) {
+    while (true) {
+        RunPending();
+
+        uint32_t flags = workerWait.lock.Lock();
+        if (workHead == workTail) {
+            if (pending) {
+                workerWait.lock.Unlock(flags);
+            } else {
+                workerWait.SleepLocked(flags);
+            }
+            continue;
+        }
+
+        Action item = work[workTail % WORKQUEUE_SIZE];
+        workTail++;
+        workerWait.lock.Unlock(flags);
+
+        item.func(item.arg);
+    }
+}
+
+void SoftIRQ::StartWorker(Scheduler* scheduler) {
+    if (workerStarted) return;
+    scheduler->CreateProcess(true, Worker, scheduler);
+    workerStarted = true;
+    DEBUG_LOG("SoftIRQ: worker thread started");
+}
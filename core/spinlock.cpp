@@ -0,0 +1,65 @@
+/**
+ * @file        spinlock.cpp
+ * @brief       Lock-order checking for Spinlock / RWSpinlock
+ *
+ * @date        18/10/2026
+ * @version     1.0.0
+ */
+
+#include <core/ports.h>
+#include <core/spinlock.h>
+#include <debug.h>
+
+#if KDBG_ENABLE
+// Locks held on this CPU, one bit per LockLevel. Only touched with IRQs off.
+static uint32_t heldLevels = 0;
+static const char* heldNames[32];
+
+// printf takes the log lock, so a violation is reported straight to COM1.
+static void RawSerial(const char* str) {
+    for (int i = 0; str[i] != '\0'; i++) {
+        while ((inb(0x3F8 + 5) & 0x20) == 0) {
+        }
+        outb(0x3F8, str[i]);
+    }
+}
+
+void LockOrderAcquire(uint8_t level, const char* name) {
+    if (level == LOCK_LEVEL_NONE) return;
+
+    // Any held lock at this level or above means the order was broken (or recursion)
+    if (heldLevels >> level) {
+        RawSerial("\nLOCK ORDER VIOLATION: acquiring '");
+        RawSerial(name);
+        RawSerial("' while holding:");
+        for (int i = 31; i >= level; i--) {
+            if (heldLevels & (1u << i)) {
+                RawSerial(" '");
+                RawSerial(heldNames[i]);
+                RawSerial("'");
+            }
+        }
+        RawSerial("\n");
+        while (1) {
+            asm volatile("cli; hlt");
+        }
+    }
+    heldLevels |= (1u << level);
+    heldNames[level] = name;
+}
+
+void LockOrderRelease(uint8_t level) {
+    if (level == LOCK_LEVEL_NONE) return;
+    heldLevels &= ~(1u << level);
+}
+
+bool LockOrderAnyHeld() {
+    return heldLevels != 0;
+}
+#else
+void LockOrderAcquire(uint8_t level, const char* name) {}
+void LockOrderRelease(uint8_t level) {}
+bool LockOrderAnyHeld() {
+    return false;
+}
+#endif
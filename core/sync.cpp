@@ -0,0 +1,186 @@
+/**
+ * @file        sync.cpp
+ * @brief       Wait queues and sleeping synchronisation primitives
+ *
+ * @date        18/10/2026
+ * @version     1.0.0
+ */
+
+#include <core/scheduler.h>
+#include <core/sync.h>
+
+static uint32_t TimeoutToDeadline(uint32_t timeoutMs) {
+    if (timeoutMs == WAIT_FOREVER) return WAIT_FOREVER;
+    return (uint32_t)timerTicks + timeoutMs;
+}
+
+static uint32_t DeadlineToTimeout(uint32_t deadline) {
+    if (deadline == WAIT_FOREVER) return WAIT_FOREVER;
+    int32_t left = (int32_t)(deadline - (uint32_t)timerTicks);
+    return left > 0 ? (uint32_t)left : 0;
+}
+
+// --- WaitQueue ---
+
+bool WaitQueue::Wait(uint32_t timeoutMs) {
+    uint32_t flags = lock.Lock();
+    return SleepLocked(flags, timeoutMs);
+}
+
+bool WaitQueue::SleepLocked(uint32_t flags, uint32_t timeoutMs) {
+    Scheduler* sched = Scheduler::activeInstance;
+    if (!sched || !sched->CanBlock() || timeoutMs == 0) {
+        lock.Unlock(flags);
+        CpuRelax();
+        return false;
+    }
+
+    ThreadControlBlock* self = sched->GetCurrentThread();
+    waiters.PushBack(self);
+    self->waitQueue = this;
+    sched->BlockCurrent(timeoutMs);
+    lock.Unlock(flags);
+
+    if (LockOrderAnyHeld()) {
+        HALT("CRITICAL: WaitQueue: sleeping while holding a spinlock!\n");
+    }
+
+    // A wake-up may already have happened between Unlock and here; the extra
+    // pass through Schedule is harmless.
+    sched->Yield();
+
+    // Woken threads have been taken off the list by Wake*, a timeout leaves us on it
+    SpinlockGuard guard(lock);
+    if (self->waitQueue == this) {
+        waiters.Remove([self](ThreadControlBlock* t) { return t == self; });
+        self->waitQueue = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool WaitQueue::WakeOneLocked() {
+    ThreadControlBlock* t = waiters.PopFront();
+    if (!t) return false;
+    t->waitQueue = nullptr;
+    Scheduler::activeInstance->WakeThread(t);
+    return true;
+}
+
+uint32_t WaitQueue::WakeAllLocked() {
+    uint32_t woken = 0;
+    while (WakeOneLocked()) woken++;
+    return woken;
+}
+
+void WaitQueue::WakeOne() {
+    SpinlockGuard guard(lock);
+    WakeOneLocked();
+}
+
+void WaitQueue::WakeAll() {
+    SpinlockGuard guard(lock);
+    WakeAllLocked();
+}
+
+void WaitQueue::Remove(ThreadControlBlock* thread) {
+    SpinlockGuard guard(lock);
+    if (waiters.Remove([thread](ThreadControlBlock* t) { return t == thread; })) {
+        thread->waitQueue = nullptr;
+    }
+}
+
+// --- Mutex ---
+
+void Mutex::Lock() {
+    while (true) {
+        uint32_t flags = queue.lock.Lock();
+        if (!locked) {
+            locked = true;
+            owner = Scheduler::activeInstance ? Scheduler::activeInstance->GetCurrentThread()
+                                              : nullptr;
+            queue.lock.Unlock(flags);
+            return;
+        }
+        queue.SleepLocked(flags);
+    }
+}
+
+bool Mutex::TryLock() {
+    SpinlockGuard guard(queue.lock);
+    if (locked) return false;
+    locked = true;
+    owner = Scheduler::activeInstance ? Scheduler::activeInstance->GetCurrentThread() : nullptr;
+    return true;
+}
+
+void Mutex::Unlock() {
+    SpinlockGuard guard(queue.lock);
+    locked = false;
+    owner = nullptr;
+    queue.WakeOneLocked();
+}
+
+// --- Semaphore ---
+
+bool Semaphore::Wait(uint32_t timeoutMs) {
+    uint32_t deadline = TimeoutToDeadline(timeoutMs);
+    while (true) {
+        uint32_t flags = queue.lock.Lock();
+        if (count > 0) {
+            count--;
+            queue.lock.Unlock(flags);
+            return true;
+        }
+        uint32_t left = DeadlineToTimeout(deadline);
+        if (left == 0) {
+            queue.lock.Unlock(flags);
+            return false;
+        }
+        queue.SleepLocked(flags, left);
+    }
+}
+
+bool Semaphore::TryWait() {
+    SpinlockGuard guard(queue.lock);
+    if (count <= 0) return false;
+    count--;
+    return true;
+}
+
+void Semaphore::Signal() {
+    SpinlockGuard guard(queue.lock);
+    count++;
+    queue.WakeOneLocked();
+}
+
+// --- CondVar ---
+
+bool CondVar::Wait(Mutex& mutex, uint32_t timeoutMs) {
+    uint32_t seq = sequence;
+    mutex.Unlock();
+
+    bool woken = true;
+    uint32_t flags = queue.lock.Lock();
+    if (sequence == seq) {
+        // Nobody signalled since we dropped the mutex
+        woken = queue.SleepLocked(flags, timeoutMs);
+    } else {
+        queue.lock.Unlock(flags);
+    }
+
+    mutex.Lock();
+    return woken;
+}
+
+void CondVar::Signal() {
+    SpinlockGuard guard(queue.lock);
+    sequence++;
+    queue.WakeOneLocked();
+}
+
+void CondVar::Broadcast() {
+    SpinlockGuard guard(queue.lock);
+    sequence++;
+    queue.WakeAllLocked();
+}
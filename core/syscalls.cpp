@@ -8,11 +8,24 @@
 
 #include <core/drivers/keyboard.h>
 #include <core/drivers/mouse.h>
+#include <core/filesystem/FileTable.h>
 #include <core/filesystem/msdospart.h>
+#include <core/futex.h>
 #include <core/globals.h>
+#include <core/input.h>
+#include <core/ioring.h>
 #include <core/paging.h>
 #include <core/pmm.h>
 #include <core/syscalls.h>
+#include <core/systrace.h>
+#include <core/tss.h>
+
+extern TaskStateSegment g_tss;
+extern "C" void sysenter_entry();
+
+static inline void WriteMSR(uint32_t msr, uint32_t low, uint32_t high) {
+    asm volatile("wrmsr" ::"c"(msr), "a"(low), "d"(high));
+}
 
 SyscallHandler::SyscallHandler(uint8_t InterruptNumber, InterruptManager* interruptManager)
     : InterruptHandler(InterruptNumber + 0x20, interruptManager) {}
@@ -21,9 +34,11 @@ SyscallHandler::~SyscallHandler() {}
 
 uint32_t SyscallHandler::HandleInterrupt(uint32_t esp) {
     CPUState* cpu = (CPUState*)esp;
-    int32_t* return_data = (int32_t*)cpu->edx;
+    uint32_t number;
+    if (!SyscallHandlers::BeginCall(cpu, number)) return esp;
+    SyscallTraceScope trace(cpu, number, false);
 
-    switch ((uint32_t)cpu->eax) {
+    switch (number) {
         case sys_restart:
             SyscallHandlers::Handle_sys_restart(esp);
             break;
@@ -44,6 +59,66 @@ uint32_t SyscallHandler::HandleInterrupt(uint32_t esp) {
             SyscallHandlers::Handle_sys_sleep(esp);
             break;
 
+        case sys_open:
+            SyscallHandlers::Handle_sys_open(esp);
+            break;
+
+        case sys_read:
+            SyscallHandlers::Handle_sys_read(esp);
+            break;
+
+        case sys_write:
+            SyscallHandlers::Handle_sys_write(esp);
+            break;
+
+        case sys_lseek:
+            SyscallHandlers::Handle_sys_lseek(esp);
+            break;
+
+        case sys_close:
+            SyscallHandlers::Handle_sys_close(esp);
+            break;
+
+        case sys_sync:
+            SyscallHandlers::Handle_sys_sync(esp);
+            break;
+
+        case sys_futex_wait:
+            SyscallHandlers::Handle_sys_futex_wait(esp);
+            break;
+
+        case sys_futex_wake:
+            SyscallHandlers::Handle_sys_futex_wake(esp);
+            break;
+
+        case sys_sched_stats:
+            SyscallHandlers::Handle_sys_sched_stats(esp);
+            break;
+
+        case sys_yield:
+            SyscallHandlers::Handle_sys_yield(esp);
+            break;
+
+        case sys_thread_join:
+            SyscallHandlers::Handle_sys_thread_join(esp);
+            break;
+
+        case sys_ring_setup:
+            SyscallHandlers::Handle_sys_ring_setup(esp);
+            break;
+
+        case sys_ring_enter:
+            SyscallHandlers::Handle_sys_ring_enter(esp);
+            break;
+
+        case sys_trace:
+            SyscallHandlers::Handle_sys_trace(esp);
+            break;
+
+        case sys_input_wait:
+            SyscallHandlers::Handle_sys_input_wait(esp);
+            break;
+
         case sys_sbrk:
             SyscallHandlers::Handle_sys_sbrk(esp);
             break;
@@ -57,13 +132,87 @@ uint32_t SyscallHandler::HandleInterrupt(uint32_t esp) {
             break;
 
         default:
-            DEBUG_LOG("Unknown system call at 0x80: %u\n", cpu->eax);
+            DEBUG_LOG("Unknown system call at 0x80: %u\n", number);
+            SyscallHandlers::Return(cpu, SYSCALL_ENOSYS);
             break;
     }
 
+    SyscallHandlers::EndCall(cpu);
     return esp;
 }
 
+bool SyscallHandler::EnableSysenter() {
+    uint32_t eax, ebx, ecx, edx;
+    asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+
+    // SEP (bit 11). Family 6 model < 3 stepping < 3 reports it without supporting it.
+    uint32_t family = (eax >> 8) & 0xF;
+    uint32_t model = (eax >> 4) & 0xF;
+    uint32_t stepping = eax & 0xF;
+    if (!(edx & (1 << 11)) || (family == 6 && model < 3 && stepping < 3)) {
+        DEBUG_LOG("SYSENTER not supported, system calls stay on int 0x80");
+        return false;
+    }
+
+    // Entry ESP points at the TSS esp0 slot, the stub loads the kernel stack top
+    // from there, so nothing has to be rewritten on a context switch.
+    WriteMSR(MSR_SYSENTER_CS, 0x08, 0);
+    WriteMSR(MSR_SYSENTER_ESP, (uint32_t)&g_tss.esp0, 0);
+    WriteMSR(MSR_SYSENTER_EIP, (uint32_t)sysenter_entry, 0);
+    DEBUG_LOG("SYSENTER system call path enabled");
+    return true;
+}
+
+// Same handlers as the int 0x80/0x81 gates, minus the generic interrupt dispatch.
+// Runs with interrupts disabled, like the interrupt-gate path.
+uint32_t SyscallHandler::HandleSysenter(uint32_t esp) {
+    CPUState* cpu = (CPUState*)esp;
+    if (cpu->eax & SYSENTER_HGUI) {
+        cpu->eax &= ~SYSENTER_HGUI;
+        if (HguiHandler::activeInstance) HguiHandler::activeInstance->HandleInterrupt(esp);
+    } else if (g_sysCalls) {
+        g_sysCalls->HandleInterrupt(esp);
+    }
+
+    // The thread exited or was killed: switch away for good instead of
+    // returning to user space on a stack that is about to be recycled
+    Scheduler* sched = Scheduler::activeInstance;
+    if (!sched->currentThread || sched->currentThread->state == THREAD_STATE_TERMINATED) {
+        sched->Yield();
+    }
+    return esp;
+}
+
+bool SyscallHandlers::BeginCall(CPUState* cpu, uint32_t& number) {
+    uint32_t abi = (cpu->eax & SYSCALL_ABI_MASK) >> SYSCALL_ABI_SHIFT;
+    number = cpu->eax & SYSCALL_NUMBER_MASK;
+    cpu->syscallAbi = abi;
+
+    if (abi != SYSCALL_ABI_V1 && abi != SYSCALL_ABI_V2) {
+        DEBUG_LOG("System call %u with unknown ABI version %u", number, abi);
+        cpu->syscallAbi = SYSCALL_ABI_V2;
+        Return(cpu, SYSCALL_ENOSYS);
+        return false;
+    }
+    return true;
+}
+
+void SyscallHandlers::EndCall(CPUState* cpu) {
+    if (cpu->syscallAbi == SYSCALL_ABI_V2) Return(cpu, 0);
+}
+
+void SyscallHandlers::Return(CPUState* cpu, int32_t value, uint32_t extra0, uint32_t extra1) {
+    if ((cpu->syscallAbi & ~SYSCALL_ABI_RETURNED) == SYSCALL_ABI_V2) {
+        cpu->eax = (uint32_t)value;
+        cpu->edx = extra0;
+        cpu->ecx = extra1;
+    } else {
+        int32_t* return_data = (int32_t*)cpu->edx;
+        if (return_data) *return_data = value;
+    }
+    cpu->syscallAbi |= SYSCALL_ABI_RETURNED;
+}
+
 void SyscallHandlers::Handle_sys_restart(uint32_t esp) {
     DEBUG_LOG("sys_restart\n");
 
@@ -75,7 +224,9 @@ void SyscallHandlers::Handle_sys_restart(uint32_t esp) {
         ::"r"(0));
 }
 
+// EBX = exit status (handed to a thread joining this one)
 void SyscallHandlers::Handle_sys_exit(uint32_t esp) {
+    CPUState* cpu = (CPUState*)esp;
     Scheduler* sched = Scheduler::activeInstance;
     if (!sched) return;
 
@@ -83,7 +234,8 @@ void SyscallHandlers::Handle_sys_exit(uint32_t esp) {
     ProcessControlBlock* process = sched->GetCurrentProcess();
     uint32_t pid = process ? process->pid : 0;
 
-    bool processKilled = sched->ExitCurrentThread();
+    int32_t status = (int32_t)cpu->ebx;
+    bool processKilled = sched->ExitCurrentThread(status);
 
     // Clean up GUI resources only if the entire process was terminated
     if (processKilled && pid) {
@@ -99,7 +251,7 @@ void SyscallHandlers::Handle_sys_exit(uint32_t esp) {
             if (Desktop::activeInstance) Desktop::activeInstance->MarkDirty();
         }
 
-        DEBUG_LOG("sys_exit: Process PID %d terminated\n", pid);
+        DEBUG_LOG("sys_exit: Process PID %d terminated, status %d\n", pid, status);
     }
 }
 
@@ -107,12 +259,11 @@ void SyscallHandlers::Handle_sys_peek_memory(uint32_t esp) {
     CPUState* cpu = (CPUState*)esp;
     uint32_t address = cpu->ebx;
     uint32_t size = cpu->ecx;
-    int32_t* return_data = (int32_t*)cpu->edx;
 
     // Only allow reading from identity-mapped kernel range (0 - 256MB)
     uint32_t limit = 256 * 1024 * 1024;
     if (address + size > limit || size == 0 || size > 4) {
-        *return_data = 0;
+        Return(cpu, 0);
         return;
     }
 
@@ -128,18 +279,19 @@ void SyscallHandlers::Handle_sys_peek_memory(uint32_t esp) {
             value = *(uint32_t*)address;
             break;
     }
-    *return_data = (int32_t)value;
+    Return(cpu, (int32_t)value);
 }
 
+// EBX = entry point, ECX = argument. Returns the new thread's TID (0 on failure)
 void SyscallHandlers::Handle_sys_clone(uint32_t esp) {
     CPUState* cpu = (CPUState*)esp;
-    int32_t* return_data = (int32_t*)cpu->edx;
     DEBUG_LOG("sys_clone: Creating a new Thread");
 
     ProcessControlBlock* current_process = Scheduler::activeInstance->GetCurrentProcess();
-    *return_data = (int32_t)Scheduler::activeInstance->CreateThread(
+    ThreadControlBlock* thread = Scheduler::activeInstance->CreateThread(
         current_process, reinterpret_cast<void (*)(void*)>(cpu->ebx),
         reinterpret_cast<void*>(cpu->ecx));
+    Return(cpu, thread ? (int32_t)thread->tid : 0);
 }
 
 void SyscallHandlers::Handle_sys_sleep(uint32_t esp) {
@@ -149,11 +301,247 @@ void SyscallHandlers::Handle_sys_sleep(uint32_t esp) {
     Scheduler::activeInstance->Sleep((cpu->ebx));
 }
 
+// Copies a NUL-terminated user string, checking each page before touching it
+static bool CopyUserString(ProcessControlBlock* process, uint32_t addr, char* out, uint32_t max) {
+    for (uint32_t i = 0; i < max; i++) {
+        if (i == 0 || ((addr + i) & (PAGE_SIZE - 1)) == 0) {
+            if (!g_paging->IsUserRangeMapped(process->page_directory, addr + i, 1)) return false;
+        }
+        out[i] = ((char*)addr)[i];
+        if (!out[i]) return true;
+    }
+    return false;  // Too long
+}
+
+// EBX = path. Returns the descriptor, extra0 = file size.
+void SyscallHandlers::Handle_sys_open(uint32_t esp) {
+    CPUState* cpu = (CPUState*)esp;
+    ProcessControlBlock* process = Scheduler::activeInstance->GetCurrentProcess();
+    if (!process || !g_bootPartition) {
+        Return(cpu, FD_EINVAL);
+        return;
+    }
+
+    char path[FD_PATH_MAX];
+    if (!CopyUserString(process, cpu->ebx, path, FD_PATH_MAX)) {
+        Return(cpu, FD_EFAULT);
+        return;
+    }
+
+    // Interrupts are off here, so two threads cannot both create the table
+    if (!process->files) {
+        process->files = new FileTable();
+        if (!process->files) {
+            Return(cpu, FD_EMFILE);
+            return;
+        }
+    }
+
+    uint32_t size = 0;
+    int32_t fd = process->files->Open(g_bootPartition, path, size);
+    Return(cpu, fd, fd >= 0 ? size : 0);
+}
+
+// EBX = fd, ECX = buffer, ESI = length. Returns bytes read, 0 at end of file.
+void SyscallHandlers::Handle_sys_read(uint32_t esp) {
+    CPUState* cpu = (CPUState*)esp;
+    ProcessControlBlock* process = Scheduler::activeInstance->GetCurrentProcess();
+    if (!process || !process->files) {
+        Return(cpu, FD_EBADF);
+        return;
+    }
+    if (cpu->esi == 0) {
+        Return(cpu, 0);
+        return;
+    }
+    if (!g_paging->IsUserRangeWritable(process->page_directory, cpu->ecx, cpu->esi)) {
+        Return(cpu, FD_EFAULT);
+        return;
+    }
+    Return(cpu, process->files->Read((int32_t)cpu->ebx, (uint8_t*)cpu->ecx, cpu->esi));
+}
+
+// EBX = fd, ECX = buffer, ESI = length. Only stdout/stderr (the kernel console) are
+// writable: the FAT32 driver has no streaming writes, files open read-only.
+void SyscallHandlers::Handle_sys_write(uint32_t esp) {
+    CPUState* cpu = (CPUState*)esp;
+    ProcessControlBlock* process = Scheduler::activeInstance->GetCurrentProcess();
+    int32_t fd = (int32_t)cpu->ebx;
+    if (!process) {
+        Return(cpu, FD_EBADF);
+        return;
+    }
+
+    if (fd == FD_STDOUT || fd == FD_STDERR) {
+        if (!g_paging->IsUserRangeMapped(process->page_directory, cpu->ecx, cpu->esi)) {
+            Return(cpu, FD_EFAULT);
+            return;
+        }
+        const char* src = (const char*)cpu->ecx;
+        char chunk[129];
+        for (uint32_t done = 0; done < cpu->esi;) {
+            uint32_t n = cpu->esi - done < 128 ? cpu->esi - done : 128;
+            memcpy(chunk, src + done, n);
+            chunk[n] = 0;
+            printf("%s", chunk);
+            done += n;
+        }
+        Return(cpu, (int32_t)cpu->esi);
+        return;
+    }
+
+    Return(cpu, (process->files && process->files->IsOpen(fd)) ? FD_EROFS : FD_EBADF);
+}
+
+// EBX = fd, ECX = offset, ESI = FD_SEEK_*. Returns the new position.
+void SyscallHandlers::Handle_sys_lseek(uint32_t esp) {
+    CPUState* cpu = (CPUState*)esp;
+    ProcessControlBlock* process = Scheduler::activeInstance->GetCurrentProcess();
+    if (!process || !process->files) {
+        Return(cpu, FD_EBADF);
+        return;
+    }
+    Return(cpu, process->files->Seek((int32_t)cpu->ebx, (int32_t)cpu->ecx, cpu->esi));
+}
+
+// EBX = fd
+void SyscallHandlers::Handle_sys_close(uint32_t esp) {
+    CPUState* cpu = (CPUState*)esp;
+    ProcessControlBlock* process = Scheduler::activeInstance->GetCurrentProcess();
+    if (!process || !process->files) {
+        Return(cpu, FD_EBADF);
+        return;
+    }
+    Return(cpu, process->files->Close((int32_t)cpu->ebx));
+}
+
+// Write every mounted volume's cached changes to disk
+void SyscallHandlers::Handle_sys_sync(uint32_t esp) {
+    CPUState* cpu = (CPUState*)esp;
+    MSDOSPartitionTable::SyncAll();
+    Return(cpu, 0);
+}
+
+// Give the rest of the quantum to the next ready thread
+void SyscallHandlers::Handle_sys_yield(uint32_t esp) {
+    Scheduler::activeInstance->Yield();
+}
+
+// EBX = TID, ECX = int32_t* for its exit status (V1 callers, may be null)
+// Returns a THREAD_JOIN_* code, the exit status is the first extra value
+void SyscallHandlers::Handle_sys_thread_join(uint32_t esp) {
+    CPUState* cpu = (CPUState*)esp;
+    int32_t* statusOut = (int32_t*)cpu->ecx;
+
+    // Checked before joining, so a bad pointer does not cost the exit status
+    ProcessControlBlock* process = Scheduler::activeInstance->GetCurrentProcess();
+    if (statusOut && (!process || !g_paging->IsUserRangeWritable(process->page_directory,
+                                                                 (uint32_t)statusOut,
+                                                                 sizeof(int32_t)))) {
+        Return(cpu, THREAD_JOIN_EFAULT);
+        return;
+    }
+
+    int32_t exitCode = 0;
+    int32_t result = Scheduler::activeInstance->JoinThread(cpu->ebx, &exitCode);
+    if (result == THREAD_JOIN_OK && statusOut) *statusOut = exitCode;
+    Return(cpu, result, (uint32_t)exitCode);
+}
+
+// EBX = ring memory, ECX = entries (power of two, 0 unregisters)
+void SyscallHandlers::Handle_sys_ring_setup(uint32_t esp) {
+    CPUState* cpu = (CPUState*)esp;
+    ProcessControlBlock* process = Scheduler::activeInstance->GetCurrentProcess();
+    Return(cpu, IORing::Setup(process, cpu->ebx, cpu->ecx));
+}
+
+// EBX = SQEs to submit (0 = all queued). Returns how many were consumed.
+void SyscallHandlers::Handle_sys_ring_enter(uint32_t esp) {
+    CPUState* cpu = (CPUState*)esp;
+    ProcessControlBlock* process = Scheduler::activeInstance->GetCurrentProcess();
+    Return(cpu, IORing::Enter(process, cpu->ebx));
+}
+
+// EBX = SYSTRACE_OP_*, ECX/ESI = operation arguments (core/systrace.h)
+void SyscallHandlers::Handle_sys_trace(uint32_t esp) {
+    CPUState* cpu = (CPUState*)esp;
+    ProcessControlBlock* process = Scheduler::activeInstance->GetCurrentProcess();
+    uint32_t extra;
+    int32_t result = SyscallTrace::Control(process, cpu->ebx, cpu->ecx, cpu->esi, extra);
+    Return(cpu, result, extra);
+}
+
+// EBX = InputEvent[], ECX = capacity, ESI = timeout in ms (WAIT_FOREVER blocks, 0 polls).
+// Returns the events copied, extra0 = events dropped because the queue was full.
+void SyscallHandlers::Handle_sys_input_wait(uint32_t esp) {
+    CPUState* cpu = (CPUState*)esp;
+    ProcessControlBlock* process = Scheduler::activeInstance->GetCurrentProcess();
+    uint32_t lost;
+    int32_t result = InputQueue::Wait(process, (InputEvent*)cpu->ebx, cpu->ecx, cpu->esi, lost);
+    Return(cpu, result, lost);
+}
+
+// EBX = futex word, ECX = expected value, ESI = timeout in ms (0 = none)
+void SyscallHandlers::Handle_sys_futex_wait(uint32_t esp) {
+    CPUState* cpu = (CPUState*)esp;
+    ProcessControlBlock* process = Scheduler::activeInstance->GetCurrentProcess();
+    if (!process) {
+        Return(cpu, FUTEX_EINVAL);
+        return;
+    }
+
+    int32_t result = Futex::Wait(process->page_directory, cpu->ebx, cpu->ecx, cpu->esi);
+    Return(cpu, result);
+}
+
+// EBX = futex word, ECX = max threads to wake
+void SyscallHandlers::Handle_sys_futex_wake(uint32_t esp) {
+    CPUState* cpu = (CPUState*)esp;
+    ProcessControlBlock* process = Scheduler::activeInstance->GetCurrentProcess();
+    if (!process) {
+        Return(cpu, FUTEX_EINVAL);
+        return;
+    }
+
+    int32_t result = Futex::Wake(process->page_directory, cpu->ebx, cpu->ecx);
+    Return(cpu, result);
+}
+
+// EBX = SchedStatsInfo*, ECX = ThreadStatsInfo[] (may be null), ESI = array length
+// Returns the number of thread entries filled in, or SCHED_STATS_EFAULT
+void SyscallHandlers::Handle_sys_sched_stats(uint32_t esp) {
+    CPUState* cpu = (CPUState*)esp;
+    ProcessControlBlock* process = Scheduler::activeInstance->GetCurrentProcess();
+    SchedStatsInfo* infoOut = (SchedStatsInfo*)cpu->ebx;
+    ThreadStatsInfo* threadsOut = (ThreadStatsInfo*)cpu->ecx;
+    uint32_t max = threadsOut ? cpu->esi : 0;
+    if (max > SCHED_STATS_MAX_THREADS) max = SCHED_STATS_MAX_THREADS;
+
+    if (!process ||
+        (infoOut && !g_paging->IsUserRangeWritable(process->page_directory, (uint32_t)infoOut,
+                                                   sizeof(SchedStatsInfo))) ||
+        (max && !g_paging->IsUserRangeWritable(process->page_directory, (uint32_t)threadsOut,
+                                               max * sizeof(ThreadStatsInfo)))) {
+        Return(cpu, SCHED_STATS_EFAULT);
+        return;
+    }
+
+    // Snapshot into kernel memory under the scheduler lock, copy out after it
+    SchedStatsInfo info;
+    ThreadStatsInfo* threads = max ? new ThreadStatsInfo[max] : nullptr;
+    if (max && !threads) max = 0;
+    uint32_t written = Scheduler::activeInstance->GetStats(&info, threads, max);
+
+    if (infoOut) memcpy(infoOut, &info, sizeof(info));
+    if (written) memcpy(threadsOut, threads, written * sizeof(ThreadStatsInfo));
+    if (threads) delete[] threads;
+    Return(cpu, (int32_t)written);
+}
+
 void SyscallHandlers::Handle_sys_sbrk(uint32_t esp) {
     CPUState* cpu = (CPUState*)esp;
     ProcessControlBlock* process = Scheduler::activeInstance->GetCurrentProcess();
     int32_t increment = (int32_t)cpu->ebx;
-    int32_t* return_data = (int32_t*)cpu->edx;
 
     uint32_t old_brk = process->heap.endAddress;
     uint32_t new_brk = old_brk + increment;
@@ -162,7 +550,7 @@ void SyscallHandlers::Handle_sys_sbrk(uint32_t esp) {
         if (new_brk > process->heap.maxAddress) {
             DEBUG_LOG("sbrk: Heap Overflow! Max: 0x%x, Req: 0x%x", process->heap.maxAddress,
                       new_brk);
-            *return_data = -1;
+            Return(cpu, -1);
             return;
         }
 
@@ -176,7 +564,7 @@ void SyscallHandlers::Handle_sys_sbrk(uint32_t esp) {
                     uint32_t phys_frame = (uint32_t)pmm_alloc_block();
                     if (!phys_frame) {
                         DEBUG_LOG("sbrk: Out of physical memory!");
-                        *return_data = -1;
+                        Return(cpu, -1);
                         return;
                     }
                     if (!g_paging->MapPage(process->page_directory, addr, phys_frame,
@@ -184,7 +572,7 @@ void SyscallHandlers::Handle_sys_sbrk(uint32_t esp) {
                         /* Mapping failed (likely out of low memory for page tables) */
                         pmm_free_block((void*)phys_frame);
                         DEBUG_LOG("sbrk: MapPage failed!");
-                        *return_data = -1;
+                        Return(cpu, -1);
                         return;
                     }
                     // No memset needed - kernel doesn't identity map high memory
@@ -195,15 +583,14 @@ void SyscallHandlers::Handle_sys_sbrk(uint32_t esp) {
 
     // Update process heap end
     process->heap.endAddress = new_brk;
-    *return_data = (int32_t)old_brk;
+    Return(cpu, (int32_t)old_brk);
 }
 
 void SyscallHandlers::Handle_sys_debug(uint32_t esp) {
     CPUState* cpu = (CPUState*)esp;
     char* userString = (char*)cpu->ebx;
 
-    // ATOMIC PRINT
-    InterruptGuard guard;
+    // printf holds the log lock for the whole string, so this stays atomic
     printf("%s", userString);
 }
 
@@ -213,13 +600,16 @@ void SyscallHandlers::Handle_sys_Hcall(uint32_t esp) {
     ProcessControlBlock* current_process = Scheduler::activeInstance->GetCurrentProcess();
 
     multi_para_model* data = (multi_para_model*)cpu->ecx;
-    int32_t* return_data = (int32_t*)cpu->edx;
 
     if (cpu->ebx == Hsys_getHeap) {
-        // Write heap addresses to the pointers provided in param0 and param1
-        data->param0 = current_process->heap.startAddress;
-        data->param1 = current_process->heap.endAddress;
-        *return_data = 1;
+        // Heap bounds as the extra values, and in param0/param1 for V1 callers
+        uint32_t start = current_process->heap.startAddress;
+        uint32_t end = current_process->heap.endAddress;
+        if (data) {
+            data->param0 = start;
+            data->param1 = end;
+        }
+        Return(cpu, 1, start, end);
     } else if (cpu->ebx == Hsys_regEventH) {
         DEBUG_LOG("Hsys_regEventH: Creating a new Thread for handler");
         void* threadArgs = (void*)data->param0;
@@ -231,7 +621,7 @@ void SyscallHandlers::Handle_sys_Hcall(uint32_t esp) {
 
         Desktop::activeInstance->createNewHandler(current_process->pid, thread);
 
-        *return_data = (uint32_t)thread->tid;
+        Return(cpu, (uint32_t)thread->tid);
     } else if (cpu->ebx == Hsys_getFramebuffer) {
         // Return framebuffer info: param0=buffer
         extern GraphicsDriver* g_GraphicsDriver;
@@ -280,9 +670,9 @@ void SyscallHandlers::Handle_sys_Hcall(uint32_t esp) {
             g_gui_owner_pid = Scheduler::activeInstance->GetCurrentProcess()->pid;
             DEBUG_LOG("Hsys_getFramebuffer: PID %d took ownership of screen", g_gui_owner_pid);
 
-            *return_data = 1;
+            Return(cpu, 1);
         } else {
-            *return_data = -1;
+            Return(cpu, -1);
         }
     } else if (cpu->ebx == Hsys_getInput) {
         struct InputState {
@@ -309,9 +699,9 @@ void SyscallHandlers::Handle_sys_Hcall(uint32_t esp) {
                 userState->mouseDY = dy;
                 userState->mouseButtons = MouseDriver::activeInstance->GetButtons();
             }
-            *return_data = 1;
+            Return(cpu, 1);
         } else {
-            *return_data = -1;
+            Return(cpu, -1);
         }
     } else if (cpu->ebx == Hsys_readFile) {
         extern MSDOSPartitionTable* g_PartitionTable;
@@ -329,11 +719,13 @@ void SyscallHandlers::Handle_sys_Hcall(uint32_t esp) {
             if (fs) {
                 DEBUG_LOG("Hsys_readFile: Opening %s", filename);
 
-                // Validate Buffer is User Space
-                if ((uint32_t)destBuffer < 0x10000000) {
-                    DEBUG_LOG("Hsys_readFile: SECURITY VIOLATION: Buffer in Kernel Space! 0x%x",
+                // Validate Buffer is writable User Space
+                ProcessControlBlock* caller = Scheduler::activeInstance->GetCurrentProcess();
+                if (!caller || !g_paging->IsUserRangeWritable(caller->page_directory,
+                                                              (uint32_t)destBuffer, maxSize)) {
+                    DEBUG_LOG("Hsys_readFile: SECURITY VIOLATION: Bad user buffer 0x%x",
                               destBuffer);
-                    *return_data = -1;
+                    Return(cpu, -1);
                     return;
                 }
 
@@ -346,14 +738,15 @@ void SyscallHandlers::Handle_sys_Hcall(uint32_t esp) {
                     int bytesRead = file->Read(destBuffer, readSize);
                     DEBUG_LOG("Hsys_readFile: Read %d bytes. Closing...", bytesRead);
 
-                    data->param3 = file->size;  // Report actual file size
+                    uint32_t fileSize = file->size;
+                    data->param3 = fileSize;  // Report actual file size
                     file->Close();
 
                     DEBUG_LOG("Hsys_readFile: Deleting file object...");
                     delete file;
 
                     DEBUG_LOG("Hsys_readFile: Success.");
-                    *return_data = bytesRead;
+                    Return(cpu, bytesRead, fileSize);
                 } else {
                     if (file) {
                         DEBUG_LOG("Hsys_readFile: Empty file %s", filename);
@@ -362,16 +755,17 @@ void SyscallHandlers::Handle_sys_Hcall(uint32_t esp) {
                     } else {
                         DEBUG_LOG("Hsys_readFile: Failed to open %s", filename);
                     }
-                    *return_data = -1;
+                    Return(cpu, -1);
                 }
             } else {
-                *return_data = -1;
+                Return(cpu, -1);
             }
         } else {
-            *return_data = -1;
+            Return(cpu, -1);
         }
     } else {
         // Default case (optional: handle unknown Hcalls)
         DEBUG_LOG("Unknown Hcall ID: %d", cpu->ebx);
+        Return(cpu, SYSCALL_ENOSYS);
     }
 }
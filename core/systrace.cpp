@@ -0,0 +1,254 @@
+/**
+ * @file        systrace.cpp
+ * @brief       System call counters, latency and trace ring
+ *
+ * @date        18/10/2026
+ * @version     1.0.0
+ */
+
+#include <core/paging.h>
+#include <core/scheduler.h>
+#include <core/syscalls.h>
+#include <core/systrace.h>
+#include <core/timing.h>
+
+SyscallTraceEntry SyscallTrace::ring[SYSTRACE_RING_SIZE];
+uint32_t SyscallTrace::ringHead = 0;
+uint32_t SyscallTrace::ringTail = 0;
+uint32_t SyscallTrace::lost = 0;
+volatile uint32_t SyscallTrace::tracePid = SYSTRACE_PID_NONE;
+volatile uint32_t SyscallTrace::traceFlags = 0;
+Spinlock SyscallTrace::lock("systrace", LOCK_LEVEL_TRACE);
+char SyscallTrace::bootApp[SYSTRACE_APP_MAX];
+
+SyscallTraceScope::SyscallTraceScope(CPUState* cpu, uint32_t number, bool hgui) : cpu(cpu) {
+    thread = Scheduler::activeInstance ? Scheduler::activeInstance->GetCurrentThread() : nullptr;
+    call = hgui ? (number | SYSTRACE_HGUI) : number;
+    // The result overwrites EAX/ECX/EDX, keep the arguments as they came in
+    args[0] = cpu->ebx;
+    args[1] = cpu->ecx;
+    args[2] = cpu->esi;
+    start = ReadTSC();
+}
+
+SyscallTraceScope::~SyscallTraceScope() {
+    uint64_t elapsed = ReadTSC() - start;
+
+    // sys_exit (or a kill) may have taken the thread and its process with it
+    Scheduler* sched = Scheduler::activeInstance;
+    if (!thread || !sched || sched->currentThread != thread ||
+        thread->state == THREAD_STATE_TERMINATED || !thread->parent) {
+        return;
+    }
+
+    int32_t result = 0;
+    if (cpu->syscallAbi & SYSCALL_ABI_RETURNED) {
+        if ((cpu->syscallAbi & ~SYSCALL_ABI_RETURNED) == SYSCALL_ABI_V2) {
+            result = (int32_t)cpu->eax;
+        } else if (cpu->edx) {
+            result = *(int32_t*)cpu->edx;  // Return() just wrote it
+        }
+    }
+
+    uint32_t cycles = (elapsed >> 32) ? 0xFFFFFFFF : (uint32_t)elapsed;
+    SyscallTrace::Record(thread, call, args, result, start, cycles);
+}
+
+SyscallStatEntry* SyscallTrace::Slot(SyscallStats* stats, uint32_t call) {
+    uint32_t hash = (call ^ (call >> 16)) * 2654435761u;
+    for (uint32_t i = 0; i < SYSTRACE_STAT_SLOTS; i++) {
+        SyscallStatEntry* slot = &stats->slots[(hash + i) % SYSTRACE_STAT_SLOTS];
+        if (slot->count == 0) {
+            slot->call = call;
+            return slot;
+        }
+        if (slot->call == call) return slot;
+    }
+    return nullptr;
+}
+
+void SyscallTrace::Record(ThreadControlBlock* thread, uint32_t call, const uint32_t* args,
+                          int32_t result, uint64_t start, uint32_t cycles) {
+    ProcessControlBlock* process = thread->parent;
+
+    if (!process->syscallStats) {
+        process->syscallStats = new SyscallStats();
+    }
+    if (process->syscallStats) {
+        SyscallStatEntry* slot = Slot(process->syscallStats, call);
+        if (slot) {
+            slot->count++;
+            slot->totalCycles += cycles;
+            if (cycles > slot->maxCycles) slot->maxCycles = cycles;
+        } else {
+            process->syscallStats->dropped++;
+        }
+    }
+
+    uint32_t pid = tracePid;
+    if (pid == SYSTRACE_PID_NONE || (pid != SYSTRACE_PID_ALL && pid != process->pid)) return;
+    uint32_t flags = traceFlags;
+
+    SyscallTraceEntry entry;
+    entry.tsc = start;
+    entry.pid = process->pid;
+    entry.tid = thread->tid;
+    entry.call = call;
+    entry.args[0] = args[0];
+    entry.args[1] = args[1];
+    entry.args[2] = args[2];
+    entry.result = result;
+    entry.cycles = cycles;
+
+    if (flags & SYSTRACE_TO_RING) {
+        SpinlockGuard guard(lock);
+        if (ringTail - ringHead == SYSTRACE_RING_SIZE) {
+            ringHead++;
+            lost++;
+        }
+        ring[ringTail % SYSTRACE_RING_SIZE] = entry;
+        ringTail++;
+    }
+
+    if (flags & SYSTRACE_TO_SERIAL) {
+        PRINT("strace", "pid %d tid %d %s%d(0x%x, 0x%x, 0x%x) = %d [%u cycles]\n", entry.pid,
+              entry.tid, (call & SYSTRACE_HGUI) ? "hgui:" : "", call & ~SYSTRACE_HGUI,
+              entry.args[0], entry.args[1], entry.args[2], result, cycles);
+    }
+}
+
+int32_t SyscallTrace::Control(ProcessControlBlock* caller, uint32_t op, uint32_t arg0,
+                              uint32_t arg1, uint32_t& extra) {
+    extra = 0;
+    if (!caller) return SYSTRACE_EINVAL;
+
+    if (arg0 == SYSTRACE_PID_SELF && op != SYSTRACE_OP_DRAIN) arg0 = caller->pid;
+
+    if (op == SYSTRACE_OP_FILTER) {
+        // A user process may only trace itself, and not take over or stop another's trace
+        if (!caller->isKernelProcess) {
+            uint32_t current = tracePid;
+            if (arg1 && arg0 != caller->pid) return SYSTRACE_EPERM;
+            if (current != SYSTRACE_PID_NONE && current != caller->pid) return SYSTRACE_EPERM;
+        }
+        traceFlags = arg1;
+        tracePid = arg1 ? arg0 : SYSTRACE_PID_NONE;
+        DEBUG_LOG("SyscallTrace: tracing pid 0x%x, flags 0x%x", tracePid, traceFlags);
+        return 0;
+    }
+
+    if (op == SYSTRACE_OP_DRAIN) {
+        if (arg1 == 0) return 0;
+        if (arg1 > SYSTRACE_RING_SIZE) arg1 = SYSTRACE_RING_SIZE;
+        if (!g_paging->IsUserRangeWritable(caller->page_directory, arg0,
+                                           arg1 * sizeof(SyscallTraceEntry))) {
+            return SYSTRACE_EFAULT;
+        }
+
+        // A user process only gets its own records, the others stay queued in order
+        SyscallTraceEntry* out = (SyscallTraceEntry*)arg0;
+        uint32_t written = 0;
+        SpinlockGuard guard(lock);
+        uint32_t keep = ringHead;
+        for (uint32_t i = ringHead; i != ringTail; i++) {
+            SyscallTraceEntry& entry = ring[i % SYSTRACE_RING_SIZE];
+            if (written < arg1 && (caller->isKernelProcess || entry.pid == caller->pid))
+                out[written++] = entry;
+            else
+                ring[keep++ % SYSTRACE_RING_SIZE] = entry;
+        }
+        ringTail = keep;
+        extra = lost;
+        lost = 0;
+        return (int32_t)written;
+    }
+
+    if (op != SYSTRACE_OP_STATS && op != SYSTRACE_OP_RESET) return SYSTRACE_EINVAL;
+
+    if (!caller->isKernelProcess && arg0 != caller->pid) return SYSTRACE_EPERM;
+    ProcessControlBlock* target =
+        (arg0 == caller->pid) ? caller : Scheduler::activeInstance->FindProcess(arg0);
+    if (!target) return SYSTRACE_ESRCH;
+    SyscallStats* stats = target->syscallStats;
+
+    if (op == SYSTRACE_OP_RESET) {
+        if (stats) memset(stats, 0, sizeof(SyscallStats));
+        return 0;
+    }
+
+    if (!g_paging->IsUserRangeWritable(caller->page_directory, arg1,
+                                       SYSTRACE_STAT_SLOTS * sizeof(SyscallStatEntry))) {
+        return SYSTRACE_EFAULT;
+    }
+    if (!stats) return 0;
+
+    SyscallStatEntry* out = (SyscallStatEntry*)arg1;
+    uint32_t written = 0;
+    for (uint32_t i = 0; i < SYSTRACE_STAT_SLOTS; i++) {
+        if (stats->slots[i].count) out[written++] = stats->slots[i];
+    }
+    extra = stats->dropped;
+    return (int32_t)written;
+}
+
+void SyscallTrace::Configure(const char* cmdline) {
+    static const char option[] = "systrace=";
+    if (!cmdline) return;
+
+    for (const char* p = cmdline; *p; p++) {
+        if (p != cmdline && p[-1] != ' ') continue;
+        uint32_t n = 0;
+        while (option[n] && p[n] == option[n]) n++;
+        if (option[n]) continue;
+
+        p += n;
+        n = 0;
+        while (p[n] && p[n] != ' ' && n < SYSTRACE_APP_MAX - 1) {
+            bootApp[n] = p[n];
+            n++;
+        }
+        bootApp[n] = 0;
+        DEBUG_LOG("SyscallTrace: tracing programs matching '%s'", bootApp);
+        return;
+    }
+}
+
+void SyscallTrace::Launched(ProcessControlBlock* process, const char* path) {
+    if (!process || !path || !bootApp[0]) return;
+
+    for (const char* p = path; *p; p++) {
+        uint32_t n = 0;
+        while (bootApp[n] && p[n] == bootApp[n]) n++;
+        if (bootApp[n]) continue;
+
+        // Set from the kernel, so the program itself cannot replace the filter
+        traceFlags = SYSTRACE_TO_SERIAL;
+        tracePid = process->pid;
+        PRINT("strace", "tracing pid %d (%s)\n", process->pid, path);
+        return;
+    }
+}
+
+void SyscallTrace::ReleaseProcess(ProcessControlBlock* process) {
+    SyscallStats* stats = process->syscallStats;
+    if (!stats) return;
+    process->syscallStats = nullptr;
+
+    uint32_t pid = tracePid;
+    if (pid == process->pid || pid == SYSTRACE_PID_ALL) {
+        PRINT("strace", "pid %d exited, system call summary:\n", process->pid);
+        for (uint32_t i = 0; i < SYSTRACE_STAT_SLOTS; i++) {
+            SyscallStatEntry& s = stats->slots[i];
+            if (!s.count) continue;
+            PRINT("strace", "  %s%d: %u calls, %u cycles max, %u Kcycles total\n",
+                  (s.call & SYSTRACE_HGUI) ? "hgui:" : "", s.call & ~SYSTRACE_HGUI, s.count,
+                  s.maxCycles, (uint32_t)(s.totalCycles >> 10));
+        }
+    }
+    // The filter dies with its process, so nobody is locked out of tracing
+    if (pid == process->pid) {
+        traceFlags = 0;
+        tracePid = SYSTRACE_PID_NONE;
+    }
+    delete stats;
+}
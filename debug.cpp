@@ -6,7 +6,7 @@
  * @version     1.1.0
  */
 
-#include <core/Iguard.h>
+#include <core/spinlock.h>
 #include <debug.h>
 
 // --- Ring Buffer Configuration ---
@@ -15,7 +15,11 @@ static char serialBuffer[SERIAL_BUFFER_SIZE];
 static volatile uint32_t readHead = 0;
 static volatile uint32_t writeHead = 0;
 
-void vprintf(const char* format, va_list args);
+// Serialises producers and the flusher. Innermost lock: nothing is taken under it.
+static Spinlock logLock("serial-log", LOCK_LEVEL_LOG);
+
+// Caller must hold logLock
+static void vprintf_locked(const char* format, va_list args);
 
 void initSerial() {
     outb(0x3F8 + 1, 0x00);  // Disable interrupts
@@ -35,7 +39,7 @@ bool IsSerialReady() {
     return (inb(0x3F8 + 5) & 0x20) != 0;
 }
 
-void FlushSerial() {
+static void FlushSerialLocked() {
     // Keep flushing as long as hardware is ready AND we have data
     while (readHead != writeHead && IsSerialReady()) {
         char c = serialBuffer[readHead];
@@ -44,7 +48,12 @@ void FlushSerial() {
     }
 }
 
-void SerialPush(char c) {
+void FlushSerial() {
+    SpinlockGuard guard(logLock);
+    FlushSerialLocked();
+}
+
+static void SerialPush(char c) {
     // Push to buffer first
     uint32_t nextHead = (writeHead + 1) % SERIAL_BUFFER_SIZE;
     if (nextHead != readHead) {
@@ -54,28 +63,39 @@ void SerialPush(char c) {
 
     // Attempt to flush immediately if hardware is ready
     // This ensures logs continue even if scheduler is slow
-    FlushSerial();
+    FlushSerialLocked();
+}
+
+static void SerialPushString(const char* str) {
+    for (size_t i = 0; str[i] != '\0'; i++) {
+        SerialPush(str[i]);
+    }
 }
 
 void writeSerial(char c) {
+    SpinlockGuard guard(logLock);
     SerialPush(c);
 }
 
 void SerialPrint(const char* str) {
-    for (size_t i = 0; str[i] != '\0'; i++) {
-        writeSerial(str[i]);
-    }
+    SpinlockGuard guard(logLock);
+    SerialPushString(str);
 }
 
 void printf(const char* format, ...) {
-    InterruptGuard guard;  // Protects the formatting & buffer push
+    SpinlockGuard guard(logLock);  // Protects the formatting & buffer push
     va_list args;
     va_start(args, format);
-    vprintf(format, args);
+    vprintf_locked(format, args);
     va_end(args);
 }
 
 void vprintf(const char* format, va_list args) {
+    SpinlockGuard guard(logLock);
+    vprintf_locked(format, args);
+}
+
+static void vprintf_locked(const char* format, va_list args) {
     for (int i = 0; format[i] != '\0'; i++) {
         if (format[i] == '%') {
             i++;
@@ -90,7 +110,7 @@ void vprintf(const char* format, va_list args) {
                         buffer[--index] = '0';
                     } else if (num == -2147483648) {
                         const char* minStr = "-2147483648";
-                        for (int j = 0; minStr[j] != '\0'; j++) writeSerial(minStr[j]);
+                        for (int j = 0; minStr[j] != '\0'; j++) SerialPush(minStr[j]);
                         break;
                     } else {
                         bool isNegative = (num < 0);
@@ -101,7 +121,7 @@ void vprintf(const char* format, va_list args) {
                         }
                         if (isNegative) buffer[--index] = '-';
                     }
-                    for (int j = index; buffer[j] != '\0'; j++) writeSerial(buffer[j]);
+                    for (int j = index; buffer[j] != '\0'; j++) SerialPush(buffer[j]);
                     break;
                 }
                 case 'u': {
@@ -117,7 +137,7 @@ void vprintf(const char* format, va_list args) {
                             num /= 10;
                         }
                     }
-                    for (int j = index; buffer[j] != '\0'; j++) writeSerial(buffer[j]);
+                    for (int j = index; buffer[j] != '\0'; j++) SerialPush(buffer[j]);
                     break;
                 }
                 case 'x': {
@@ -134,39 +154,41 @@ void vprintf(const char* format, va_list args) {
                             num /= 16;
                         }
                     }
-                    for (int j = index; buffer[j] != '\0'; j++) writeSerial(buffer[j]);
+                    for (int j = index; buffer[j] != '\0'; j++) SerialPush(buffer[j]);
                     break;
                 }
                 case 's': {
                     const char* str = va_arg(args, const char*);
-                    for (int j = 0; str[j] != '\0'; j++) writeSerial(str[j]);
+                    for (int j = 0; str[j] != '\0'; j++) SerialPush(str[j]);
                     break;
                 }
                 default:
                     break;
             }
         } else {
-            writeSerial(format[i]);
+            SerialPush(format[i]);
         }
     }
 }
 
 void DebugPrintf(const char* tag, const char* format, ...) {
-    InterruptGuard guard;
+    SpinlockGuard guard(logLock);
     // This runs extremely fast now (microseconds) because it only writes to RAM
-    printf("%s:", tag);
+    SerialPushString(tag);
+    SerialPush(':');
     va_list args;
     va_start(args, format);
-    vprintf(format, args);
+    vprintf_locked(format, args);
     va_end(args);
-    printf("\n");
+    SerialPush('\n');
 }
 
 void Printf(const char* tag, const char* format, ...) {
-    InterruptGuard guard;
-    printf("%s:", tag);
+    SpinlockGuard guard(logLock);
+    SerialPushString(tag);
+    SerialPush(':');
     va_list args;
     va_start(args, format);
-    vprintf(format, args);
+    vprintf_locked(format, args);
     va_end(args);
 }
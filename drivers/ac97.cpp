@@ -127,6 +127,9 @@ private:
             if (buffersOccupied > 0) {
                 buffersOccupied--;
             }
+            // Nothing left queued: the DMA engine is about to stall on LVI
+            if (buffersOccupied == 0 && isPlaying) underruns++;
+            bufferFree.WakeAll();
         }
     }
 
@@ -0,0 +1,722 @@
+/**
+ * @file        ahci.cpp
+ * @brief       AHCI SATA Driver with Native Command Queuing
+ *
+ * @date        18/10/2026
+ * @version     1.0.0
+ */
+
+#include <console.h>
+#include <core/driver.h>
+#include <core/drivers/BlockDevice.h>
+#include <core/drivers/driver_info.h>
+#include <core/globals.h>
+#include <core/interrupts.h>
+#include <core/memory.h>
+#include <core/paging.h>
+#include <core/pci.h>
+#include <core/pmm.h>
+#include <core/scheduler.h>
+#include <core/sync.h>
+
+/* ================= IDs ================= */
+#define AHCI_CLASS_STORAGE 0x01
+#define AHCI_SUBCLASS_SATA 0x06
+
+/* ================= HBA (generic host control) ================= */
+#define AHCI_CAP 0x00
+#define AHCI_GHC 0x04
+#define AHCI_IS 0x08
+#define AHCI_PI 0x0C
+
+#define AHCI_CAP_SNCQ (1u << 30)
+#define AHCI_CAP_SCLO (1u << 24)  // PxCMD.CLO supported
+#define AHCI_CAP_NCS(cap) ((((cap) >> 8) & 0x1F) + 1)
+
+#define AHCI_GHC_IE 0x00000002
+#define AHCI_GHC_AE 0x80000000
+
+/* ================= Port registers ================= */
+#define AHCI_PORT(n) (0x100 + (n) * 0x80)
+#define AHCI_PxCLB 0x00
+#define AHCI_PxCLBU 0x04
+#define AHCI_PxFB 0x08
+#define AHCI_PxFBU 0x0C
+#define AHCI_PxIS 0x10
+#define AHCI_PxIE 0x14
+#define AHCI_PxCMD 0x18
+#define AHCI_PxTFD 0x20
+#define AHCI_PxSIG 0x24
+#define AHCI_PxSSTS 0x28
+#define AHCI_PxSCTL 0x2C
+#define AHCI_PxSERR 0x30
+#define AHCI_PxSACT 0x34
+#define AHCI_PxCI 0x38
+
+#define AHCI_PxCMD_ST 0x0001
+#define AHCI_PxCMD_CLO 0x0008  // Command list override: clears PxTFD.BSY/DRQ
+#define AHCI_PxCMD_FRE 0x0010
+#define AHCI_PxCMD_FR 0x4000
+#define AHCI_PxCMD_CR 0x8000
+
+#define AHCI_PxIS_DHRS 0x00000001   // D2H Register FIS: non-queued command done
+#define AHCI_PxIS_PSS 0x00000002    // PIO Setup FIS (IDENTIFY)
+#define AHCI_PxIS_SDBS 0x00000008   // Set Device Bits FIS: NCQ commands done
+#define AHCI_PxIS_FATAL 0x78000000  // Task file, host bus data/fatal, interface fatal errors
+#define AHCI_PxIE_DEFAULT (AHCI_PxIS_DHRS | AHCI_PxIS_PSS | AHCI_PxIS_SDBS | AHCI_PxIS_FATAL)
+
+#define AHCI_SSTS_DET_PRESENT 3
+#define AHCI_SCTL_DET_COMRESET 1
+#define AHCI_SIG_ATA 0x00000101
+
+#define ATA_STATUS_ERR 0x01
+#define ATA_STATUS_DRQ 0x08
+#define ATA_STATUS_BSY 0x80
+
+/* ================= ATA commands ================= */
+#define ATA_CMD_READ_DMA_EXT 0x25
+#define ATA_CMD_WRITE_DMA_EXT 0x35
+#define ATA_CMD_READ_LOG_EXT 0x2F
+#define ATA_CMD_READ_FPDMA_QUEUED 0x60
+#define ATA_CMD_WRITE_FPDMA_QUEUED 0x61
+#define ATA_CMD_FLUSH_CACHE_EXT 0xEA
+#define ATA_CMD_IDENTIFY 0xEC
+
+#define ATA_LOG_NCQ_ERROR 0x10  // Reading it ends the drive's NCQ error state
+
+/* ================= Limits ================= */
+#define AHCI_MAX_PORTS 32
+#define AHCI_MAX_SLOTS 32
+#define AHCI_MAX_SECTORS 256
+#define AHCI_PRDT_MAX 248           // Fills the rest of the command table page
+#define AHCI_BOUNCE_SECTORS 8       // One page per slot for buffers DMA cannot reach
+#define AHCI_IRQ_TIMEOUT_MS 100     // Then poll the registers in case the IRQ was missed
+#define AHCI_STOP_TIMEOUT_MS 500    // PxCMD.CR/FR/CLO, spec limit
+#define AHCI_RESET_TIMEOUT_MS 1000  // Link back up and the drive ready after a COMRESET
+#define AHCI_PHYS_LIMIT 0x10000000  // Identity-mapped, so virtual == physical
+
+struct AHCICommandHeader {
+    uint16_t flags;  // FIS length in dwords (bits 0-4), bit 6 = write
+    uint16_t prdtl;  // PRD entries
+    volatile uint32_t prdbc;
+    uint32_t ctba;
+    uint32_t ctbau;
+    uint32_t reserved[4];
+} __attribute__((packed));
+
+struct AHCIPhysicalRegion {
+    uint32_t dba;
+    uint32_t dbau;
+    uint32_t reserved;
+    uint32_t dbc;  // Byte count - 1 (bits 0-21)
+} __attribute__((packed));
+
+struct AHCICommandTable {
+    uint8_t cfis[64];
+    uint8_t acmd[16];
+    uint8_t reserved[48];
+    AHCIPhysicalRegion prdt[AHCI_PRDT_MAX];
+} __attribute__((packed));
+
+DEFINE_DRIVER_INFO("AHCI SATA Driver", "1.0.0-NCQ",
+                   {DRIVER_MATCH_CLASS, DRIVER_CLASS_ID(AHCI_CLASS_STORAGE, AHCI_SUBCLASS_SATA)});
+
+class DynamicAHCIDriver;
+
+/* ================= PORT (one SATA disk) ================= */
+class AHCIPort final : public BlockDevice {
+    friend class DynamicAHCIDriver;
+
+private:
+    volatile uint8_t* regs;
+    uint32_t index;
+    uint32_t sectors;
+    uint32_t depth;  // Usable command slots, 1 without NCQ
+    bool ncq;
+    bool clo;  // HBA supports command list override
+
+    AHCICommandHeader* commandList;  // 32 headers (1 KB) followed by the received FIS area
+    AHCICommandTable* tables[AHCI_MAX_SLOTS];
+    uint8_t* bounce[AHCI_MAX_SLOTS];
+
+    // Slot bookkeeping, changed with interrupts off
+    volatile uint32_t slotsInUse;  // Held by a caller
+    volatile uint32_t issued;      // Still owned by the HBA
+    volatile uint32_t failed;      // Finished with an error
+
+    // Error recovery: the IRQ only flags it, the next thread to issue a command
+    // (or one whose command failed) runs Recover()
+    volatile bool needRecovery;
+    volatile bool recovering;
+    volatile bool broken;  // Recovery failed, every transfer fails from now on
+
+    Semaphore done[AHCI_MAX_SLOTS];
+    Semaphore freeSlots;
+    Mutex exclusive;  // Non-queued commands (FLUSH) wait for the queue to drain
+    Mutex recovery;
+
+    uint32_t Read(uint32_t reg) {
+        return *(volatile uint32_t*)(regs + reg);
+    }
+    void Write(uint32_t reg, uint32_t value) {
+        *(volatile uint32_t*)(regs + reg) = value;
+    }
+
+    // Spin until none of 'mask' is set in 'reg'. False on timeout.
+    bool WaitClear(uint32_t reg, uint32_t mask, uint32_t timeoutMs) {
+        uint64_t deadline = timerTicks + timeoutMs;
+        while (Read(reg) & mask) {
+            if (timerTicks >= deadline) return false;
+        }
+        return true;
+    }
+
+    bool Stop() {
+        Write(AHCI_PxCMD, Read(AHCI_PxCMD) & ~(AHCI_PxCMD_ST | AHCI_PxCMD_FRE));
+        return WaitClear(AHCI_PxCMD, AHCI_PxCMD_CR | AHCI_PxCMD_FR, AHCI_STOP_TIMEOUT_MS);
+    }
+
+    bool Start() {
+        if (!WaitClear(AHCI_PxCMD, AHCI_PxCMD_CR, AHCI_STOP_TIMEOUT_MS)) return false;
+        Write(AHCI_PxCMD, Read(AHCI_PxCMD) | AHCI_PxCMD_FRE | AHCI_PxCMD_ST);
+        return true;
+    }
+
+    // COMRESET with the port stopped, then wait for the drive's signature FIS
+    bool ResetLink() {
+        Write(AHCI_PxSCTL, (Read(AHCI_PxSCTL) & ~0x0F) | AHCI_SCTL_DET_COMRESET);
+        uint64_t until = timerTicks + 2;  // At least 1 ms
+        while (timerTicks < until) {
+        }
+        Write(AHCI_PxSCTL, Read(AHCI_PxSCTL) & ~0x0F);
+
+        uint64_t deadline = timerTicks + AHCI_RESET_TIMEOUT_MS;
+        while ((Read(AHCI_PxSSTS) & 0x0F) != AHCI_SSTS_DET_PRESENT) {
+            if (timerTicks >= deadline) return false;
+        }
+        Write(AHCI_PxSERR, 0xFFFFFFFF);
+        Write(AHCI_PxCMD, Read(AHCI_PxCMD) | AHCI_PxCMD_FRE);
+        return WaitClear(AHCI_PxTFD, ATA_STATUS_BSY | ATA_STATUS_DRQ, AHCI_RESET_TIMEOUT_MS);
+    }
+
+    // READ LOG EXT page 10h on 'slot', polled. The slot is not marked issued, so
+    // Reap() leaves it alone.
+    bool ReadErrorLog(uint32_t slot) {
+        uint8_t* fis = tables[slot]->cfis;
+        memset(fis, 0, 20);
+        fis[0] = 0x27;
+        fis[1] = 0x80;
+        fis[2] = ATA_CMD_READ_LOG_EXT;
+        fis[4] = ATA_LOG_NCQ_ERROR;
+        fis[12] = 1;
+
+        AHCIPhysicalRegion* prd = &tables[slot]->prdt[0];
+        prd->dba = (uint32_t)bounce[slot];
+        prd->dbau = 0;
+        prd->reserved = 0;
+        prd->dbc = BLOCK_SECTOR_SIZE - 1;
+
+        AHCICommandHeader* header = &commandList[slot];
+        header->flags = 5;
+        header->prdtl = 1;
+        header->prdbc = 0;
+        header->ctba = (uint32_t)tables[slot];
+        header->ctbau = 0;
+
+        Write(AHCI_PxCI, 1u << slot);
+        if (!WaitClear(AHCI_PxCI, 1u << slot, AHCI_STOP_TIMEOUT_MS)) return false;
+        if (Read(AHCI_PxTFD) & ATA_STATUS_ERR) return false;
+
+        uint8_t* log = bounce[slot];
+        printf("[AHCI] Port %d: NCQ error on tag %d, status 0x%x, error 0x%x\n", index,
+               log[0] & 0x1F, log[2], log[3]);
+        return true;
+    }
+
+    // Bring the port back after a fatal error (AHCI 1.3 section 6.2.2): stop it,
+    // clear BSY/DRQ with CLO or a COMRESET, restart it and read the NCQ error log
+    // before anything is queued again. Runs in a thread that holds 'slot'.
+    void Recover(uint32_t slot) {
+        recovery.Lock();
+        uint32_t flags = IrqSave();
+        bool pending = needRecovery && !broken;
+        needRecovery = false;
+        recovering = pending;
+        IrqRestore(flags);
+
+        if (pending) {
+            bool ok = Stop();  // Also drops whatever was still in PxCI/PxSACT
+            Write(AHCI_PxSERR, 0xFFFFFFFF);
+            Write(AHCI_PxIS, 0xFFFFFFFF);
+            if (ok && (Read(AHCI_PxTFD) & (ATA_STATUS_BSY | ATA_STATUS_DRQ))) {
+                if (clo) {
+                    Write(AHCI_PxCMD, Read(AHCI_PxCMD) | AHCI_PxCMD_CLO);
+                    WaitClear(AHCI_PxCMD, AHCI_PxCMD_CLO, AHCI_STOP_TIMEOUT_MS);
+                }
+                if (Read(AHCI_PxTFD) & (ATA_STATUS_BSY | ATA_STATUS_DRQ)) ok = ResetLink();
+            }
+            if (ok) ok = Start();
+            if (ok && ncq && !ReadErrorLog(slot)) ok = Stop() && ResetLink() && Start();
+
+            if (ok) {
+                printf("[AHCI] Port %d: recovered\n", index);
+            } else {
+                broken = true;
+                printf("[AHCI] Port %d: recovery failed, port disabled\n", index);
+            }
+            // Errors raised by our own commands above are dealt with already
+            flags = IrqSave();
+            needRecovery = false;
+            recovering = false;
+            IrqRestore(flags);
+        }
+        recovery.Unlock();
+    }
+
+    // Pick a free slot. Sleeps while all 'depth' slots are busy.
+    uint32_t AcquireSlot() {
+        while (!freeSlots.Wait(AHCI_IRQ_TIMEOUT_MS)) {
+            uint32_t flags = IrqSave();
+            Reap();
+            IrqRestore(flags);
+        }
+        uint32_t flags = IrqSave();
+        uint32_t slot = 0;
+        while (slotsInUse & (1u << slot)) slot++;
+        slotsInUse |= (1u << slot);
+        IrqRestore(flags);
+
+        // Forget a completion that a polling waiter already consumed
+        while (done[slot].TryWait()) {
+        }
+        return slot;
+    }
+
+    void ReleaseSlot(uint32_t slot) {
+        uint32_t flags = IrqSave();
+        slotsInUse &= ~(1u << slot);
+        IrqRestore(flags);
+        freeSlots.Signal();
+    }
+
+    // Describe 'bytes' at 'buffer' in the slot's PRDT. Returns the entry count,
+    // 0 if some page cannot be handed to the HBA (odd address, not mapped).
+    uint32_t BuildPRDT(uint32_t slot, const uint8_t* buffer, uint32_t bytes) {
+        if ((uint32_t)buffer & 1) return 0;
+        Scheduler* sched = Scheduler::activeInstance;
+        if (!sched || !sched->GetPager()) return 0;
+
+        uint32_t* directory;
+        asm volatile("mov %%cr3, %0" : "=r"(directory));
+
+        AHCIPhysicalRegion* prdt = tables[slot]->prdt;
+        uint32_t entries = 0;
+        uint32_t addr = (uint32_t)buffer;
+        uint32_t remaining = bytes;
+        while (remaining > 0) {
+            uint32_t phys = sched->GetPager()->GetPhysicalAddress(directory, addr);
+            if (!phys) return 0;
+            uint32_t chunk = PAGE_SIZE - (addr & (PAGE_SIZE - 1));
+            if (chunk > remaining) chunk = remaining;
+
+            AHCIPhysicalRegion* last = entries ? &prdt[entries - 1] : nullptr;
+            if (last && last->dba + (last->dbc & 0x3FFFFF) + 1 == phys) {
+                last->dbc += chunk;
+            } else {
+                if (entries == AHCI_PRDT_MAX) return 0;
+                prdt[entries].dba = phys;
+                prdt[entries].dbau = 0;
+                prdt[entries].reserved = 0;
+                prdt[entries].dbc = chunk - 1;
+                entries++;
+            }
+            addr += chunk;
+            remaining -= chunk;
+        }
+        return entries;
+    }
+
+    // Fill the command FIS and header of 'slot', hand it to the HBA and sleep
+    // until the IRQ (or the polling fallback) reaps it.
+    bool Execute(uint32_t slot, uint8_t command, uint32_t lba, uint32_t count, bool write,
+                 uint32_t prdEntries) {
+        bool queued = (command == ATA_CMD_READ_FPDMA_QUEUED ||
+                       command == ATA_CMD_WRITE_FPDMA_QUEUED);
+
+        uint8_t* fis = tables[slot]->cfis;
+        memset(fis, 0, 20);
+        fis[0] = 0x27;  // Register FIS, host to device
+        fis[1] = 0x80;  // Command (not control)
+        fis[2] = command;
+        fis[4] = lba & 0xFF;
+        fis[5] = (lba >> 8) & 0xFF;
+        fis[6] = (lba >> 16) & 0xFF;
+        fis[7] = (command == ATA_CMD_IDENTIFY) ? 0 : 0x40;  // LBA mode
+        fis[8] = (lba >> 24) & 0xFF;
+        if (queued) {
+            // NCQ: the sector count moves to FEATURES, COUNT carries the tag
+            fis[3] = count & 0xFF;
+            fis[11] = (count >> 8) & 0xFF;
+            fis[12] = slot << 3;
+        } else {
+            fis[12] = count & 0xFF;
+            fis[13] = (count >> 8) & 0xFF;
+        }
+
+        AHCICommandHeader* header = &commandList[slot];
+        header->flags = 5 | (write ? 0x40 : 0);  // 20-byte FIS
+        header->prdtl = prdEntries;
+        header->prdbc = 0;
+        header->ctba = (uint32_t)tables[slot];
+        header->ctbau = 0;
+
+        // Nothing is issued while the port still has to recover from an error
+        uint32_t bit = 1u << slot;
+        uint32_t flags;
+        while (true) {
+            if (broken) return false;
+            flags = IrqSave();
+            if (!needRecovery && !recovering) break;
+            IrqRestore(flags);
+            Recover(slot);
+        }
+        issued |= bit;
+        failed &= ~bit;
+        if (queued) Write(AHCI_PxSACT, bit);
+        Write(AHCI_PxCI, bit);
+        IrqRestore(flags);
+
+        while (issued & bit) {
+            if (!done[slot].Wait(AHCI_IRQ_TIMEOUT_MS)) {
+                flags = IrqSave();
+                Reap();
+                IrqRestore(flags);
+            }
+        }
+        bool ok = !(failed & bit);
+        if (!ok && needRecovery) Recover(slot);
+        return ok;
+    }
+
+    bool Transfer(uint32_t lba, uint32_t count, uint8_t* data, bool write) {
+        if (count == 0 || count > AHCI_MAX_SECTORS) return false;
+        if (lba >= sectors || count > sectors - lba) return false;
+
+        uint8_t command;
+        if (ncq)
+            command = write ? ATA_CMD_WRITE_FPDMA_QUEUED : ATA_CMD_READ_FPDMA_QUEUED;
+        else
+            command = write ? ATA_CMD_WRITE_DMA_EXT : ATA_CMD_READ_DMA_EXT;
+
+        uint32_t slot = AcquireSlot();
+        bool ok = true;
+        uint32_t entries = BuildPRDT(slot, data, count * BLOCK_SECTOR_SIZE);
+        if (entries) {
+            // Straight into the caller's pages
+            ok = Execute(slot, command, lba, count, write, entries);
+        } else {
+            // Through the slot's bounce page, a few sectors at a time
+            for (uint32_t moved = 0; ok && moved < count; moved += AHCI_BOUNCE_SECTORS) {
+                uint32_t n = count - moved;
+                if (n > AHCI_BOUNCE_SECTORS) n = AHCI_BOUNCE_SECTORS;
+                uint8_t* part = data + moved * BLOCK_SECTOR_SIZE;
+                if (write) memcpy(bounce[slot], part, n * BLOCK_SECTOR_SIZE);
+
+                AHCIPhysicalRegion* prd = &tables[slot]->prdt[0];
+                prd->dba = (uint32_t)bounce[slot];
+                prd->dbau = 0;
+                prd->reserved = 0;
+                prd->dbc = n * BLOCK_SECTOR_SIZE - 1;
+                ok = Execute(slot, command, lba + moved, n, write, 1);
+
+                if (ok && !write) memcpy(part, bounce[slot], n * BLOCK_SECTOR_SIZE);
+            }
+        }
+        ReleaseSlot(slot);
+        if (!ok)
+            printf("[AHCI] Port %d: %s error at LBA %d\n", index, write ? "write" : "read", lba);
+        return ok;
+    }
+
+    // Take every slot, so nothing queued is in flight, for a non-queued command
+    uint32_t AcquireAll() {
+        exclusive.Lock();
+        for (uint32_t i = 0; i < depth; i++) {
+            while (!freeSlots.Wait(AHCI_IRQ_TIMEOUT_MS)) {
+                uint32_t flags = IrqSave();
+                Reap();
+                IrqRestore(flags);
+            }
+        }
+        while (done[0].TryWait()) {
+        }
+        return 0;
+    }
+
+    void ReleaseAll() {
+        for (uint32_t i = 0; i < depth; i++) freeSlots.Signal();
+        exclusive.Unlock();
+    }
+
+public:
+    AHCIPort(volatile uint8_t* portRegs, uint32_t portIndex) {
+        regs = portRegs;
+        index = portIndex;
+        sectors = 0;
+        depth = 1;
+        ncq = false;
+        clo = false;
+        needRecovery = false;
+        recovering = false;
+        broken = false;
+        commandList = nullptr;
+        slotsInUse = 0;
+        issued = 0;
+        failed = 0;
+        for (int i = 0; i < AHCI_MAX_SLOTS; i++) {
+            tables[i] = nullptr;
+            bounce[i] = nullptr;
+        }
+    }
+
+    // Move the port's command list to our memory, start it and IDENTIFY the disk
+    bool Init(uint32_t hbaSlots, bool hbaNcq, bool hbaClo) {
+        clo = hbaClo;
+        if (!Stop()) return false;
+
+        commandList = (AHCICommandHeader*)pmm_alloc_block_low(AHCI_PHYS_LIMIT);
+        if (!commandList) return false;
+        memset(commandList, 0, PAGE_SIZE);
+        for (uint32_t i = 0; i < hbaSlots; i++) {
+            tables[i] = (AHCICommandTable*)pmm_alloc_block_low(AHCI_PHYS_LIMIT);
+            bounce[i] = (uint8_t*)pmm_alloc_block_low(AHCI_PHYS_LIMIT);
+            if (!tables[i] || !bounce[i]) return false;
+            memset(tables[i], 0, PAGE_SIZE);
+        }
+
+        Write(AHCI_PxCLB, (uint32_t)commandList);
+        Write(AHCI_PxCLBU, 0);
+        Write(AHCI_PxFB, (uint32_t)commandList + 1024);  // 256-byte aligned receive area
+        Write(AHCI_PxFBU, 0);
+        Write(AHCI_PxSERR, 0xFFFFFFFF);
+        Write(AHCI_PxIS, 0xFFFFFFFF);
+        Write(AHCI_PxIE, AHCI_PxIE_DEFAULT);
+        if (!Start()) return false;
+
+        // One slot until IDENTIFY told us about NCQ
+        freeSlots.Signal();
+
+        uint32_t slot = AcquireSlot();
+        AHCIPhysicalRegion* prd = &tables[slot]->prdt[0];
+        prd->dba = (uint32_t)bounce[slot];
+        prd->dbau = 0;
+        prd->reserved = 0;
+        prd->dbc = BLOCK_SECTOR_SIZE - 1;
+        bool ok = Execute(slot, ATA_CMD_IDENTIFY, 0, 0, false, 1);
+        uint16_t* id = (uint16_t*)bounce[slot];
+        ReleaseSlot(slot);
+        if (!ok) return false;
+
+        // Words 100-103: LBA48 capacity (only the low 32 bits are addressable here),
+        // words 60-61: LBA28 capacity
+        sectors = id[100] | ((uint32_t)id[101] << 16);
+        if (id[102] || id[103]) sectors = 0xFFFFFFFF;
+        if (sectors == 0) sectors = id[60] | ((uint32_t)id[61] << 16);
+
+        // Word 76 bit 8: NCQ, word 75: queue depth - 1
+        if (hbaNcq && (id[76] & 0x0100)) {
+            ncq = true;
+            depth = (id[75] & 0x1F) + 1;
+            if (depth > hbaSlots) depth = hbaSlots;
+            for (uint32_t i = 1; i < depth; i++) freeSlots.Signal();
+        }
+
+        printf("[AHCI] Port %d: %d sectors (%d MB), %s, %d slots\n", index, sectors,
+               sectors / 2048, ncq ? "NCQ" : "no NCQ", depth);
+        return true;
+    }
+
+    // Complete whatever the HBA finished. Interrupts must be off (IRQ handler or IrqSave).
+    void Reap() {
+        uint32_t status = Read(AHCI_PxIS);
+        Write(AHCI_PxIS, status);
+
+        uint32_t completed;
+        if (status & AHCI_PxIS_FATAL) {
+            // A failed NCQ command aborts the whole queue: fail everything
+            // outstanding. The HBA has stopped; Recover() restarts it outside
+            // interrupt context.
+            printf("[AHCI] Port %d: error IS=0x%x TFD=0x%x\n", index, status, Read(AHCI_PxTFD));
+            completed = issued;
+            failed |= issued;
+            needRecovery = true;
+        } else {
+            completed = issued & ~(Read(AHCI_PxSACT) | Read(AHCI_PxCI));
+        }
+
+        issued &= ~completed;
+        for (uint32_t slot = 0; completed; slot++) {
+            if (completed & (1u << slot)) {
+                completed &= ~(1u << slot);
+                done[slot].Signal();
+            }
+        }
+    }
+
+    bool ReadSectors(uint32_t lba, uint32_t count, uint8_t* data) override {
+        return Transfer(lba, count, data, false);
+    }
+
+    bool WriteSectors(uint32_t lba, uint32_t count, const uint8_t* data) override {
+        return Transfer(lba, count, (uint8_t*)data, true);
+    }
+
+    void Flush() override {
+        uint32_t slot = AcquireAll();
+        Execute(slot, ATA_CMD_FLUSH_CACHE_EXT, 0, 0, false, 0);
+        ReleaseAll();
+    }
+
+    uint32_t GetSizeInSectors() override {
+        return sectors;
+    }
+
+    uint32_t GetMaxSectors() override {
+        return AHCI_MAX_SECTORS;
+    }
+
+    uint32_t GetQueueDepth() override {
+        return depth;
+    }
+};
+
+/* ================= IRQ ================= */
+class AHCIIRQ : public InterruptHandler {
+    DynamicAHCIDriver* driver;
+
+public:
+    AHCIIRQ(uint8_t irq, DynamicAHCIDriver* drv)
+        : InterruptHandler(irq, InterruptManager::activeInstance), driver(drv) {}
+    uint32_t HandleInterrupt(uint32_t esp) override;
+};
+
+/* ================= DRIVER ================= */
+class DynamicAHCIDriver final : public Driver {
+    friend class AHCIIRQ;
+
+private:
+    volatile uint8_t* abar;
+    AHCIIRQ* irqHandler;
+    AHCIPort* ports[AHCI_MAX_PORTS];  // Indexed by HBA port number
+    AHCIPort* disks[AHCI_MAX_PORTS];  // Working disks, in port order
+    uint32_t diskCount;
+
+    uint32_t Read(uint32_t reg) {
+        return *(volatile uint32_t*)(abar + reg);
+    }
+    void Write(uint32_t reg, uint32_t value) {
+        *(volatile uint32_t*)(abar + reg) = value;
+    }
+
+    bool FindHardware() {
+        PeripheralComponentInterconnectController pci;
+        auto* dev = pci.FindClassDevice(AHCI_CLASS_STORAGE, AHCI_SUBCLASS_SATA);
+        if (!dev || dev->vendor_id == 0) return false;
+
+        // Memory space + bus master
+        uint32_t cmd = pci.Read(dev->bus, dev->device, dev->function, 0x04);
+        pci.Write(dev->bus, dev->device, dev->function, 0x04, cmd | 0x06);
+
+        // ABAR (BAR5) lies in the identity-mapped MMIO window above 3 GB
+        BaseAddressRegister bar =
+            pci.GetBaseAddressRegister(dev->bus, dev->device, dev->function, 5);
+        if (bar.type != MemoryMapping || !bar.address) return false;
+        abar = (volatile uint8_t*)bar.address;
+
+        // Legacy INTx. MSI would need a local APIC, this kernel runs on the 8259 PICs.
+        irqHandler = new AHCIIRQ((dev->interrupt & 0xFF) + 0x20, this);
+        if (!irqHandler) {
+            HALT("CRITICAL: [AHCI] Failed to allocate AHCI IRQ handler!\n");
+        }
+        printf("[AHCI] Found %x:%x ABAR=0x%x IRQ=%d\n", dev->vendor_id, dev->device_id,
+               (uint32_t)abar, dev->interrupt & 0xFF);
+        return true;
+    }
+
+    void OnInterrupt() {
+        uint32_t pending = Read(AHCI_IS);
+        for (uint32_t i = 0; i < AHCI_MAX_PORTS; i++) {
+            if ((pending & (1u << i)) && ports[i]) ports[i]->Reap();
+        }
+        Write(AHCI_IS, pending);
+    }
+
+public:
+    DynamicAHCIDriver() {
+        driverName = "AHCI SATA";
+        abar = nullptr;
+        irqHandler = nullptr;
+        diskCount = 0;
+        for (int i = 0; i < AHCI_MAX_PORTS; i++) {
+            ports[i] = nullptr;
+            disks[i] = nullptr;
+        }
+    }
+
+    ~DynamicAHCIDriver() {
+        if (irqHandler) delete irqHandler;
+    }
+
+    void Activate() override {
+        if (!FindHardware()) return;
+
+        Write(AHCI_GHC, Read(AHCI_GHC) | AHCI_GHC_AE);
+        uint32_t cap = Read(AHCI_CAP);
+        uint32_t implemented = Read(AHCI_PI);
+        uint32_t slots = AHCI_CAP_NCS(cap);
+        bool hbaNcq = (cap & AHCI_CAP_SNCQ) != 0;
+        bool hbaClo = (cap & AHCI_CAP_SCLO) != 0;
+
+        Write(AHCI_IS, 0xFFFFFFFF);
+        Write(AHCI_GHC, Read(AHCI_GHC) | AHCI_GHC_IE);
+
+        for (uint32_t i = 0; i < AHCI_MAX_PORTS; i++) {
+            if (!(implemented & (1u << i))) continue;
+            volatile uint8_t* regs = abar + AHCI_PORT(i);
+            uint32_t ssts = *(volatile uint32_t*)(regs + AHCI_PxSSTS);
+            uint32_t sig = *(volatile uint32_t*)(regs + AHCI_PxSIG);
+            if ((ssts & 0x0F) != AHCI_SSTS_DET_PRESENT || sig != AHCI_SIG_ATA) continue;
+
+            AHCIPort* port = new AHCIPort(regs, i);
+            if (!port) {
+                HALT("CRITICAL: [AHCI] Failed to allocate AHCIPort!\n");
+            }
+            ports[i] = port;
+            if (port->Init(slots, hbaNcq, hbaClo)) {
+                disks[diskCount++] = port;
+            } else {
+                printf("[AHCI] Port %d: initialization failed\n", i);
+            }
+        }
+
+        is_Active = true;
+        printf("[AHCI] Ready, %d disk(s), %d command slots\n", diskCount, slots);
+    }
+
+    BlockDevice* GetBlockDevice(uint32_t index) override {
+        return index < diskCount ? disks[index] : 0;
+    }
+};
+
+uint32_t AHCIIRQ::HandleInterrupt(uint32_t esp) {
+    if (driver) driver->OnInterrupt();
+    return esp;
+}
+
+extern "C" Driver* CreateDriverInstance() {
+    DynamicAHCIDriver* drv = new DynamicAHCIDriver();
+    if (!drv) {
+        HALT("CRITICAL: [AHCI] Failed to allocate DynamicAHCIDriver!\n");
+    }
+    return drv;
+}
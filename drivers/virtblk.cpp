@@ -0,0 +1,539 @@
+/**
+ * @file        virtblk.cpp
+ * @brief       virtio-blk Driver (legacy PCI transport, split virtqueue)
+ *
+ * @date        18/10/2026
+ * @version     1.0.0
+ */
+
+#include <console.h>
+#include <core/driver.h>
+#include <core/drivers/BlockDevice.h>
+#include <core/drivers/driver_info.h>
+#include <core/interrupts.h>
+#include <core/memory.h>
+#include <core/paging.h>
+#include <core/pci.h>
+#include <core/pmm.h>
+#include <core/ports.h>
+#include <core/scheduler.h>
+#include <core/sync.h>
+
+/* ================= IDs ================= */
+#define VIRTIO_VENDOR_ID 0x1AF4
+#define VIRTIO_BLK_DEVICE_ID 0x1001  // Transitional device, legacy I/O BAR0
+
+/* ================= Legacy registers (BAR0) ================= */
+#define VIRTIO_REG_DEVICE_FEATURES 0x00
+#define VIRTIO_REG_GUEST_FEATURES 0x04
+#define VIRTIO_REG_QUEUE_ADDRESS 0x08  // Page frame number of the ring
+#define VIRTIO_REG_QUEUE_SIZE 0x0C
+#define VIRTIO_REG_QUEUE_SELECT 0x0E
+#define VIRTIO_REG_QUEUE_NOTIFY 0x10
+#define VIRTIO_REG_DEVICE_STATUS 0x12
+#define VIRTIO_REG_ISR_STATUS 0x13  // Read to acknowledge
+#define VIRTIO_REG_CONFIG 0x14      // Device config, no MSI-X
+
+/* virtio_blk_config offsets */
+#define VIRTIO_BLK_CFG_CAPACITY 0x00
+#define VIRTIO_BLK_CFG_SIZE_MAX 0x08
+#define VIRTIO_BLK_CFG_SEG_MAX 0x0C
+
+#define VIRTIO_STATUS_ACKNOWLEDGE 0x01
+#define VIRTIO_STATUS_DRIVER 0x02
+#define VIRTIO_STATUS_DRIVER_OK 0x04
+#define VIRTIO_STATUS_FAILED 0x80
+
+#define VIRTIO_BLK_F_SIZE_MAX (1u << 1)
+#define VIRTIO_BLK_F_SEG_MAX (1u << 2)
+#define VIRTIO_BLK_F_RO (1u << 5)
+#define VIRTIO_BLK_F_FLUSH (1u << 9)
+#define VIRTIO_RING_F_EVENT_IDX (1u << 29)
+
+#define VIRTIO_BLK_T_IN 0
+#define VIRTIO_BLK_T_OUT 1
+#define VIRTIO_BLK_T_FLUSH 4
+#define VIRTIO_BLK_S_OK 0
+
+#define VIRTQ_DESC_F_NEXT 1
+#define VIRTQ_DESC_F_WRITE 2  // Device writes this buffer
+#define VIRTQ_USED_F_NO_NOTIFY 1
+
+/* ================= Limits ================= */
+#define VIRTIO_BLK_MAX_SECTORS 256
+#define VIRTIO_BLK_MAX_SEGMENTS 16    // Data descriptors per request
+#define VIRTIO_BLK_MAX_REQUESTS 32    // Requests in flight
+#define VIRTIO_BLK_TIMEOUT_MS 100     // Then poll the used ring in case the IRQ was missed
+#define VIRTIO_PHYS_LIMIT 0x10000000  // Identity-mapped, so virtual == physical
+
+struct VirtqDesc {
+    uint32_t addr;
+    uint32_t addrHigh;
+    uint32_t len;
+    uint16_t flags;
+    uint16_t next;
+} __attribute__((packed));
+
+struct VirtqUsedElem {
+    uint32_t id;  // Head descriptor of the finished chain
+    uint32_t len;
+} __attribute__((packed));
+
+// Device-readable request header, followed by the data and a device-writable status byte
+struct VirtioBlkRequestHeader {
+    uint32_t type;
+    uint32_t reserved;
+    uint32_t sector;
+    uint32_t sectorHigh;
+} __attribute__((packed));
+
+// One physically contiguous piece of a caller's buffer
+struct VirtioSegment {
+    uint32_t phys;
+    uint32_t len;
+};
+
+DEFINE_DRIVER_INFO("virtio-blk Driver", "1.0.0-split", {VIRTIO_VENDOR_ID, VIRTIO_BLK_DEVICE_ID});
+
+class DynamicVirtioBlkDriver;
+
+/* ================= IRQ ================= */
+class VirtioBlkIRQ : public InterruptHandler {
+    DynamicVirtioBlkDriver* driver;
+
+public:
+    VirtioBlkIRQ(uint8_t irq, DynamicVirtioBlkDriver* drv)
+        : InterruptHandler(irq, InterruptManager::activeInstance), driver(drv) {}
+    uint32_t HandleInterrupt(uint32_t esp) override;
+};
+
+/* ================= DRIVER ================= */
+class DynamicVirtioBlkDriver final : public Driver, public BlockDevice {
+    friend class VirtioBlkIRQ;
+
+private:
+    uint16_t ioBase;
+    VirtioBlkIRQ* irqHandler;
+    uint32_t features;  // Negotiated
+    uint32_t sectors;
+    uint32_t segMax;     // Data descriptors one request may use
+    uint32_t sizeMax;    // Bytes one descriptor may carry, 0 = no limit
+    uint32_t slotCount;  // Requests in flight, each owning 'perSlot' descriptors
+    uint32_t perSlot;
+
+    // Split virtqueue (legacy layout: descriptors, avail ring, page-aligned used ring)
+    uint32_t queueSize;
+    VirtqDesc* desc;
+    volatile uint16_t* availFlags;
+    volatile uint16_t* availIdx;
+    volatile uint16_t* availRing;
+    volatile uint16_t* usedEvent;  // Interrupt once the used index passes this
+    volatile uint16_t* usedFlags;
+    volatile uint16_t* usedIdx;
+    volatile VirtqUsedElem* usedRing;
+    volatile uint16_t* availEvent;  // Device wants a notify once avail passes this
+    uint16_t nextAvail;
+    uint16_t lastUsed;
+
+    // Per-slot request header and status byte, in DMA-able memory
+    VirtioBlkRequestHeader* headers;
+    volatile uint8_t* statuses;
+
+    volatile uint32_t slotsInUse;  // Changed with interrupts off
+    volatile uint32_t completed;   // Set by Reap
+    Semaphore done[VIRTIO_BLK_MAX_REQUESTS];
+    Semaphore freeSlots;
+    Mutex submitLock;  // A batch takes all its slots at once, so batches cannot deadlock
+
+    bool FindHardware() {
+        PeripheralComponentInterconnectController pci;
+        auto* dev = pci.FindHardwareDevice(VIRTIO_VENDOR_ID, VIRTIO_BLK_DEVICE_ID);
+        if (!dev || dev->vendor_id == 0) return false;
+
+        // I/O space + bus master
+        uint32_t cmd = pci.Read(dev->bus, dev->device, dev->function, 0x04);
+        pci.Write(dev->bus, dev->device, dev->function, 0x04, cmd | 0x05);
+
+        BaseAddressRegister bar =
+            pci.GetBaseAddressRegister(dev->bus, dev->device, dev->function, 0);
+        if (bar.type != InputOutput) return false;
+        ioBase = (uint16_t)((uint32_t)bar.address & 0xFFFC);
+
+        irqHandler = new VirtioBlkIRQ((dev->interrupt & 0xFF) + 0x20, this);
+        if (!irqHandler) {
+            HALT("CRITICAL: [VIRTIO] Failed to allocate virtio-blk IRQ handler!\n");
+        }
+        printf("[VIRTIO] Found virtio-blk IO=0x%x IRQ=%d\n", ioBase, dev->interrupt & 0xFF);
+        return true;
+    }
+
+    bool SetupQueue() {
+        outw(ioBase + VIRTIO_REG_QUEUE_SELECT, 0);
+        queueSize = inw(ioBase + VIRTIO_REG_QUEUE_SIZE);
+        if (queueSize == 0) return false;
+
+        uint32_t availBytes = 6 + 2 * queueSize;
+        uint32_t usedOffset = (16 * queueSize + availBytes + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+        uint32_t usedBytes = 6 + 8 * queueSize;
+        uint32_t pages = (usedOffset + usedBytes + PAGE_SIZE - 1) / PAGE_SIZE;
+
+        uint8_t* ring = (uint8_t*)pmm_alloc_blocks_low(pages, VIRTIO_PHYS_LIMIT);
+        headers = (VirtioBlkRequestHeader*)pmm_alloc_block_low(VIRTIO_PHYS_LIMIT);
+        if (!ring || !headers) return false;
+        memset(ring, 0, pages * PAGE_SIZE);
+        memset(headers, 0, PAGE_SIZE);
+        statuses = (volatile uint8_t*)(headers + VIRTIO_BLK_MAX_REQUESTS);
+
+        desc = (VirtqDesc*)ring;
+        availFlags = (volatile uint16_t*)(ring + 16 * queueSize);
+        availIdx = availFlags + 1;
+        availRing = availFlags + 2;
+        usedEvent = availRing + queueSize;
+        usedFlags = (volatile uint16_t*)(ring + usedOffset);
+        usedIdx = usedFlags + 1;
+        usedRing = (volatile VirtqUsedElem*)(usedFlags + 2);
+        availEvent = (volatile uint16_t*)(usedRing + queueSize);
+        nextAvail = 0;
+        lastUsed = 0;
+
+        // Every request is header + data + status, each slot gets a fixed descriptor range
+        perSlot = segMax + 2;
+        slotCount = queueSize / perSlot;
+        if (slotCount > VIRTIO_BLK_MAX_REQUESTS) slotCount = VIRTIO_BLK_MAX_REQUESTS;
+        if (slotCount == 0) return false;
+
+        outl(ioBase + VIRTIO_REG_QUEUE_ADDRESS, (uint32_t)ring / PAGE_SIZE);
+        return true;
+    }
+
+    // Physical pieces of 'bytes' at 'buffer', merging adjacent pages and honouring
+    // sizeMax. Returns the count, 0 if a page is not mapped.
+    uint32_t Translate(const uint8_t* buffer, uint32_t bytes, VirtioSegment* out,
+                       uint32_t maxOut) {
+        Scheduler* sched = Scheduler::activeInstance;
+        Paging* pager = sched ? sched->GetPager() : nullptr;
+        uint32_t* directory;
+        asm volatile("mov %%cr3, %0" : "=r"(directory));
+
+        uint32_t count = 0;
+        uint32_t addr = (uint32_t)buffer;
+        while (bytes > 0) {
+            uint32_t phys;
+            if (pager)
+                phys = pager->GetPhysicalAddress(directory, addr);
+            else
+                phys = addr < VIRTIO_PHYS_LIMIT ? addr : 0;  // Before the scheduler runs
+            if (!phys) return 0;
+
+            uint32_t chunk = PAGE_SIZE - (addr & (PAGE_SIZE - 1));
+            if (chunk > bytes) chunk = bytes;
+            if (sizeMax && chunk > sizeMax) chunk = sizeMax;
+
+            VirtioSegment* last = count ? &out[count - 1] : nullptr;
+            if (last && last->phys + last->len == phys &&
+                (!sizeMax || last->len + chunk <= sizeMax)) {
+                last->len += chunk;
+            } else {
+                if (count == maxOut) return 0;
+                out[count].phys = phys;
+                out[count].len = chunk;
+                count++;
+            }
+            addr += chunk;
+            bytes -= chunk;
+        }
+        return count;
+    }
+
+    uint32_t AcquireSlot() {
+        while (!freeSlots.Wait(VIRTIO_BLK_TIMEOUT_MS)) {
+            uint32_t flags = IrqSave();
+            Reap();
+            IrqRestore(flags);
+        }
+        uint32_t flags = IrqSave();
+        uint32_t slot = 0;
+        while (slotsInUse & (1u << slot)) slot++;
+        slotsInUse |= (1u << slot);
+        completed &= ~(1u << slot);
+        IrqRestore(flags);
+
+        while (done[slot].TryWait()) {
+        }
+        return slot;
+    }
+
+    void ReleaseSlot(uint32_t slot) {
+        uint32_t flags = IrqSave();
+        slotsInUse &= ~(1u << slot);
+        IrqRestore(flags);
+        freeSlots.Signal();
+    }
+
+    void SetDesc(uint32_t index, uint32_t phys, uint32_t len, uint16_t flags, bool last) {
+        desc[index].addr = phys;
+        desc[index].addrHigh = 0;
+        desc[index].len = len;
+        desc[index].flags = flags | (last ? 0 : VIRTQ_DESC_F_NEXT);
+        desc[index].next = last ? 0 : index + 1;
+    }
+
+    // Chain header -> data segments -> status in the slot's descriptors
+    void BuildChain(uint32_t slot, uint32_t type, uint32_t lba, VirtioSegment* segs,
+                    uint32_t segCount) {
+        headers[slot].type = type;
+        headers[slot].reserved = 0;
+        headers[slot].sector = lba;
+        headers[slot].sectorHigh = 0;
+        statuses[slot] = 0xFF;
+
+        uint32_t head = slot * perSlot;
+        SetDesc(head, (uint32_t)&headers[slot], sizeof(VirtioBlkRequestHeader), 0, false);
+        uint16_t dataFlags = (type == VIRTIO_BLK_T_IN) ? VIRTQ_DESC_F_WRITE : 0;
+        for (uint32_t i = 0; i < segCount; i++)
+            SetDesc(head + 1 + i, segs[i].phys, segs[i].len, dataFlags, false);
+        SetDesc(head + 1 + segCount, (uint32_t)&statuses[slot], 1, VIRTQ_DESC_F_WRITE, true);
+    }
+
+    // Publish the chains of 'count' slots with one avail index update, and kick
+    // the device only if it asked for it
+    void Submit(uint32_t* slots, uint32_t count) {
+        uint32_t flags = IrqSave();
+        uint16_t old = nextAvail;
+        for (uint32_t i = 0; i < count; i++) {
+            availRing[nextAvail % queueSize] = slots[i] * perSlot;
+            nextAvail++;
+        }
+        asm volatile("" ::: "memory");
+        *availIdx = nextAvail;
+        __sync_synchronize();  // The index store must land before we read the device's hint
+
+        bool kick;
+        if (features & VIRTIO_RING_F_EVENT_IDX)
+            kick = (uint16_t)(nextAvail - *availEvent - 1) < (uint16_t)(nextAvail - old);
+        else
+            kick = !(*usedFlags & VIRTQ_USED_F_NO_NOTIFY);
+        if (kick) outw(ioBase + VIRTIO_REG_QUEUE_NOTIFY, 0);
+        IrqRestore(flags);
+    }
+
+    bool WaitSlot(uint32_t slot) {
+        while (!(completed & (1u << slot))) {
+            if (!done[slot].Wait(VIRTIO_BLK_TIMEOUT_MS)) {
+                uint32_t flags = IrqSave();
+                Reap();
+                IrqRestore(flags);
+            }
+        }
+        return statuses[slot] == VIRTIO_BLK_S_OK;
+    }
+
+    // Complete every chain on the used ring. Interrupts must be off.
+    void Reap() {
+        while (lastUsed != *usedIdx) {
+            asm volatile("" ::: "memory");
+            uint32_t slot = usedRing[lastUsed % queueSize].id / perSlot;
+            lastUsed++;
+            if (slot < slotCount) {
+                completed |= (1u << slot);
+                done[slot].Signal();
+            }
+        }
+        // Event index: no interrupt until something past what we have seen completes
+        if (features & VIRTIO_RING_F_EVENT_IDX) *usedEvent = lastUsed;
+    }
+
+    void OnInterrupt() {
+        // Reading ISR acknowledges the (possibly shared) INTx line
+        if (inb(ioBase + VIRTIO_REG_ISR_STATUS) & 1) Reap();
+    }
+
+    bool Transfer(uint32_t lba, uint32_t count, uint8_t* data, bool write) {
+        if (count == 0 || count > VIRTIO_BLK_MAX_SECTORS) return false;
+        if (lba >= sectors || count > sectors - lba) return false;
+        if (write && (features & VIRTIO_BLK_F_RO)) return false;
+
+        // 128 KB spans at most 33 pages
+        VirtioSegment segs[VIRTIO_BLK_MAX_SECTORS * BLOCK_SECTOR_SIZE / PAGE_SIZE + 1];
+        uint32_t segCount =
+            Translate(data, count * BLOCK_SECTOR_SIZE, segs, sizeof(segs) / sizeof(segs[0]));
+        if (segCount == 0) return false;
+
+        // Cut the segment list into requests of at most segMax descriptors that each
+        // end on a sector boundary; several requests go to the device as one batch
+        uint32_t slots[VIRTIO_BLK_MAX_REQUESTS];
+        bool ok = true;
+        uint32_t seg = 0;
+        uint32_t segOffset = 0;  // Bytes of segs[seg] already used
+        uint32_t sector = lba;
+        while (ok && seg < segCount) {
+            uint32_t batch = 0;
+            submitLock.Lock();
+            while (seg < segCount && batch < slotCount) {
+                VirtioSegment pieces[VIRTIO_BLK_MAX_SEGMENTS];
+                uint32_t n = 0;
+                uint32_t bytes = 0;
+                for (uint32_t i = seg; i < segCount && n < segMax; i++) {
+                    uint32_t skip = (i == seg) ? segOffset : 0;
+                    pieces[n].phys = segs[i].phys + skip;
+                    pieces[n].len = segs[i].len - skip;
+                    bytes += pieces[n].len;
+                    n++;
+                }
+
+                // Leave a partial last sector to the next request
+                uint32_t tail = bytes % BLOCK_SECTOR_SIZE;
+                bytes -= tail;
+                while (tail) {
+                    uint32_t cut = tail < pieces[n - 1].len ? tail : pieces[n - 1].len;
+                    pieces[n - 1].len -= cut;
+                    tail -= cut;
+                    if (pieces[n - 1].len == 0) n--;
+                }
+                if (bytes == 0) {
+                    // A sector split across more pieces than one request may use
+                    ok = false;
+                    break;
+                }
+
+                // Move the cursor past what this request covers
+                for (uint32_t left = bytes; left > 0;) {
+                    uint32_t rest = segs[seg].len - segOffset;
+                    if (left < rest) {
+                        segOffset += left;
+                        left = 0;
+                    } else {
+                        left -= rest;
+                        seg++;
+                        segOffset = 0;
+                    }
+                }
+
+                uint32_t slot = AcquireSlot();
+                BuildChain(slot, write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN, sector, pieces, n);
+                slots[batch++] = slot;
+                sector += bytes / BLOCK_SECTOR_SIZE;
+            }
+            if (batch) Submit(slots, batch);
+            submitLock.Unlock();
+
+            for (uint32_t i = 0; i < batch; i++) {
+                if (!WaitSlot(slots[i])) ok = false;
+                ReleaseSlot(slots[i]);
+            }
+        }
+        if (!ok) printf("[VIRTIO] %s error at LBA %d\n", write ? "Write" : "Read", lba);
+        return ok;
+    }
+
+public:
+    DynamicVirtioBlkDriver() {
+        driverName = "virtio-blk";
+        ioBase = 0;
+        irqHandler = nullptr;
+        features = 0;
+        sectors = 0;
+        segMax = VIRTIO_BLK_MAX_SEGMENTS;
+        sizeMax = 0;
+        slotCount = 0;
+        perSlot = 0;
+        queueSize = 0;
+        slotsInUse = 0;
+        completed = 0;
+    }
+
+    ~DynamicVirtioBlkDriver() {
+        if (irqHandler) delete irqHandler;
+    }
+
+    void Activate() override {
+        if (!FindHardware()) return;
+
+        outb(ioBase + VIRTIO_REG_DEVICE_STATUS, 0);  // Reset
+        outb(ioBase + VIRTIO_REG_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE);
+        outb(ioBase + VIRTIO_REG_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+
+        uint32_t offered = inl(ioBase + VIRTIO_REG_DEVICE_FEATURES);
+        features = offered & (VIRTIO_BLK_F_SIZE_MAX | VIRTIO_BLK_F_SEG_MAX | VIRTIO_BLK_F_RO |
+                              VIRTIO_BLK_F_FLUSH | VIRTIO_RING_F_EVENT_IDX);
+        outl(ioBase + VIRTIO_REG_GUEST_FEATURES, features);
+
+        // Capacity is 64-bit; only the first 2 TB is addressable with 32-bit LBAs
+        sectors = inl(ioBase + VIRTIO_REG_CONFIG + VIRTIO_BLK_CFG_CAPACITY);
+        if (inl(ioBase + VIRTIO_REG_CONFIG + VIRTIO_BLK_CFG_CAPACITY + 4)) sectors = 0xFFFFFFFF;
+        if (features & VIRTIO_BLK_F_SEG_MAX) {
+            uint32_t deviceSegMax = inl(ioBase + VIRTIO_REG_CONFIG + VIRTIO_BLK_CFG_SEG_MAX);
+            if (deviceSegMax && deviceSegMax < segMax) segMax = deviceSegMax;
+        }
+        if (features & VIRTIO_BLK_F_SIZE_MAX) {
+            sizeMax = inl(ioBase + VIRTIO_REG_CONFIG + VIRTIO_BLK_CFG_SIZE_MAX);
+            sizeMax &= ~(BLOCK_SECTOR_SIZE - 1);
+        }
+
+        if (!SetupQueue()) {
+            printf("[VIRTIO] Queue setup failed\n");
+            outb(ioBase + VIRTIO_REG_DEVICE_STATUS, VIRTIO_STATUS_FAILED);
+            return;
+        }
+        for (uint32_t i = 0; i < slotCount; i++) freeSlots.Signal();
+
+        outb(ioBase + VIRTIO_REG_DEVICE_STATUS,
+             VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_DRIVER_OK);
+
+        is_Active = true;
+        printf("[VIRTIO] Disk: %d sectors (%d MB), queue %d, %d requests x %d segments%s%s\n",
+               sectors, sectors / 2048, queueSize, slotCount, segMax,
+               (features & VIRTIO_RING_F_EVENT_IDX) ? ", event-idx" : "",
+               (features & VIRTIO_BLK_F_RO) ? ", read-only" : "");
+    }
+
+    BlockDevice* GetBlockDevice(uint32_t index) override {
+        return (index == 0 && is_Active) ? this : 0;
+    }
+
+    bool ReadSectors(uint32_t lba, uint32_t count, uint8_t* data) override {
+        return Transfer(lba, count, data, false);
+    }
+
+    bool WriteSectors(uint32_t lba, uint32_t count, const uint8_t* data) override {
+        return Transfer(lba, count, (uint8_t*)data, true);
+    }
+
+    void Flush() override {
+        if (!(features & VIRTIO_BLK_F_FLUSH)) return;  // No volatile write cache
+
+        submitLock.Lock();
+        uint32_t slot = AcquireSlot();
+        BuildChain(slot, VIRTIO_BLK_T_FLUSH, 0, nullptr, 0);
+        Submit(&slot, 1);
+        submitLock.Unlock();
+
+        if (!WaitSlot(slot)) printf("[VIRTIO] Flush failed\n");
+        ReleaseSlot(slot);
+    }
+
+    uint32_t GetSizeInSectors() override {
+        return sectors;
+    }
+
+    uint32_t GetMaxSectors() override {
+        return VIRTIO_BLK_MAX_SECTORS;
+    }
+
+    uint32_t GetQueueDepth() override {
+        return slotCount;
+    }
+};
+
+uint32_t VirtioBlkIRQ::HandleInterrupt(uint32_t esp) {
+    if (driver) driver->OnInterrupt();
+    return esp;
+}
+
+extern "C" Driver* CreateDriverInstance() {
+    DynamicVirtioBlkDriver* drv = new DynamicVirtioBlkDriver();
+    if (!drv) {
+        HALT("CRITICAL: [VIRTIO] Failed to allocate DynamicVirtioBlkDriver!\n");
+    }
+    return drv;
+}
@@ -6,6 +6,8 @@
  * @version     1.0.0
  */
 
+#include <core/syscalls.h>
+#include <core/systrace.h>
 #include <gui/Hgui.h>
 
 HguiHandler* HguiHandler::activeInstance = nullptr;
@@ -20,47 +22,50 @@ HguiHandler::~HguiHandler() {}
 
 uint32_t HguiHandler::HandleInterrupt(uint32_t esp) {
     CPUState* cpu = (CPUState*)esp;
+    uint32_t element;
+    if (!SyscallHandlers::BeginCall(cpu, element)) return esp;
+    SyscallTraceScope trace(cpu, element, true);
 
-    switch ((uint32_t)cpu->eax) {
+    switch (element) {
         case WIDGET:
-            return HandleWidget(esp);
+            esp = HandleWidget(esp);
             break;
         case WINDOW:
-            return HandleWindow(esp);
+            esp = HandleWindow(esp);
             break;
         case BUTTON:
-            return HandleButton(esp);
+            esp = HandleButton(esp);
             break;
         case LABEL:
-            return HandleLabel(esp);
+            esp = HandleLabel(esp);
             break;
         case EVENT:
-            return HandleEvent(esp);
+            esp = HandleEvent(esp);
             break;
 
         default:
+            SyscallHandlers::Return(cpu, SYSCALL_ENOSYS);
             break;
     }
 
+    SyscallHandlers::EndCall(cpu);
     return esp;
 }
 
 uint32_t HguiHandler::HandleWidget(uint32_t esp) {
     CPUState* cpu = (CPUState*)esp;
     WidgetData* _data = (WidgetData*)cpu->ecx;
-    int32_t* return_data = (int32_t*)cpu->edx;
-    if (!return_data) return esp;
 
     if ((uint32_t)cpu->ebx == ADD_CHILD) {
         CompositeWidget* parentWidget = (CompositeWidget*)this->FindWidgetByID(_data->param0);
         if (!parentWidget) {
-            *return_data = -1;
+            SyscallHandlers::Return(cpu, -1);
             return esp;
         }
 
         CompositeWidget* childWidget = (CompositeWidget*)this->FindWidgetByID(_data->param1);
         if (!parentWidget) {
-            *return_data = -1;
+            SyscallHandlers::Return(cpu, -1);
             return esp;
         }
 
@@ -81,13 +86,13 @@ uint32_t HguiHandler::HandleWidget(uint32_t esp) {
             }
         }
 
-        *return_data = 1;
+        SyscallHandlers::Return(cpu, 1);
         return esp;
     } else if ((uint32_t)cpu->ebx == DELETE) {
         HguiWidgets.Remove([&](Widget* c) { return c->ID == _data->param1; });
 
         // TODO: Implement cleanup
-        *return_data = 1;
+        SyscallHandlers::Return(cpu, 1);
         return esp;
     }
 
@@ -97,13 +102,11 @@ uint32_t HguiHandler::HandleWidget(uint32_t esp) {
 uint32_t HguiHandler::HandleWindow(uint32_t esp) {
     CPUState* cpu = (CPUState*)esp;
     WidgetData* _data = (WidgetData*)cpu->ecx;
-    int32_t* return_data = (int32_t*)cpu->edx;
-    if (!return_data) return esp;
 
     if ((uint32_t)cpu->ebx == CREATE) {
         CompositeWidget* parentWidget = (CompositeWidget*)this->FindWidgetByID(_data->param0);
         if (!parentWidget) {
-            *return_data = -1;
+            SyscallHandlers::Return(cpu, -1);
             return esp;
         }
 
@@ -117,18 +120,18 @@ uint32_t HguiHandler::HandleWindow(uint32_t esp) {
         _widget->SetID(_newID);
 
         HguiWidgets.Add(_widget);
-        *return_data = _newID;
+        SyscallHandlers::Return(cpu, _newID);
         return esp;
     } else if ((uint32_t)cpu->ebx == SET_TEXT) {
         Window* widget = (Window*)this->FindWidgetByID(_data->param0);
         if (!widget) {
-            *return_data = -1;
+            SyscallHandlers::Return(cpu, -1);
             return esp;
         }
 
         widget->setWindowTitle(_data->param5);
 
-        *return_data = -1;
+        SyscallHandlers::Return(cpu, -1);
         return esp;
     }
 
@@ -138,13 +141,11 @@ uint32_t HguiHandler::HandleWindow(uint32_t esp) {
 uint32_t HguiHandler::HandleButton(uint32_t esp) {
     CPUState* cpu = (CPUState*)esp;
     WidgetData* _data = (WidgetData*)cpu->ecx;
-    int32_t* return_data = (int32_t*)cpu->edx;
-    if (!return_data) return esp;
 
     if ((uint32_t)cpu->ebx == CREATE) {
         CompositeWidget* parentWidget = (CompositeWidget*)this->FindWidgetByID(_data->param0);
         if (!parentWidget | parentWidget->ID == 0) {
-            *return_data = -1;
+            SyscallHandlers::Return(cpu, -1);
             return esp;
         }
 
@@ -158,7 +159,7 @@ uint32_t HguiHandler::HandleButton(uint32_t esp) {
         _widget->SetID(_newID);
 
         HguiWidgets.Add(_widget);
-        *return_data = _newID;
+        SyscallHandlers::Return(cpu, _newID);
         return esp;
     }
 
@@ -168,13 +169,11 @@ uint32_t HguiHandler::HandleButton(uint32_t esp) {
 uint32_t HguiHandler::HandleLabel(uint32_t esp) {
     CPUState* cpu = (CPUState*)esp;
     WidgetData* _data = (WidgetData*)cpu->ecx;
-    int32_t* return_data = (int32_t*)cpu->edx;
-    if (!return_data) return esp;
 
     if ((uint32_t)cpu->ebx == CREATE) {
         CompositeWidget* parentWidget = (CompositeWidget*)this->FindWidgetByID(_data->param0);
         if (!parentWidget || parentWidget->ID == 0) {
-            *return_data = -1;
+            SyscallHandlers::Return(cpu, -1);
             return esp;
         }
 
@@ -188,29 +187,29 @@ uint32_t HguiHandler::HandleLabel(uint32_t esp) {
         _widget->SetID(_newID);
 
         HguiWidgets.Add(_widget);
-        *return_data = _newID;
+        SyscallHandlers::Return(cpu, _newID);
         return esp;
     } else if ((uint32_t)cpu->ebx == SET_TEXT) {
         Label* widget = (Label*)this->FindWidgetByID(_data->param0);
         if (!widget) {
-            *return_data = -1;
+            SyscallHandlers::Return(cpu, -1);
             return esp;
         }
 
         widget->setText(_data->param5);
 
-        *return_data = -1;
+        SyscallHandlers::Return(cpu, -1);
         return esp;
     } else if ((uint32_t)cpu->ebx == SET_FONT_SIZE) {
         Label* widget = (Label*)this->FindWidgetByID(_data->param0);
         if (!widget) {
-            *return_data = -1;
+            SyscallHandlers::Return(cpu, -1);
             return esp;
         }
 
         widget->setSize((FontSize)_data->param1);
 
-        *return_data = -1;
+        SyscallHandlers::Return(cpu, -1);
         return esp;
     }
 
@@ -219,20 +218,25 @@ uint32_t HguiHandler::HandleLabel(uint32_t esp) {
 
 uint32_t HguiHandler::HandleEvent(uint32_t esp) {
     CPUState* cpu = (CPUState*)esp;
-    int32_t* return_data = (int32_t*)cpu->edx;
-    if (!return_data) return esp;
 
     ProcessControlBlock* p = Scheduler::activeInstance->GetCurrentProcess();
     EventHandler* process_eventHandler = Desktop::activeInstance->getHandler(p->pid);
 
     if ((uint32_t)cpu->ebx == GET) {
-        if ((uint32_t)process_eventHandler->eventQueue.GetSize() > 0) {
+        // No events: sleep until one is posted (or 1s passes, then report "none")
+        WaitQueue& wait = process_eventHandler->eventWait;
+        uint32_t flags = wait.lock.Lock();
+        if (process_eventHandler->eventQueue.IsEmpty()) {
+            wait.SleepLocked(flags, 1000);
+        } else {
+            wait.lock.Unlock(flags);
+        }
+
+        if (!process_eventHandler->eventQueue.IsEmpty()) {
             Event* tmp = process_eventHandler->eventQueue.PopFront();
-            *return_data = (tmp->widgetID << 16) | tmp->eventType;
+            SyscallHandlers::Return(cpu, (tmp->widgetID << 16) | tmp->eventType);
         } else {
-            // No events, sleep until an event arrives
-            *return_data = -1;
-            Scheduler::activeInstance->Sleep(1000);
+            SyscallHandlers::Return(cpu, -1);
         }
         return esp;
     }
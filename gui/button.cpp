@@ -108,7 +108,7 @@ void Button::OnMouseUp(int32_t x, int32_t y, uint8_t) {
         }
         EventHandler* handler = Desktop::activeInstance->getHandler(this->PID);
         handler->eventQueue.Add(new_event);
-        g_scheduler->WakeThread(handler->thread);
+        handler->eventWait.WakeAll();
     }
 }
 
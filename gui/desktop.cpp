@@ -82,7 +82,7 @@ EventHandler* Desktop::getHandler(uint32_t pid) {
 }
 
 void Desktop::Draw(GraphicsDriver* gc) {
-    InterruptGuard guard;
+    SpinlockGuard guard(sceneLock);
     uint32_t screenW = gc->GetWidth();
     uint32_t screenH = gc->GetHeight();
     uint32_t* vesaBuffer = gc->GetBackBuffer();
@@ -183,11 +183,27 @@ void Desktop::Draw(GraphicsDriver* gc) {
     }
 }
 
+void Desktop::MarkDirty() {
+    Widget::MarkDirty();
+    redrawWait.WakeAll();
+}
+
+void Desktop::WaitForRedraw(uint32_t timeoutMs) {
+    // Check under the queue lock so a MarkDirty between the test and the sleep is not lost
+    uint32_t flags = redrawWait.lock.Lock();
+    if (isDirty || MouseMoved()) {
+        redrawWait.lock.Unlock(flags);
+        return;
+    }
+    redrawWait.SleepLocked(flags, timeoutMs);
+}
+
 uint32_t Desktop::getNewID() {
     return current_id++;
 }
 
 void Desktop::RemoveAppByPID(uint32_t pid) {
+    SpinlockGuard guard(sceneLock);
     Widget* result = nullptr;
     childrenList.ForEach([&](Widget* c) {
         if (!result && c->PID == pid) result = c;
@@ -261,6 +277,9 @@ void Desktop::OnMouseMove(int32_t dx, int32_t dy) {
     if (MouseX >= (uint32_t)w) MouseX = w - 1;
     if (MouseY >= (uint32_t)h) MouseY = h - 1;
 
+    // Wake the render thread for the cursor update
+    redrawWait.WakeAll();
+
     // Pass delta to UI
     CompositeWidget::OnMouseMove(MouseX - dx, MouseY - dy, MouseX, MouseY);
 
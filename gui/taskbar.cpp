@@ -6,6 +6,7 @@
  * @version     2.0.0
  */
 
+#include <core/systrace.h>
 #include <core/timing.h>
 #include <gui/taskbar.h>
 
@@ -111,6 +112,8 @@ void StartMenuButton::LaunchProgram() {
             ProcessControlBlock* prog = g_elfLoader->loadELF(file, args);
             if (!prog) {
                 DEBUG_LOG("StartMenu: Failed to load ELF: %s\n", binPath);
+            } else {
+                SyscallTrace::Launched(prog, binPath);
             }
         }
         file->Close();
@@ -42,7 +42,7 @@ void Window::OnClose() {
     }
     EventHandler* handler = Desktop::activeInstance->getHandler(this->PID);
     handler->eventQueue.Add(new_event);
-    g_scheduler->WakeThread(handler->thread);
+    handler->eventWait.WakeAll();
 }
 
 void Window::setWindowTitle(const char* title) {
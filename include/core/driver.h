@@ -7,6 +7,7 @@
 #include <types.h>
 
 class AudioDriver;
+class BlockDevice;
 
 /**
  * @brief Base class for hardware drivers.
@@ -45,6 +46,10 @@ public:
     virtual GraphicsDriver* AsGraphicsDriver() {
         return 0;
     }
+    // Storage drivers: the index-th disk they found, 0 past the last one
+    virtual BlockDevice* GetBlockDevice(uint32_t index) {
+        return 0;
+    }
 
 protected:
     bool is_Active = false;
@@ -2,6 +2,7 @@
 #define AUDIO_DRIVER_H
 
 #include <core/driver.h>
+#include <core/sync.h>
 #include <types.h>
 
 typedef void (*AudioCallback)(void* context);
@@ -15,6 +16,8 @@ protected:
     uint8_t masterVolume;
     AudioCallback refillCallback;
     void* callbackContext;
+    WaitQueue bufferFree;         // Woken by the driver's IRQ when a hardware buffer drains
+    volatile uint32_t underruns;  // Times the hardware ran out of queued audio while playing
 
 public:
     AudioDriver() {
@@ -25,6 +28,7 @@ public:
         this->masterVolume = 100;
         this->refillCallback = nullptr;
         this->callbackContext = nullptr;
+        this->underruns = 0;
     }
 
     virtual ~AudioDriver() {}
@@ -53,6 +57,17 @@ public:
         return true;
     }
 
+    // Sleep until IsReadyForData() or timeout. Returns IsReadyForData().
+    bool WaitForBufferSpace(uint32_t timeoutMs) {
+        uint32_t flags = bufferFree.lock.Lock();
+        if (IsReadyForData()) {
+            bufferFree.lock.Unlock(flags);
+            return true;
+        }
+        bufferFree.SleepLocked(flags, timeoutMs);
+        return IsReadyForData();
+    }
+
     virtual void SetVolume(uint8_t vol) {
         if (vol > 100) vol = 100;
         this->masterVolume = vol;
@@ -68,6 +83,9 @@ public:
     bool IsPlaying() {
         return isPlaying;
     }
+    uint32_t GetUnderruns() {
+        return underruns;
+    }
 
 protected:
     void NotifyRefillNeeded() {
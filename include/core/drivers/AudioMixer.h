@@ -3,11 +3,16 @@
 
 #include <core/drivers/AudioDriver.h>
 #include <core/memory.h>
+#include <core/sync.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <utils/string.h>
 
 class AudioDriver;
+class Scheduler;
+
+// Fallback refill period for drivers whose IRQ never wakes the mixer thread
+#define AUDIO_THREAD_TIMEOUT_MS 10
 
 struct AudioStream {
     uint8_t* data;
@@ -25,6 +30,11 @@ private:
     uint8_t* mixBuffer;
     uint32_t bufferSize;
 
+    Mutex mixLock;       // streams[] and mixBuffer (PlayBuffer vs. the mixer thread)
+    WaitQueue playWait;  // Mixer thread parks here while the driver is stopped
+    bool threadStarted;
+    uint32_t reportedUnderruns;
+
 public:
     explicit AudioMixer(AudioDriver* drv);
 
@@ -34,8 +44,16 @@ public:
 
     void Update();
 
+    // Start the realtime mixer thread, woken by the driver's buffer-complete IRQ
+    void StartThread(Scheduler* scheduler);
+
+    uint32_t GetUnderruns() {
+        return driver ? driver->GetUnderruns() : 0;
+    }
+
 private:
     void ProcessAudio();
+    static void MixerThread(void* arg);
 };
 
 #endif  // AUDIO_MIXER_H
@@ -0,0 +1,120 @@
+#ifndef BLOCK_DEVICE_H
+#define BLOCK_DEVICE_H
+
+#include <types.h>
+
+#define BLOCK_SECTOR_SIZE 512
+
+// One piece of a vectored transfer: 'count' whole sectors at 'data'
+struct BlockVector {
+    uint8_t* data;
+    uint32_t count;
+};
+
+struct BlockRequest;
+typedef void (*BlockCompletion)(BlockRequest* request);
+
+/**
+ * @brief An asynchronous transfer handed to BlockDevice::Submit().
+ *
+ * The submitter keeps the request (and its buffer) alive until 'done' is set.
+ * 'callback', if any, runs once right after that, possibly in IRQ context, so it
+ * must not sleep; signalling a Semaphore or WaitQueue is fine.
+ */
+struct BlockRequest {
+    uint32_t lba;
+    uint32_t count;
+    uint8_t* data;
+    bool write;
+
+    bool ok;             // Valid once 'done' is set
+    volatile bool done;  // Set by the device
+    BlockCompletion callback;
+    void* context;  // For the callback
+
+    // Owned by a BlockQueue while the request sits in it
+    BlockRequest* queueNext;
+    uint32_t queueSeq;       // Submission order
+    uint32_t queueDeadline;  // timerTicks by which it should be dispatched
+};
+
+/**
+ * @class BlockDevice
+ * @brief A disk addressed in fixed-size sectors, as seen by the partition table and FAT32.
+ *
+ * Implemented by the built-in ATA driver, the RAM disk and by storage modules
+ * (AHCI, virtio-blk). Calls may sleep, so they must not be made from IRQ
+ * context. Writes may sit in the device's volatile cache until Flush().
+ *
+ * Only ReadSectors/WriteSectors are required. The vector and Submit() defaults
+ * fall back to them, so a driver overrides those only when it can do better
+ * (one scatter-gather command, real queueing).
+ */
+class BlockDevice {
+public:
+    virtual ~BlockDevice() {}
+
+    // 1..GetMaxSectors() whole sectors. Returns false on a device error.
+    virtual bool ReadSectors(uint32_t lba, uint32_t count, uint8_t* data) = 0;
+    virtual bool WriteSectors(uint32_t lba, uint32_t count, const uint8_t* data) = 0;
+    virtual void Flush() = 0;
+
+    virtual uint32_t GetSizeInSectors() = 0;
+    virtual uint32_t GetMaxSectors() = 0;  // Largest count one request may carry
+    virtual uint32_t GetSectorSize() {
+        return BLOCK_SECTOR_SIZE;
+    }
+    // Commands worth keeping in flight at once (NCQ tags, virtqueue slots)
+    virtual uint32_t GetQueueDepth() {
+        return 1;
+    }
+
+    // Consecutive sectors starting at 'lba', scattered over several buffers
+    virtual bool ReadVector(uint32_t lba, const BlockVector* vec, uint32_t vecCount) {
+        return TransferEach(lba, vec, vecCount, false);
+    }
+    virtual bool WriteVector(uint32_t lba, const BlockVector* vec, uint32_t vecCount) {
+        return TransferEach(lba, vec, vecCount, true);
+    }
+
+    // Start a transfer and return; completion is reported through the request.
+    // The default does the transfer synchronously before returning.
+    virtual void Submit(BlockRequest* request) {
+        bool ok = request->write ? WriteSectors(request->lba, request->count, request->data)
+                                 : ReadSectors(request->lba, request->count, request->data);
+        Complete(request, ok);
+    }
+
+    static uint32_t VectorSectors(const BlockVector* vec, uint32_t vecCount) {
+        uint32_t sectors = 0;
+        for (uint32_t i = 0; i < vecCount; i++) sectors += vec[i].count;
+        return sectors;
+    }
+
+protected:
+    static void Complete(BlockRequest* request, bool ok) {
+        request->ok = ok;
+        request->done = true;
+        if (request->callback) request->callback(request);
+    }
+
+    // Vector fallback: each piece in GetMaxSectors() sized commands
+    bool TransferEach(uint32_t lba, const BlockVector* vec, uint32_t vecCount, bool write) {
+        uint32_t max = GetMaxSectors();
+        uint32_t sectorSize = GetSectorSize();
+        for (uint32_t i = 0; i < vecCount; i++) {
+            for (uint32_t done = 0; done < vec[i].count;) {
+                uint32_t n = vec[i].count - done;
+                if (n > max) n = max;
+                uint8_t* data = vec[i].data + done * sectorSize;
+                bool ok = write ? WriteSectors(lba, n, data) : ReadSectors(lba, n, data);
+                if (!ok) return false;
+                lba += n;
+                done += n;
+            }
+        }
+        return true;
+    }
+};
+
+#endif  // BLOCK_DEVICE_H
@@ -0,0 +1,102 @@
+#ifndef BLOCK_QUEUE_H
+#define BLOCK_QUEUE_H
+
+#include <core/drivers/BlockDevice.h>
+#include <core/sync.h>
+#include <types.h>
+
+class Scheduler;
+
+// Dispatch threads per device, bounded by the device's GetQueueDepth()
+#define BLOCK_QUEUE_MAX_WORKERS 4
+
+// Requests merged into one device command
+#define BLOCK_QUEUE_MAX_MERGE 16
+
+// Past these ages a request is dispatched before the elevator gets to it
+#define BLOCK_QUEUE_READ_DEADLINE_MS 50
+#define BLOCK_QUEUE_WRITE_DEADLINE_MS 500
+
+// Counters since creation, copied out by GetStats
+struct BlockQueueStats {
+    uint32_t submitted;
+    uint32_t dispatched;  // Device commands
+    uint32_t merged;      // Requests that rode along in another request's command
+    uint32_t expired;     // Dispatched by deadline rather than elevator order
+    uint32_t maxPending;
+};
+
+/**
+ * @class BlockQueue
+ * @brief Per-device request queue with merging and elevator ordering.
+ *
+ * Requests are kept sorted by LBA. Worker threads take the next one in C-LOOK
+ * order (ascending from where the last command ended, then wrapping), unless
+ * some request has waited past its deadline, and merge the requests that follow
+ * it on disk into one vectored command. Up to GetQueueDepth() workers keep that
+ * many commands in flight. A request never overtakes an older one it overlaps
+ * when either of them writes.
+ *
+ * The queue is itself a BlockDevice, so the sector cache and FAT32 stack on it
+ * unchanged; their synchronous calls wait on a semaphore (and bounce user
+ * buffers through kernel memory). Until Start() has run
+ * and the caller is a thread that can sleep, requests are executed directly.
+ */
+class BlockQueue : public BlockDevice {
+private:
+    BlockDevice* dev;
+    Mutex lock;
+    CondVar work;  // Requests arrived, or an overlap cleared
+    CondVar idle;  // Nothing pending or in flight
+
+    BlockRequest* pending;  // Sorted by LBA, then submission order
+    BlockRequest* active;   // Dispatched, not completed
+    uint32_t pendingCount;
+    uint32_t inFlight;
+    uint32_t nextSeq;
+    uint32_t headPosition;  // LBA just past the last dispatched command
+    bool started;
+
+    BlockQueueStats stats;
+
+    bool Eligible(BlockRequest* request);
+    uint32_t TakeBatch(BlockRequest** batch);
+    void Execute(BlockRequest** batch, uint32_t count);
+    bool Transfer(uint32_t lba, uint32_t count, uint8_t* data, bool write);
+    static void Worker(void* arg);
+
+public:
+    BlockQueue(BlockDevice* dev);
+    ~BlockQueue();
+
+    // Start the dispatch threads
+    void Start(Scheduler* scheduler);
+
+    // The buffer must be kernel memory: it is used from the worker threads
+    void Submit(BlockRequest* request) override;
+
+    // Submit and sleep until done. These may be given user buffers of the
+    // calling process.
+    bool ReadSectors(uint32_t lba, uint32_t count, uint8_t* data) override;
+    bool WriteSectors(uint32_t lba, uint32_t count, const uint8_t* data) override;
+
+    // Waits for everything submitted so far, then flushes the device's cache
+    void Flush() override;
+
+    uint32_t GetSizeInSectors() override {
+        return dev->GetSizeInSectors();
+    }
+    uint32_t GetMaxSectors() override {
+        return dev->GetMaxSectors();
+    }
+    uint32_t GetSectorSize() override {
+        return dev->GetSectorSize();
+    }
+    uint32_t GetQueueDepth() override {
+        return dev->GetQueueDepth();
+    }
+
+    void GetStats(BlockQueueStats* out);
+};
+
+#endif  // BLOCK_QUEUE_H
@@ -16,6 +16,8 @@ public:
     // Loads a relocatable ELF (.o file)
     // Returns the address of the "CreateDriverInstance" function (or entry point)
     static void* LoadMatchingDriver(File* file, uint16_t target_vid, uint16_t target_did);
+    // Same, for drivers that declare a DRIVER_MATCH_CLASS entry
+    static void* LoadMatchingClassDriver(File* file, uint8_t target_class, uint8_t target_subclass);
     static bool Probe(File* file, DriverManifest* info);
 
 private:
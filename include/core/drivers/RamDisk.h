@@ -0,0 +1,45 @@
+#ifndef RAM_DISK_H
+#define RAM_DISK_H
+
+#include <core/drivers/BlockDevice.h>
+#include <core/pmm.h>
+#include <types.h>
+
+// Pages must be identity-mapped for the kernel to reach them
+#define RAMDISK_PHYS_LIMIT (256 * 1024 * 1024)
+#define RAMDISK_SECTORS_PER_PAGE (PMM_BLOCK_SIZE / BLOCK_SECTOR_SIZE)
+
+/**
+ * @class RamDisk
+ * @brief A BlockDevice held in PMM pages, to measure the filesystem without disk latency.
+ *
+ * The pages need not be contiguous: a table maps every 8 sectors to their page.
+ * Transfers are plain memcpy, complete synchronously and have no size limit;
+ * Flush() has nothing to do. Contents are lost on reboot.
+ */
+class RamDisk : public BlockDevice {
+private:
+    uint8_t** pages;
+    uint32_t pageCount;
+    uint32_t sectors;
+
+    bool Copy(uint32_t lba, uint32_t count, uint8_t* buffer, bool write);
+
+public:
+    // Starts zero-filled. If memory runs out the disk is smaller than asked for.
+    RamDisk(uint32_t sizeInSectors);
+    ~RamDisk();
+
+    bool ReadSectors(uint32_t lba, uint32_t count, uint8_t* data) override;
+    bool WriteSectors(uint32_t lba, uint32_t count, const uint8_t* data) override;
+    void Flush() override {}
+
+    uint32_t GetSizeInSectors() override {
+        return sectors;
+    }
+    uint32_t GetMaxSectors() override {
+        return sectors;
+    }
+};
+
+#endif  // RAM_DISK_H
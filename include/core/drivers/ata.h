@@ -2,14 +2,87 @@
 #ifndef ATA_H
 #define ATA_H
 
+#include <core/drivers/BlockDevice.h>
 #include <core/interrupts.h>
 #include <core/ports.h>
+#include <core/sync.h>
 #include <debug.h>
 #include <types.h>
 
-class AdvancedTechnologyAttachment {
+// Upper bound for a single command before falling back to status polling
+#define ATA_IRQ_TIMEOUT_MS 100
+
+// Sectors moved by one READ/WRITE command (a count register of 0 means 256)
+#define ATA_MAX_SECTORS 256
+
+// Bus-master IDE: PRD entries per drive. 256 sectors span at most 33 pages.
+#define ATA_PRD_MAX 64
+#define ATA_PRD_EOT 0x8000
+
+// Bus-master register block (BAR4 of the IDE controller, +8 for the secondary channel)
+#define ATA_BM_COMMAND 0x0
+#define ATA_BM_STATUS 0x2
+#define ATA_BM_PRDT 0x4
+
+#define ATA_BM_CMD_START 0x01
+#define ATA_BM_CMD_READ 0x08  // Device to memory
+#define ATA_BM_STATUS_ACTIVE 0x01
+#define ATA_BM_STATUS_ERROR 0x02
+#define ATA_BM_STATUS_IRQ 0x04
+
+// One physically contiguous piece of a DMA transfer, never crossing a 64 KB boundary
+struct ATAPhysicalRegion {
+    uint32_t address;
+    uint16_t byteCount;  // 0 = 64 KB
+    uint16_t flags;      // ATA_PRD_EOT on the last entry
+} __attribute__((packed));
+
+/**
+ * @class ATAChannelIRQ
+ * @brief IRQ14/IRQ15 handler shared by the master and slave of one channel.
+ *
+ * Signals 'done' on every completion so the issuing thread can sleep instead of
+ * spinning on the status register, and owns the mutex that keeps two threads
+ * from interleaving commands on the same channel.
+ */
+class ATAChannelIRQ : public InterruptHandler {
+    uint16_t statusPort;
+
+public:
+    Semaphore done;
+    Mutex busy;
+
+    ATAChannelIRQ(uint8_t irq, uint16_t portBase, InterruptManager* interruptManager);
+    uint32_t HandleInterrupt(uint32_t esp) override;
+};
+
+class AdvancedTechnologyAttachment : public BlockDevice {
 private:
     uint32_t ata_size;
+    ATAChannelIRQ* channel;   // nullptr until EnableInterrupts()
+    uint8_t multipleSectors;  // Sectors per DRQ block after SET MULTIPLE, 0 = single
+    bool dmaCapable;          // IDENTIFY word 49 bit 8
+    uint16_t busMasterPort;   // 0 until EnableDMA() found the controller
+    ATAPhysicalRegion* prdTable;
+
+    static ATAChannelIRQ* channels[2];  // Primary, Secondary
+
+    void BeginCommand();
+    void WaitForIRQ();
+    void EndCommand();
+
+    void SelectLBA28(uint32_t sectorNum, uint32_t count);
+    uint8_t WaitNotBusy();
+    uint8_t WaitDataRequest();
+    void SetMultipleMode(uint8_t sectors);
+
+    // Called between BeginCommand() and EndCommand()
+    bool ReadPIO(uint32_t sectorNum, uint32_t count, uint8_t* data);
+    bool WritePIO(uint32_t sectorNum, uint32_t count, const uint8_t* data);
+    bool BuildPRDTable(const BlockVector* vec, uint32_t vecCount);
+    bool TransferDMA(uint32_t sectorNum, uint32_t count, bool write);
+    bool TransferVector(uint32_t sectorNum, const BlockVector* vec, uint32_t vecCount,
+                        bool write);
 
 protected:
     bool master;
@@ -28,14 +101,32 @@ public:
     ~AdvancedTechnologyAttachment();
 
     uint32_t Identify();
-    void Read28(uint32_t sectorNum, uint8_t* data, int count = 512);
 
-    void Write28(uint32_t sectorNum, uint8_t* data, uint32_t count);
-    void Flush();
+    // Switch from pure polling to IRQ completion (needs the scheduler and IDT)
+    void EnableInterrupts(InterruptManager* interruptManager);
 
-    uint32_t GetSizeInSectors() {
+    // Find the PCI IDE controller and move data by bus-master DMA from now on.
+    // Buffers DMA cannot reach (odd address, unmapped page) still go by PIO.
+    bool EnableDMA();
+
+    // Whole-sector transfers of 1..ATA_MAX_SECTORS sectors in one command.
+    // Writes stay in the drive's write cache until Flush().
+    bool ReadSectors(uint32_t sectorNum, uint32_t count, uint8_t* data) override;
+    bool WriteSectors(uint32_t sectorNum, uint32_t count, const uint8_t* data) override;
+
+    // Up to ATA_MAX_SECTORS in total go out as one scatter-gather DMA command
+    bool ReadVector(uint32_t sectorNum, const BlockVector* vec, uint32_t vecCount) override;
+    bool WriteVector(uint32_t sectorNum, const BlockVector* vec, uint32_t vecCount) override;
+
+    // CACHE FLUSH: commit everything written so far to the media
+    void Flush() override;
+
+    uint32_t GetSizeInSectors() override {
         return ata_size;
     }
+    uint32_t GetMaxSectors() override {
+        return ATA_MAX_SECTORS;
+    }
 };
 
 #endif  // ATA_H
@@ -5,12 +5,17 @@
 
 #define DRIVER_INFO_MAGIC 0x44525649
 
-// Simple struct for a pair of IDs
+// Simple struct for a pair of IDs.
+// With vendor_id == DRIVER_MATCH_CLASS the entry matches a PCI class instead:
+// device_id holds DRIVER_CLASS_ID(class, subclass).
 struct HardwareID {
     uint16_t vendor_id;
     uint16_t device_id;
 };
 
+#define DRIVER_MATCH_CLASS 0xFFFF
+#define DRIVER_CLASS_ID(class_id, subclass_id) ((uint16_t)(((class_id) << 8) | (subclass_id)))
+
 struct DriverManifest {
     uint32_t magic;
     char name[32];
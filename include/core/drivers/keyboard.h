@@ -6,6 +6,8 @@
 #include <core/ports.h>
 #include <types.h>
 
+#define KEYBOARD_QUEUE_SIZE 64  ///< Scancodes buffered between the IRQ and the keyboard softirq
+
 /**
  * @brief Base class for handling keyboard events.
  *
@@ -60,6 +62,14 @@ class KeyboardDriver : public InterruptHandler, public Driver {
     KeyboardEventHandler* eventHandler;  ///< Event handler for keyboard events.
     uint8_t keyStates[128];              ///< Scancode-indexed key state (1=pressed, 0=released)
 
+    uint8_t scancodes[KEYBOARD_QUEUE_SIZE];  ///< Raw scancodes waiting for the softirq
+    volatile uint32_t queueHead;             ///< Written by the IRQ handler only
+    volatile uint32_t queueTail;             ///< Written by the softirq only
+    bool irqExtended;                        ///< IRQ saw an 0xE0 prefix (for InputQueue)
+
+    static void ProcessScancodes(void* arg);
+    void ProcessScancode(uint8_t key);
+
 public:
     static KeyboardDriver* activeInstance;
 
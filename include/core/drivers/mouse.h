@@ -6,6 +6,8 @@
 #include <core/ports.h>
 #include <types.h>
 
+#define MOUSE_QUEUE_SIZE 32  ///< Packets buffered between the IRQ and the mouse softirq
+
 /**
  * @brief Base class for handling mouse events.
  *
@@ -56,6 +58,13 @@ class MouseDriver : public InterruptHandler, public Driver {
     int32_t accumDX;                  ///< Accumulated mouse X delta for polling
     int32_t accumDY;                  ///< Accumulated mouse Y delta for polling
 
+    uint8_t packets[MOUSE_QUEUE_SIZE][3];  ///< Complete packets waiting for the softirq
+    volatile uint32_t queueHead;           ///< Written by the IRQ handler only
+    volatile uint32_t queueTail;           ///< Written by the softirq only
+    uint8_t eventButtons;                  ///< Button state last sent to eventHandler
+
+    static void ProcessPackets(void* arg);
+
 public:
     static MouseDriver* activeInstance;
 
@@ -1,12 +1,16 @@
 #ifndef FAT32_H
 #define FAT32_H
 
-#include <core/drivers/ata.h>
+#include <core/drivers/BlockDevice.h>
 #include <core/filesystem/File.h>
+#include <core/filesystem/SectorCache.h>
 #include <core/memory.h>
+#include <core/sync.h>
 #include <types.h>
 #include <utils/string.h>
 
+class Scheduler;
+
 // Standard FAT32 Structures
 struct BiosParameterBlock32 {
     uint8_t jump[3];
@@ -54,14 +58,52 @@ struct DirectoryEntryFat32 {
     uint32_t size;
 } __attribute__((packed));
 
+// Sector cache write-back passes: allocations in the FAT reach the disk before
+// the directory entries that point at them
+#define FAT32_PASS_FAT 0
+#define FAT32_PASS_DIR 1
+
+// Readahead window per open file: starts small, doubles while reads stay sequential
+#define FAT32_READAHEAD_MIN (16 * 1024)
+#define FAT32_READAHEAD_MAX (128 * 1024)
+
+// File bytes [start, start + length), being fetched until 'done' is signalled
+struct ReadaheadBuffer {
+    uint8_t* data;  // FAT32_READAHEAD_MAX bytes, allocated on first use
+    uint32_t start;
+    uint32_t length;  // 0 = empty
+    bool inFlight;
+    bool reconciled;      // Checked against the sector cache since it arrived
+    uint32_t generation;  // SectorCache::ReadGeneration() when it was issued
+    BlockRequest request;
+    Semaphore done;
+};
+
+// Per open file (File::readahead)
+struct FileReadahead {
+    ReadaheadBuffer buffers[2];  // Taking turns: one is read from while the other fills
+    uint32_t nextOffset;         // Where a sequential read would start
+    uint32_t streak;             // Sequential reads in a row
+    uint32_t window;             // Bytes the next prefetch asks for
+};
+
+// Counters since mount, copied out by GetReadaheadStats
+struct ReadaheadStats {
+    uint32_t prefetches;
+    uint32_t hitBytes;   // Served from a readahead buffer
+    uint32_t missBytes;  // Read from the device while the caller waited
+    uint32_t waits;      // Reads that caught up with a prefetch still in flight
+};
+
 class FAT32 {
 public:
-    FAT32(AdvancedTechnologyAttachment* hd, uint32_t partitionOffset);
+    FAT32(BlockDevice* hd, uint32_t partitionOffset,
+          uint32_t cacheBlocks = SECTOR_CACHE_DEFAULT_BLOCKS);
     ~FAT32();
 
     // User API
     File* Open(char* path);
-    void ReadStream(File* file, uint8_t* buffer, uint32_t length);
+    bool ReadStream(File* file, uint8_t* buffer, uint32_t length);  // False on an I/O error
     void ListRoot();
     void ListDir(char* path);
     void CreateFile(char* path);
@@ -72,12 +114,30 @@ public:
     void WriteFile(char* path, uint8_t* buffer, uint32_t length);
     uint32_t GetFileSize(char* path);
 
+    void GetCacheStats(SectorCacheStats* out) {
+        cache->GetStats(out);
+    }
+    void GetReadaheadStats(ReadaheadStats* out) {
+        *out = readaheadStats;
+    }
+
+    // Called by File::Close(): waits for its prefetches, then frees the buffers
+    void ReleaseReadahead(File* file);
+
+    // Hand metadata write-back to a background thread. Before this every
+    // mutating call writes its changes back before returning.
+    void StartFlusher(Scheduler* scheduler);
+    // Everything written so far is on the disk when this returns
+    void Sync();
+
     void Format();
-    static void FormatRaw(AdvancedTechnologyAttachment* hd, uint32_t startSector,
-                          uint32_t sizeSectors);
+    static void FormatRaw(BlockDevice* hd, uint32_t startSector, uint32_t sizeSectors);
 
 private:
-    AdvancedTechnologyAttachment* hd;
+    BlockDevice* hd;
+    // FAT and directory sectors go through the cache, file data bypasses it
+    // (written before the metadata that refers to it). See Commit().
+    SectorCache* cache;
     BiosParameterBlock32 bpb;
 
     uint32_t partitionOffset;
@@ -85,13 +145,24 @@ private:
     uint32_t dataStart;
     uint32_t rootStart;
     bool valid;
+    uint32_t nextFree;  // Where AllocateCluster starts looking
+    ReadaheadStats readaheadStats;
 
     // --- Helpers ---
     uint32_t ClusterToSector(uint32_t cluster);
     uint32_t GetFATEntry(uint32_t cluster);
-    void SetFATEntry(uint32_t cluster, uint32_t value);
+    bool SetFATEntry(uint32_t cluster, uint32_t value);
     uint32_t AllocateCluster();
     void FreeChain(uint32_t startCluster);
+    bool WriteCluster(uint32_t cluster, const uint8_t* data, uint32_t length);
+    void Commit();
+
+    // --- Open File Helpers ---
+    bool BuildRunList(File* file);
+    FileExtent* FindExtent(File* file, uint32_t clusterIndex);
+    bool ReadDirect(File* file, uint32_t offset, uint8_t* buffer, uint32_t length);
+    bool WaitReadahead(ReadaheadBuffer* buffer);
+    void Prefetch(File* file, FileReadahead* ra, uint32_t offset, ReadaheadBuffer* keep);
 
     // --- Directory Helpers ---
     bool FindEntryInCluster(uint32_t cluster, char* name, uint32_t& sectorOut, uint32_t& offsetOut,
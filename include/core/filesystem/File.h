@@ -5,6 +5,15 @@
 #include <types.h>
 
 class FAT32;
+struct FileReadahead;
+
+// A run of physically contiguous clusters: file clusters
+// [fileCluster, fileCluster + length) live at disk clusters [diskCluster, ...)
+struct FileExtent {
+    uint32_t fileCluster;
+    uint32_t diskCluster;
+    uint32_t length;
+};
 
 class File {
 public:
@@ -23,9 +32,20 @@ public:
     // The Driver that handles this file
     FAT32* filesystem;
 
+    // Cluster run-list, built by the filesystem on the first read and sorted
+    // by fileCluster. Freed by Close().
+    FileExtent* extents;
+    uint32_t extentCount;
+    bool extentsBuilt;
+
+    // Sequential readahead state, created by the filesystem on the first read.
+    // Released by Close().
+    FileReadahead* readahead;
+
     // --- Operations ---
     // Reads 'length' bytes from current 'position' into buffer
-    // Returns number of bytes actually read. Updates 'position'.
+    // Returns number of bytes actually read, or -1 on a device error.
+    // Updates 'position' (not on an error).
     int Read(uint8_t* buffer, uint32_t length);
 
     // Moves the cursor
@@ -0,0 +1,70 @@
+#ifndef FILE_TABLE_H
+#define FILE_TABLE_H
+
+#include <core/filesystem/File.h>
+#include <core/sync.h>
+#include <types.h>
+
+class FAT32;
+
+// Descriptors per process. 0-2 are the standard streams and never name a File.
+#define FD_MAX 32
+#define FD_FIRST_FILE 3
+
+#define FD_STDIN 0
+#define FD_STDOUT 1
+#define FD_STDERR 2
+
+// Longest path accepted by sys_open (File::name holds 128 bytes)
+#define FD_PATH_MAX 128
+
+// Results of the descriptor system calls (negative, Linux numbering)
+#define FD_ENOENT -2
+#define FD_EIO -5
+#define FD_EBADF -9
+#define FD_EFAULT -14
+#define FD_EISDIR -21
+#define FD_EINVAL -22
+#define FD_EMFILE -24
+#define FD_EROFS -30
+
+// sys_lseek origins
+#define FD_SEEK_SET 0
+#define FD_SEEK_CUR 1
+#define FD_SEEK_END 2
+
+/**
+ * @class FileTable
+ * @brief Open files of one process, indexed by descriptor.
+ *
+ * Created on the first sys_open and destroyed with the process. Each slot owns
+ * its File (and so its read position). The mutex is held across a whole
+ * operation, a disk read included, so another thread of the process cannot
+ * close a descriptor out from under a read in progress.
+ */
+class FileTable {
+    File* files[FD_MAX];
+    Mutex lock;
+
+    File* Get(int32_t fd) {
+        return (fd >= FD_FIRST_FILE && fd < FD_MAX) ? files[fd] : nullptr;
+    }
+
+public:
+    FileTable();
+    ~FileTable();  // Closes whatever is still open
+
+    // Returns the new descriptor, or FD_E*. sizeOut gets the file size.
+    int32_t Open(FAT32* fs, char* path, uint32_t& sizeOut);
+    // Reads from the current position. Returns bytes read (0 at EOF) or FD_E*.
+    int32_t Read(int32_t fd, uint8_t* buffer, uint32_t length);
+    // Returns the new position (clamped to the file size) or FD_E*
+    int32_t Seek(int32_t fd, int32_t offset, uint32_t whence);
+    int32_t Close(int32_t fd);
+
+    bool IsOpen(int32_t fd) {
+        return Get(fd) != nullptr;
+    }
+};
+
+#endif  // FILE_TABLE_H
@@ -0,0 +1,139 @@
+#ifndef SECTOR_CACHE_H
+#define SECTOR_CACHE_H
+
+#include <core/drivers/BlockDevice.h>
+#include <core/memory.h>
+#include <core/sync.h>
+#include <types.h>
+
+class Scheduler;
+
+#define SECTOR_CACHE_SECTOR_SIZE BLOCK_SECTOR_SIZE
+
+// Blocks per mounted FAT32 volume (128 KB)
+#define SECTOR_CACHE_DEFAULT_BLOCKS 256
+
+// Write-back order classes, see Write()
+#define SECTOR_CACHE_PASSES 2
+
+// Largest run of consecutive dirty sectors written back in one command (32 KB)
+#define SECTOR_CACHE_MAX_RUN 64
+
+// The flusher thread writes everything back this often, or once half the blocks are dirty
+#define SECTOR_CACHE_FLUSH_INTERVAL_MS 5000
+
+// Counters since mount, copied out by GetStats
+struct SectorCacheStats {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t bypassReads;  // ReadThrough misses, served from disk and not cached
+    uint32_t writebacks;   // Dirty blocks written to disk (eviction or Flush)
+    uint32_t writeRuns;    // Commands those went out in
+    uint32_t evictions;
+    uint32_t dirty;  // Blocks currently waiting for a write-back
+    uint32_t blocks;
+};
+
+/**
+ * @class SectorCache
+ * @brief Hashed LRU cache of 512-byte sectors in front of one block device.
+ *
+ * Blocks are found through a power-of-two hash of the LBA and kept on a single
+ * LRU list, most recently used at the head. Write() only dirties the cached
+ * copy; dirty blocks reach the disk on Flush(), from the flusher thread once
+ * Start() has run, or when the cache is full of them. Flush() writes them in
+ * pass order with a drive flush in between, ascending LBA within a pass, and
+ * coalesces consecutive sectors into one command. Eviction takes the least
+ * recently used clean block, so it never writes a block out of order. The
+ * *Through variants are for bulk file data: they use a cached copy when there
+ * is one but never pull new sectors in, so streaming a large file does not
+ * push the FAT and directory sectors out. One mutex covers the whole cache and
+ * is held across the disk I/O of a miss, but not across *Through transfers, so
+ * several of those can be queued at the device at once.
+ */
+class SectorCache {
+    struct Block {
+        uint32_t lba;
+        bool valid;
+        bool dirty;
+        uint8_t pass;  // Write-back order class while dirty
+        Block* hashNext;
+        Block* lruPrev;
+        Block* lruNext;
+        uint8_t* data;
+    };
+
+    BlockDevice* hd;
+    Block* blocks;
+    uint8_t* storage;
+    uint32_t blockCount;
+
+    Block** buckets;
+    uint32_t bucketMask;
+
+    Block* lruHead;  // Most recently used
+    Block* lruTail;  // Next victim
+
+    Block** order;     // Flush scratch: one pass's dirty blocks, sorted by LBA
+    uint8_t* staging;  // Flush scratch: SECTOR_CACHE_MAX_RUN sectors of a coalesced run
+
+    SectorCacheStats stats;
+    uint32_t generation;  // Bumped whenever sectors reach the disk (write-back or WriteThrough)
+    bool driveDirty;  // Sectors were written since the last drive CACHE FLUSH
+    Mutex lock;
+
+    Semaphore wake;  // Kicks the flusher before its interval is up
+    bool flusherStarted;
+
+    uint32_t Hash(uint32_t lba) {
+        return ((lba * 2654435761u) >> 8) & bucketMask;
+    }
+
+    Block* Lookup(uint32_t lba);
+    void HashInsert(Block* block);
+    void HashRemove(Block* block);
+    void Touch(Block* block);
+    Block* Claim(uint32_t lba);
+    void WriteRun(Block** run, uint32_t count);
+    void FlushLocked();
+    static void Flusher(void* arg);
+
+public:
+    SectorCache(BlockDevice* hd, uint32_t blocks = SECTOR_CACHE_DEFAULT_BLOCKS);
+    ~SectorCache();
+
+    // Start the background flusher thread. Until then dirty blocks wait for an
+    // explicit Flush() (or a full cache).
+    void Start(Scheduler* scheduler);
+    bool IsWriteBack() {
+        return flusherStarted;
+    }
+
+    // Cached metadata access. Blocks written with a lower 'pass' reach the disk
+    // before those of a higher one (below SECTOR_CACHE_PASSES). Read returns false
+    // on a device error, with 'out' zeroed and nothing cached. Both return false
+    // when the cache is full of dirty blocks the device will not take back.
+    bool Read(uint32_t lba, uint8_t* out);
+    bool Write(uint32_t lba, const uint8_t* data, uint32_t pass = 0);
+
+    // Uncached bulk data access of 1..GetMaxSectors() sectors in one device
+    // command, kept coherent with any cached copy. False on a device error, after
+    // which WriteThrough leaves the cached copies of the range dirty.
+    bool ReadThrough(uint32_t lba, uint32_t count, uint8_t* out);
+    bool WriteThrough(uint32_t lba, uint32_t count, const uint8_t* data);
+
+    // For reads issued straight to the device (readahead): take ReadGeneration()
+    // before submitting, then Reconcile() the data once it has arrived. False
+    // means the disk changed meanwhile and the range must be read again.
+    uint32_t ReadGeneration();
+    bool Reconcile(uint32_t lba, uint32_t count, uint8_t* data, uint32_t before);
+
+    // Write every dirty block back in pass order, then flush the drive's write cache
+    void Flush();
+    // Drop every block, writing back dirty ones first (those that fail are lost)
+    void Invalidate();
+
+    void GetStats(SectorCacheStats* out);
+};
+
+#endif  // SECTOR_CACHE_H
@@ -1,7 +1,7 @@
 #ifndef FILE_SYSTEM_MSDOS
 #define FILE_SYSTEM_MSDOS
 
-#include <core/drivers/ata.h>
+#include <core/drivers/BlockDevice.h>
 #include <core/filesystem/FAT32.h>
 #include <types.h>
 
@@ -32,17 +32,24 @@ struct MasterBootRecord {
 
 class MSDOSPartitionTable {
 public:
-    MSDOSPartitionTable(AdvancedTechnologyAttachment* ata);
+    MSDOSPartitionTable(BlockDevice* disk);
     ~MSDOSPartitionTable();
     void Initialize();
-    void ReadPartitions();
+    // Mounts the FAT32 partitions into the next free partitions[] slots.
+    // A disk without an MBR is partitioned and formatted only if initializeBlank.
+    void ReadPartitions(bool initializeBlank = true);
+    // Mounts a FAT32 volume starting at 'startLBA' into the next free slot (nullptr if full)
+    static FAT32* Mount(BlockDevice* disk, uint32_t startLBA);
+    // Hand every mounted volume's metadata write-back to its flusher thread
+    static void StartFlushers(Scheduler* scheduler);
+    // Write every mounted volume's cached changes to disk (sys_sync)
+    static void SyncAll();
     static FAT32* partitions[4];
     static MSDOSPartitionTable* activeInstance;
 
 private:
-    uint32_t ata_size;
-    AdvancedTechnologyAttachment* ata;
-    uint32_t partitionsCounter = 0;
+    BlockDevice* disk;
+    static uint32_t partitionsCounter;
 };
 
 #endif  // FILE_SYSTEM_MSDOS_H
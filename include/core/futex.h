@@ -0,0 +1,47 @@
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include <core/sync.h>
+#include <types.h>
+#include <utils/linkedList.h>
+
+#define FUTEX_HASH_BUCKETS 64
+
+// Results written back to user space by sys_futex_wait / sys_futex_wake
+#define FUTEX_OK 0        // Woken (wait) / number of threads woken (wake, >= 0)
+#define FUTEX_EAGAIN -11  // *addr != expected, did not sleep
+#define FUTEX_ETIMEDOUT -110
+#define FUTEX_EINVAL -22  // Bad / unaligned / unmapped address
+
+/**
+ * @class Futex
+ * @brief Kernel side of user-space fast mutexes.
+ *
+ * Waiters are keyed by the PHYSICAL address of the futex word, so two threads
+ * of one process (or two processes sharing a page) meet on the same queue.
+ * Queues are created on first use and freed when the last user leaves.
+ */
+class Futex {
+    struct FutexQueue {
+        uint32_t key;   // Physical address of the 32-bit word
+        uint32_t refs;  // Threads currently inside Wait/Wake on this key
+        WaitQueue queue;
+    };
+
+    static LinkedList<FutexQueue*> buckets[FUTEX_HASH_BUCKETS];
+    static Spinlock tableLock;
+
+    static bool Translate(uint32_t* directory, uint32_t userAddr, uint32_t& key);
+    static FutexQueue* Acquire(uint32_t key, bool create);
+    static void Release(FutexQueue* fq);
+
+public:
+    // Sleep while *userAddr == expected. timeoutMs of 0 means no timeout.
+    static int32_t Wait(uint32_t* directory, uint32_t userAddr, uint32_t expected,
+                        uint32_t timeoutMs);
+
+    // Wake up to 'count' waiters. Returns the number woken.
+    static int32_t Wake(uint32_t* directory, uint32_t userAddr, uint32_t count);
+};
+
+#endif  // FUTEX_H
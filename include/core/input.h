@@ -0,0 +1,101 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <core/process_types.h>
+#include <core/sync.h>
+#include <types.h>
+
+// Events buffered per process before the oldest are dropped
+#define INPUT_QUEUE_SIZE 128
+
+// Processes that can wait for input at once
+#define INPUT_MAX_QUEUES 16
+
+// Scancodes and mouse packets captured in IRQ context, waiting for the input softirq
+#define INPUT_RAW_SIZE 64
+
+enum InputEventType : uint8_t {
+    INPUT_KEY_DOWN = 1,    // code = scancode (make code, 0x00-0x7F)
+    INPUT_KEY_UP = 2,      // code = scancode of the released key
+    INPUT_MOUSE_MOVE = 3,  // dx/dy (screen Y grows downwards), merged while unread
+    INPUT_MOUSE_DOWN = 4,  // code = button (1 left, 2 right, 3 middle)
+    INPUT_MOUSE_UP = 5,
+};
+
+#define INPUT_FLAG_EXTENDED 0x1  // Key came with an 0xE0 prefix (arrows, right Ctrl/Alt...)
+
+// One event as copied out by sys_input_wait (mirrored in libhx86)
+struct InputEvent {
+    uint64_t tsc;  // Read in the IRQ handler
+    uint8_t type;  // InputEventType
+    uint8_t code;
+    uint8_t flags;
+    uint8_t buttons;  // Mouse button state after the event
+    int16_t dx;
+    int16_t dy;
+} __attribute__((packed));
+
+#define INPUT_EINVAL -22
+#define INPUT_EFAULT -14
+#define INPUT_EBUSY -16  // All INPUT_MAX_QUEUES are taken
+
+/**
+ * @class InputQueue
+ * @brief Per-process ring of keyboard and mouse events.
+ *
+ * The keyboard and mouse IRQ handlers only read the TSC and stash the raw
+ * scancode or packet. The input softirq turns those into events and pushes
+ * them, in arrival order, into the queue of every process that has called
+ * sys_input_wait. When a fullscreen app owns the GUI only its queue is fed.
+ * Readers sleep on the queue's WaitQueue until something arrives.
+ *
+ * The ring is protected by wait.lock. The table of queues only changes with
+ * interrupts off (system call context), which on one CPU keeps the softirq
+ * from seeing it half-updated.
+ */
+class InputQueue {
+    InputEvent events[INPUT_QUEUE_SIZE];
+    uint32_t head;  // Next event to read
+    uint32_t tail;  // Next free slot
+    uint32_t dropped;
+    uint32_t pid;
+    WaitQueue wait;
+
+    static InputQueue* queues[INPUT_MAX_QUEUES];
+
+    struct RawInput {
+        uint64_t tsc;
+        bool mouse;
+        uint8_t bytes[3];  // Scancode and extended flag, or the whole mouse packet
+    };
+    static RawInput raw[INPUT_RAW_SIZE];
+    static volatile uint32_t rawHead;  // Written by the IRQ handlers only
+    static volatile uint32_t rawTail;  // Written by the softirq only
+    static uint8_t mouseButtons;       // Button state after the last delivered packet
+
+    void Push(const InputEvent& event);
+    static void Deliver(const InputEvent& event);
+    static void Capture(bool mouse, uint8_t b0, uint8_t b1, uint8_t b2);
+    static void ProcessRaw(void* arg);
+    static void MouseEvent(uint64_t tsc, int32_t dx, int32_t dy, uint8_t newButtons);
+
+public:
+    InputQueue(uint32_t pid);
+
+    // Register the input softirq
+    static void Init();
+
+    // IRQ handlers: timestamp and queue for the input softirq
+    static void KeyEvent(uint8_t scancode, bool extended);
+    static void MousePacket(const uint8_t* packet);
+
+    // sys_input_wait: copy up to 'max' events, sleeping up to timeoutMs for the first one.
+    // Returns the count (0 on timeout), 'lost' gets the events dropped since the last call.
+    static int32_t Wait(ProcessControlBlock* process, InputEvent* out, uint32_t max,
+                        uint32_t timeoutMs, uint32_t& lost);
+
+    // Process teardown
+    static void Release(ProcessControlBlock* process);
+};
+
+#endif  // INPUT_H
@@ -8,6 +8,7 @@
 #include <core/paging.h>
 #include <core/ports.h>
 #include <core/scheduler.h>
+#include <core/spinlock.h>
 #include <core/timing.h>
 #include <debug.h>
 #include <gui/bmp.h>
@@ -78,7 +79,11 @@ public:
     static InterruptManager*
         activeInstance;  ///< Pointer to the currently active InterruptManager instance.
 protected:
+    static volatile uint32_t hwInterruptDepth;  ///< Nesting depth of hardware IRQ handlers.
+
     InterruptHandler* handlers[256];  ///< Array of interrupt handlers for each interrupt.
+    RWSpinlock handlersLock{"irq-table", LOCK_LEVEL_IRQ_TABLE};  ///< Read on dispatch, written on
+                                                                 ///< (un)registration.
     Scheduler* scheduler;
     Paging* pager;
     Bitmap* panicImg;
@@ -142,6 +147,7 @@ protected:
     static void HandleInterruptRequest0x0D();
     static void HandleInterruptRequest0x0E();
     static void HandleInterruptRequest0x0F();
+    static void HandleInterruptRequest0x10();  ///< Kernel yield (int 0x30).
     static void HandleInterruptRequest0x31();
 
     static void HandleInterruptRequest0x80();
@@ -227,6 +233,15 @@ public:
      */
     static uint32_t handleException(uint8_t interruptNumber, uint32_t esp);
 
+    /**
+     * @brief True while a hardware IRQ (0x20-0x2F) is being handled.
+     *
+     * Code running here must not sleep on a WaitQueue.
+     */
+    static bool InHardwareInterrupt() {
+        return hwInterruptDepth != 0;
+    }
+
     /**
      * @brief Handles an interrupt for this manager instance.
      *
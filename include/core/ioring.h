@@ -0,0 +1,72 @@
+#ifndef IORING_H
+#define IORING_H
+
+#include <core/process_types.h>
+#include <types.h>
+
+// Largest ring a process may register (SQ and CQ have the same size)
+#define IORING_MAX_ENTRIES 256
+
+// Set in an SQE opcode to run it through the Hgui (int 0x81) handler
+#define IORING_OP_HGUI 0x80000000
+
+// Results of sys_ring_setup / sys_ring_enter (mirrored in libhx86)
+#define IORING_EINVAL -22  // Bad size, alignment or unmapped ring memory
+#define IORING_EBUSY -16   // Another thread of the process is inside sys_ring_enter
+#define IORING_ENXIO -6    // No ring registered
+
+/*
+ * Shared ring layout, in the process's own memory:
+ *   [IORingHeader][IORingSQE x entries][IORingCQE x entries]
+ * Indices run freely and are masked with (entries - 1). User space owns sqTail
+ * and cqHead, the kernel owns sqHead and cqTail.
+ */
+struct IORingHeader {
+    volatile uint32_t sqHead;  // Next SQE the kernel will consume
+    volatile uint32_t sqTail;  // One past the last SQE queued by user space
+    volatile uint32_t cqHead;  // Next CQE user space will reap
+    volatile uint32_t cqTail;  // One past the last CQE posted by the kernel
+    uint32_t entries;          // Filled in by sys_ring_setup
+    uint32_t reserved[3];
+} __attribute__((packed));
+
+struct IORingSQE {
+    uint32_t opcode;    // System call number, | IORING_OP_HGUI for Hgui element calls
+    uint32_t args[3];   // EBX, ECX, ESI
+    uint32_t userData;  // Copied to the completion
+} __attribute__((packed));
+
+struct IORingCQE {
+    uint32_t userData;
+    int32_t result;  // EAX of the ABI v2 call
+    uint32_t extra0;
+    uint32_t extra1;
+} __attribute__((packed));
+
+#define IORING_BYTES(entries) \
+    (sizeof(IORingHeader) + (entries) * (sizeof(IORingSQE) + sizeof(IORingCQE)))
+
+/**
+ * @class IORing
+ * @brief Batched system calls through a submission/completion ring pair.
+ *
+ * A process registers one ring living in its own memory. sys_ring_enter then
+ * runs every queued SQE through the normal handlers (ABI v2) and posts a CQE
+ * for each, so a burst of widget or file calls costs one trap instead of one
+ * trap per call. Entries run in order in the caller's context: a sleep or a
+ * file read in the batch delays the ones behind it. Calls that end the thread
+ * or nest rings are rejected with SYSCALL_ENOSYS.
+ */
+class IORing {
+    static bool Validate(ProcessControlBlock* process, uint32_t addr, uint32_t entries);
+    static void Execute(const IORingSQE& sqe, IORingCQE& cqe);
+
+public:
+    static int32_t Setup(ProcessControlBlock* process, uint32_t addr, uint32_t entries);
+
+    // Consume up to 'toSubmit' SQEs (0 = all queued), stops early when the CQ is full.
+    // Returns the number consumed or an IORING_E* code.
+    static int32_t Enter(ProcessControlBlock* process, uint32_t toSubmit);
+};
+
+#endif  // IORING_H
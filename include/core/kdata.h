@@ -0,0 +1,84 @@
+#ifndef KDATA_H
+#define KDATA_H
+
+#include <types.h>
+
+// User address of the shared data page (the page after the exit trampoline)
+#define KDATA_USER_VIRT 0x40001000
+
+#define KDATA_MAGIC 0x4B444154  // "KDAT"
+#define KDATA_VERSION 1
+
+// Fixed-point shift of KernelDataPage::nsPerTscMult
+#define KDATA_NS_SHIFT 12
+
+/**
+ * Layout of the shared page (mirrored in libhx86 Hx86/kdata.h).
+ *
+ * Readers take 'sequence' before and after copying what they need and retry
+ * while it is odd or has changed. Only append fields, and bump KDATA_VERSION.
+ */
+struct KernelDataPage {
+    uint32_t magic;
+    uint32_t version;
+    volatile uint32_t sequence;  // Odd while the kernel is writing
+
+    // Clock (updated every PIT tick)
+    uint64_t timerTicks;  // Milliseconds since the PIT was started
+    uint64_t tscAtTick;   // TSC read at the last tick
+
+    // TSC calibration (updated every SCHED_STATS_WINDOW_MS, 0 until first measured)
+    uint32_t tscPerMs;
+    uint32_t nsPerTscMult;  // ns = (cycles * nsPerTscMult) >> KDATA_NS_SHIFT
+
+    // Screen geometry
+    uint32_t screenWidth;
+    uint32_t screenHeight;
+    uint32_t screenBpp;
+
+    // Global counters (updated with the calibration)
+    uint32_t contextSwitches;
+    uint32_t idlePermille;
+    uint32_t usedPages;
+    uint32_t totalPages;
+} __attribute__((packed));
+
+/**
+ * @class KernelData
+ * @brief One page of kernel state mapped read-only into every process.
+ *
+ * The timer, the scheduler and the display publish here so user programs can
+ * read the time, the TSC rate and the screen size without a system call.
+ * The kernel writes through the identity map, user space sees it at
+ * KDATA_USER_VIRT (mapped by Paging::CreateProcessDirectory).
+ */
+class KernelData {
+    static KernelDataPage* page;
+
+    static void BeginWrite() {
+        page->sequence++;
+        asm volatile("" ::: "memory");
+    }
+    static void EndWrite() {
+        asm volatile("" ::: "memory");
+        page->sequence++;
+    }
+
+public:
+    static void Init();
+
+    // Physical (= kernel) address of the page, 0 before Init
+    static uint32_t PhysicalAddress() {
+        return (uint32_t)page;
+    }
+
+    // Timer IRQ, after timerTicks was advanced
+    static void Tick();
+
+    // Scheduler statistics window
+    static void Calibrate(uint32_t tscPerMs, uint32_t contextSwitches, uint32_t idlePermille);
+
+    static void SetScreen(uint32_t width, uint32_t height, uint32_t bpp);
+};
+
+#endif  // KDATA_H
@@ -0,0 +1,61 @@
+#ifndef KSTACK_H
+#define KSTACK_H
+
+#include <core/paging.h>
+#include <core/spinlock.h>
+#include <types.h>
+
+// Kernel stack size classes. Softirqs and nested IRQ frames land on whatever
+// stack is current, so nothing goes below the default.
+enum KernelStackClass : uint8_t {
+    KSTACK_DEFAULT = 0,  // 32 KB: user threads (syscall path), kernel service threads
+    KSTACK_LARGE,        // 64 KB: desktop compositor and other deep kernel call chains
+    KSTACK_CLASS_COUNT
+};
+
+#define KSTACK_DEFAULT_SIZE (32 * 1024)
+#define KSTACK_LARGE_SIZE (64 * 1024)
+
+// Stacks mapped up front per class at boot
+#define KSTACK_DEFAULT_PREALLOC 8
+#define KSTACK_LARGE_PREALLOC 2
+
+// Stacks must stay in the identity-mapped kernel window
+#define KSTACK_PHYS_LIMIT (256 * 1024 * 1024)
+
+/**
+ * @class KernelStackPool
+ * @brief Fixed-size kernel stacks with an unmapped guard page below each one.
+ *
+ * Each slot is [guard page][stack pages] of contiguous low memory. The guard's
+ * PTE is cleared in the shared kernel page tables, so running off the bottom of
+ * a stack faults instead of silently overwriting the neighbour. Slots are never
+ * returned to the PMM: a freed stack goes back on its class's free list and the
+ * next thread of that class picks it up without touching the heap.
+ */
+class KernelStackPool {
+    struct FreeSlot {
+        FreeSlot* next;  // Stored in the (unused) stack memory itself
+    };
+
+    static FreeSlot* freeLists[KSTACK_CLASS_COUNT];
+    static uint32_t totalSlots[KSTACK_CLASS_COUNT];
+    static uint32_t freeSlots[KSTACK_CLASS_COUNT];
+    static Spinlock lock;
+    static Paging* pager;
+
+    static uint8_t* Grow(KernelStackClass cls);
+
+public:
+    static void Init(Paging* paging);
+
+    static uint32_t SizeOf(KernelStackClass cls) {
+        return cls == KSTACK_LARGE ? KSTACK_LARGE_SIZE : KSTACK_DEFAULT_SIZE;
+    }
+
+    // Returns the LOWEST usable address of the stack (top = base + SizeOf(cls))
+    static uint8_t* Allocate(KernelStackClass cls);
+    static void Free(uint8_t* base, KernelStackClass cls);
+};
+
+#endif  // KSTACK_H
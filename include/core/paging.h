@@ -15,6 +15,10 @@
 
 #define PAGE_SIZE 4096
 
+// User space window (programs link at 0x10001000, stacks end at 0xC0000000)
+#define USER_SPACE_START 0x10000000
+#define USER_SPACE_END 0xC0000000
+
 class Paging {
 public:
     Paging();
@@ -35,9 +39,20 @@ public:
     bool MapPage(uint32_t* directory, uint32_t virtual_addr, uint32_t physical_addr,
                  uint32_t flags);
 
+    // Clears the PTE so any access faults (the page table itself is kept)
+    void UnmapPage(uint32_t* directory, uint32_t virtual_addr);
+
     // 5. Query
     uint32_t GetPhysicalAddress(uint32_t* directory, uint32_t virtual_addr);
 
+    // [addr, addr + length) lies in user space and every page of it is mapped for
+    // user mode. System calls check this before the kernel reads a user buffer.
+    bool IsUserRangeMapped(uint32_t* directory, uint32_t addr, uint32_t length);
+    // As above, and writable by the process. CR0.WP is clear, so the kernel would
+    // write straight through read-only pages (the shared trampoline, KernelData):
+    // output buffers must pass this one.
+    bool IsUserRangeWritable(uint32_t* directory, uint32_t addr, uint32_t length);
+
     // The Master Directory (Template for all processes)
     uint32_t* KernelPageDirectory;  // Master Directory
 
@@ -47,6 +62,8 @@ public:
 
 private:
     bool is_paging_active;
+
+    bool CheckUserRange(uint32_t* directory, uint32_t addr, uint32_t length, uint32_t flags);
 };
 
 #endif
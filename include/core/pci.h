@@ -108,6 +108,10 @@ public:
     // Scans specifically for one hardware ID
     PeripheralComponentInterconnectDeviceDescriptor* FindHardwareDevice(uint16_t vendorID,
                                                                         uint16_t deviceID);
+
+    // Scans for the first device of a class/subclass (e.g. 01h/06h = SATA)
+    PeripheralComponentInterconnectDeviceDescriptor* FindClassDevice(uint8_t classID,
+                                                                     uint8_t subclassID);
 };
 
 #endif
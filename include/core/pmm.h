@@ -65,6 +65,11 @@ void pmm_free_block(void* p);
  */
 void* pmm_alloc_blocks(uint32_t size);
 
+/**
+ * request to allocate no of contiguous blocks entirely below limit_addr
+ */
+void* pmm_alloc_blocks_low(uint32_t size, uint32_t limit_addr);
+
 /**
  * free given requested no of blocks of memory from pmm
  */
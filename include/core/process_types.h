@@ -13,6 +13,11 @@ enum ThreadState {
     THREAD_STATE_TERMINATED
 };
 
+enum ThreadPriority {
+    THREAD_PRIORITY_NORMAL,    // Round robin
+    THREAD_PRIORITY_REALTIME,  // Runs ahead of normal threads as soon as it wakes
+};
+
 // --------------------------------------------------------------------------
 // CONTEXT (FIXED for pusha/iret)
 // --------------------------------------------------------------------------
@@ -32,8 +37,11 @@ struct CPUState {
     uint32_t fs;
     uint32_t gs;
 
-    // Interrupt Information
-    uint32_t error;
+    // Interrupt Information (system calls keep their ABI version here instead)
+    union {
+        uint32_t error;
+        uint32_t syscallAbi;
+    };
 
     // Return State
     uint32_t eip;
@@ -46,6 +54,10 @@ struct CPUState {
 class Process;  // Forward declaration
 
 struct ProcessControlBlock;  // Forward declaration
+class WaitQueue;             // Forward declaration
+class FileTable;             // Forward declaration
+struct SyscallStats;         // Forward declaration
+class InputQueue;            // Forward declaration
 
 struct HeapSegment {
     uint32_t startAddress;
@@ -57,11 +69,21 @@ struct ThreadControlBlock {
     uint32_t tid;
     uint32_t pid;
     ThreadState state;
+    ThreadPriority priority;
 
-    uint8_t* stack;
+    uint8_t* stack;  // Lowest address of the kernel stack (guard page right below)
+    uint32_t stackSize;
+    uint8_t stackClass;  // KernelStackClass
     CPUState* context;
     ProcessControlBlock* parent;
     uint32_t wakeTime;
+    WaitQueue* waitQueue;  // Queue this thread is sleeping on, if any
+
+    // CPU accounting (TSC cycles)
+    uint64_t cpuCycles;
+    uint64_t readySince;  // When the thread last entered the ready queue
+    uint32_t voluntarySwitches;
+    uint32_t involuntarySwitches;
 };
 
 struct ProcessControlBlock {
@@ -72,6 +94,21 @@ struct ProcessControlBlock {
     LinkedList<ThreadControlBlock*> threads;
     bool isKernelProcess;
     HeapSegment heap;
+    uint64_t cpuCycles;  // Sum over all threads, including exited ones
+
+    // Registered system call ring (core/ioring.cpp), 0 if none
+    uint32_t ringAddr;
+    uint32_t ringEntries;
+    volatile bool ringBusy;
+
+    // Open file descriptors, created by the first sys_open
+    FileTable* files;
+
+    // Per-call counters and latency (core/systrace.cpp), created by the first system call
+    SyscallStats* syscallStats;
+
+    // Keyboard/mouse events (core/input.cpp), created by the first sys_input_wait
+    InputQueue* inputQueue;
 };
 
 #endif  // PROCESS_TYPES_H
@@ -4,11 +4,61 @@
 #include <core/Iguard.h>
 #include <core/gdt.h>
 #include <core/globals.h>
+#include <core/kstack.h>
 #include <core/memory.h>
 #include <core/paging.h>
 #include <core/process_types.h>
+#include <core/spinlock.h>
+#include <core/sync.h>
+#include <core/timing.h>
 #include <core/tss.h>
 
+// Run-queue wait histogram: bucket i counts waits below 2^(i + SCHED_LATENCY_SHIFT) cycles,
+// the last bucket takes everything longer.
+#define SCHED_LATENCY_BUCKETS 16
+#define SCHED_LATENCY_SHIFT 12
+
+// Window (in timer ticks) for the idle percentage and TSC calibration
+#define SCHED_STATS_WINDOW_MS 1000
+
+// sys_sched_stats copies out at most this many thread entries
+#define SCHED_STATS_MAX_THREADS 256
+#define SCHED_STATS_EFAULT -14  // Output buffer is not writable user memory
+
+// Results of JoinThread, written back by sys_thread_join
+#define THREAD_JOIN_OK 0
+#define THREAD_JOIN_ESRCH -3     // No such thread in the caller's process (or already joined)
+#define THREAD_JOIN_EDEADLK -35  // A thread cannot join itself
+#define THREAD_JOIN_EFAULT -14   // Status pointer is not writable user memory
+
+// Exit status of a user thread that has not been joined yet
+struct ThreadExitRecord {
+    uint32_t tid;  // 0 = none (tid 0 is the idle thread)
+    uint32_t pid;
+    int32_t exitCode;
+};
+
+// Snapshot layouts copied out by sys_sched_stats (mirrored in libhx86)
+struct SchedStatsInfo {
+    uint64_t totalCycles;  // Cycles accounted to threads (and idle) since boot
+    uint64_t idleCycles;
+    uint32_t idlePermille;  // Idle share of the last window, 0..1000
+    uint32_t tscPerMs;      // TSC rate measured against the PIT, 0 until calibrated
+    uint32_t contextSwitches;
+    uint32_t threadCount;  // Live threads, may be more than were copied out
+    uint32_t runQueueLatency[SCHED_LATENCY_BUCKETS];
+} __attribute__((packed));
+
+struct ThreadStatsInfo {
+    uint32_t tid;
+    uint32_t pid;
+    uint32_t state;
+    uint32_t voluntarySwitches;
+    uint32_t involuntarySwitches;
+    uint64_t cpuCycles;
+    uint64_t processCycles;  // Whole owning process, 0 for kernel threads without one
+} __attribute__((packed));
+
 class Scheduler {
 private:
     LinkedList<ProcessControlBlock*> globalProcessList;
@@ -22,6 +72,42 @@ private:
     Paging* _pager;
     uint32_t _trampolinePhys;  // Physical page holding user-mode exit trampoline code
 
+    // Protects the state queues, globalProcessList and the id counters.
+    // Allocation and page mapping are done outside of it.
+    Spinlock lock{"scheduler", LOCK_LEVEL_SCHED};
+
+    // CPU accounting, all under 'lock'
+    uint64_t lastSwitchTsc;
+    uint64_t totalCycles;
+    uint64_t idleCycles;
+    uint32_t contextSwitches;
+    uint32_t runQueueLatency[SCHED_LATENCY_BUCKETS];
+    uint64_t windowStartTsc;
+    uint64_t windowStartIdle;
+    uint32_t windowStartTick;
+    uint32_t idlePermille;
+    uint32_t tscPerMs;
+
+    // A realtime thread was woken and should run at the next IRQ exit
+    volatile bool preemptPending;
+
+    // Kernel stack of a thread that terminated itself, freed after two switches
+    uint8_t* dyingStack;
+    KernelStackClass dyingStackClass;
+    uint8_t* retiredStack;
+    KernelStackClass retiredStackClass;
+
+    // Exited user threads waiting to be joined, under joinWait.lock.
+    // Joiners sleep on joinWait and recheck after every thread exit.
+    LinkedList<ThreadExitRecord> exitRecords;
+    WaitQueue joinWait;
+
+    bool IsLiveThread(ProcessControlBlock* process, uint32_t tid);
+
+    void MakeReady(ThreadControlBlock* thread, uint64_t now);
+    void AccountSwitch(ThreadControlBlock* next, uint64_t now, bool voluntary);
+    void RetireDyingStack();
+
 public:
     static Scheduler* activeInstance;
     ThreadControlBlock* currentThread;
@@ -30,20 +116,38 @@ public:
     Scheduler(Paging* pager);
 
     // CREATION & MANAGEMENT
-    ProcessControlBlock* CreateProcess(bool isKernel, void (*entrypoint)(void*), void* arg);
+    ProcessControlBlock* CreateProcess(bool isKernel, void (*entrypoint)(void*), void* arg,
+                                       KernelStackClass stackClass = KSTACK_DEFAULT);
     ThreadControlBlock* CreateThread(ProcessControlBlock* parent, void (*entrypoint)(void*),
-                                     void* arg);
+                                     void* arg, KernelStackClass stackClass = KSTACK_DEFAULT);
 
     bool KillProcess(uint32_t pid);
+    ProcessControlBlock* FindProcess(uint32_t pid);
     void TerminateThread(ThreadControlBlock* thread);
-    bool ExitCurrentThread();
+    bool ExitCurrentThread(int32_t exitCode = 0);
+    // Sleep until thread 'tid' of the current process exits, returns a THREAD_JOIN_* code
+    int32_t JoinThread(uint32_t tid, int32_t* exitCode);
     void Sleep(uint32_t milliseconds);
     void WakeThread(ThreadControlBlock* thread);
+    void SetPriority(ThreadControlBlock* thread, ThreadPriority priority);
+
+    // BLOCKING (used by WaitQueue)
+    bool CanBlock();
+    void BlockCurrent(uint32_t timeoutMs);
+    void Yield();
 
     // CORE SCHEDULING (Called by Interrupt Handler)
-    CPUState* Schedule(CPUState* context);
+    // 'voluntary' is set when the thread gave up the CPU itself (yield / block)
+    CPUState* Schedule(CPUState* context, bool voluntary = false);
+
+    // STATISTICS: fills 'info' and up to 'maxThreads' entries, returns entries written.
+    // Both must be kernel memory: they are written with the scheduler lock held.
+    uint32_t GetStats(SchedStatsInfo* info, ThreadStatsInfo* threads, uint32_t maxThreads);
 
     // Helpers
+    bool PreemptPending() {
+        return preemptPending;
+    }
     ThreadControlBlock* GetCurrentThread() {
         return currentThread;
     }
@@ -0,0 +1,80 @@
+#ifndef SOFTIRQ_H
+#define SOFTIRQ_H
+
+#include <core/sync.h>
+#include <types.h>
+
+class Scheduler;
+
+// Bottom-half vectors, lower numbers run first
+enum SoftIRQVector {
+    SOFTIRQ_KEYBOARD = 0,  // Scancode decoding and key events to the GUI
+    SOFTIRQ_MOUSE,         // Mouse packets to the GUI (widget tree walk)
+    SOFTIRQ_INPUT,         // Timestamped events to the sys_input_wait queues
+    SOFTIRQ_COUNT
+};
+
+// Passes over the pending mask at IRQ exit before the rest is left to the worker
+#define SOFTIRQ_MAX_RESTART 4
+
+// Deferred work items waiting for the worker thread
+#define WORKQUEUE_SIZE 64
+
+typedef void (*DeferredFunc)(void* arg);
+
+/**
+ * @class SoftIRQ
+ * @brief Deferred work ("bottom halves") for interrupt handlers.
+ *
+ * A hardware IRQ handler only acknowledges its device, stashes what it read
+ * and calls Raise(). Pending vectors are run when the outermost hardware IRQ
+ * is about to return, with interrupts enabled again and before any context
+ * switch. While they run the timer does not preempt, so a handler sees the
+ * same "nobody else runs" guarantee it had in IRQ context, but other devices
+ * can still interrupt it.
+ *
+ * Vectors left over after SOFTIRQ_MAX_RESTART passes, and any work queued
+ * with QueueWork(), are run by the kernel worker thread. Vector handlers must
+ * not sleep; work items may.
+ *
+ * There is one CPU, so the pending mask is a single word.
+ */
+class SoftIRQ {
+    struct Action {
+        DeferredFunc func;
+        void* arg;
+    };
+
+    static Action actions[SOFTIRQ_COUNT];
+    static volatile uint32_t pending;
+    static volatile bool running;
+
+    // Work queue ring, protected by workerWait.lock
+    static Action work[WORKQUEUE_SIZE];
+    static uint32_t workHead;
+    static uint32_t workTail;
+    static WaitQueue workerWait;
+    static bool workerStarted;
+
+    static void Worker(void* arg);
+
+public:
+    static void Register(SoftIRQVector vector, DeferredFunc func, void* arg);
+
+    // Mark a vector pending. Safe from any context.
+    static void Raise(SoftIRQVector vector);
+
+    // Run pending vectors. Called on hardware IRQ exit and by the worker.
+    static void RunPending();
+
+    static bool InProgress() {
+        return running;
+    }
+
+    // Run func(arg) later in the worker thread. Returns false if the queue is full.
+    static bool QueueWork(DeferredFunc func, void* arg);
+
+    static void StartWorker(Scheduler* scheduler);
+};
+
+#endif  // SOFTIRQ_H
@@ -0,0 +1,195 @@
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include <types.h>
+
+/**
+ * Lock ordering levels.
+ * A lock may only be taken while every lock already held has a LOWER level,
+ * so nesting always goes
+ * GUI -> FUTEX -> WAITQ -> SCHED -> KSTACK -> IRQ_TABLE -> TRACE -> HEAP -> LOG.
+ * Each level is owned by exactly one lock (or one class of lock).
+ */
+enum LockLevel : uint8_t {
+    LOCK_LEVEL_NONE = 0,       // Not checked
+    LOCK_LEVEL_GUI = 1,        // Desktop scene (Draw / window removal)
+    LOCK_LEVEL_FUTEX = 2,      // Futex hash table
+    LOCK_LEVEL_WAITQ = 3,      // Any WaitQueue (never nest two of them)
+    LOCK_LEVEL_SCHED = 4,      // Scheduler queues and process list
+    LOCK_LEVEL_KSTACK = 5,     // Kernel stack pool free lists
+    LOCK_LEVEL_IRQ_TABLE = 6,  // Interrupt handler table
+    LOCK_LEVEL_TRACE = 7,      // System call trace ring
+    LOCK_LEVEL_HEAP = 8,       // Kernel heap block list
+    LOCK_LEVEL_LOG = 9,        // Serial ring buffer (innermost, printf can be called anywhere)
+};
+
+// Lock-order bookkeeping (core/spinlock.cpp). Only active in KDBG builds.
+void LockOrderAcquire(uint8_t level, const char* name);
+void LockOrderRelease(uint8_t level);
+bool LockOrderAnyHeld();  // Always false outside KDBG builds
+
+// Save EFLAGS and disable interrupts. Returns the previous EFLAGS.
+static inline uint32_t IrqSave() {
+    uint32_t eflags;
+    asm volatile(
+        "pushf\n\t"
+        "pop %0\n\t"
+        "cli"
+        : "=r"(eflags)
+        :
+        : "memory");
+    return eflags;
+}
+
+// Re-enable interrupts only if they were enabled when IrqSave() was called.
+static inline void IrqRestore(uint32_t eflags) {
+    if (eflags & 0x200) asm volatile("sti" ::: "memory");
+}
+
+static inline void CpuRelax() {
+    asm volatile("pause" ::: "memory");
+}
+
+/**
+ * @class Spinlock
+ * @brief IRQ-safe FIFO ticket lock.
+ *
+ * Lock() disables interrupts on the local CPU before spinning, so the same lock
+ * can be shared between thread context and IRQ handlers without deadlocking.
+ * Not recursive.
+ */
+class Spinlock {
+    volatile uint16_t nextTicket;
+    volatile uint16_t nowServing;
+    uint8_t level;
+    const char* name;
+
+public:
+    constexpr Spinlock(const char* name, uint8_t level = LOCK_LEVEL_NONE)
+        : nextTicket(0), nowServing(0), level(level), name(name) {}
+
+    uint32_t Lock() {
+        uint32_t flags = IrqSave();
+        LockOrderAcquire(level, name);
+        uint16_t ticket = __atomic_fetch_add(&nextTicket, 1, __ATOMIC_RELAXED);
+        while (__atomic_load_n(&nowServing, __ATOMIC_ACQUIRE) != ticket) CpuRelax();
+        return flags;
+    }
+
+    void Unlock(uint32_t flags) {
+        __atomic_store_n(&nowServing, (uint16_t)(nowServing + 1), __ATOMIC_RELEASE);
+        LockOrderRelease(level);
+        IrqRestore(flags);
+    }
+
+    bool IsLocked() const {
+        return __atomic_load_n(&nowServing, __ATOMIC_RELAXED) !=
+               __atomic_load_n(&nextTicket, __ATOMIC_RELAXED);
+    }
+
+    const char* GetName() const {
+        return name;
+    }
+};
+
+/**
+ * @class RWSpinlock
+ * @brief IRQ-safe reader/writer spinlock (writer preferring).
+ *
+ * Any number of readers may hold the lock at once. A waiting writer sets the
+ * WRITER bit first, which stops new readers from entering, then waits for the
+ * active readers to drain.
+ */
+class RWSpinlock {
+    static const uint32_t WRITER = 0x80000000;
+    volatile uint32_t state;  // WRITER bit | reader count
+    uint8_t level;
+    const char* name;
+
+public:
+    constexpr RWSpinlock(const char* name, uint8_t level = LOCK_LEVEL_NONE)
+        : state(0), level(level), name(name) {}
+
+    uint32_t ReadLock() {
+        uint32_t flags = IrqSave();
+        LockOrderAcquire(level, name);
+        while (1) {
+            uint32_t s = __atomic_load_n(&state, __ATOMIC_RELAXED);
+            if (!(s & WRITER) && __atomic_compare_exchange_n(&state, &s, s + 1, false,
+                                                             __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+                break;
+            CpuRelax();
+        }
+        return flags;
+    }
+
+    void ReadUnlock(uint32_t flags) {
+        __atomic_fetch_sub(&state, 1, __ATOMIC_RELEASE);
+        LockOrderRelease(level);
+        IrqRestore(flags);
+    }
+
+    uint32_t WriteLock() {
+        uint32_t flags = IrqSave();
+        LockOrderAcquire(level, name);
+        // 1. Claim the writer bit (blocks new readers)
+        while (1) {
+            uint32_t s = __atomic_load_n(&state, __ATOMIC_RELAXED);
+            if (!(s & WRITER) && __atomic_compare_exchange_n(&state, &s, s | WRITER, false,
+                                                             __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+                break;
+            CpuRelax();
+        }
+        // 2. Wait for the readers already inside to leave
+        while (__atomic_load_n(&state, __ATOMIC_ACQUIRE) != WRITER) CpuRelax();
+        return flags;
+    }
+
+    void WriteUnlock(uint32_t flags) {
+        __atomic_store_n(&state, 0, __ATOMIC_RELEASE);
+        LockOrderRelease(level);
+        IrqRestore(flags);
+    }
+};
+
+// RAII helpers, used like InterruptGuard
+class SpinlockGuard {
+    Spinlock& lock;
+    uint32_t flags;
+
+public:
+    SpinlockGuard(Spinlock& l) : lock(l) {
+        flags = lock.Lock();
+    }
+    ~SpinlockGuard() {
+        lock.Unlock(flags);
+    }
+};
+
+class ReadGuard {
+    RWSpinlock& lock;
+    uint32_t flags;
+
+public:
+    ReadGuard(RWSpinlock& l) : lock(l) {
+        flags = lock.ReadLock();
+    }
+    ~ReadGuard() {
+        lock.ReadUnlock(flags);
+    }
+};
+
+class WriteGuard {
+    RWSpinlock& lock;
+    uint32_t flags;
+
+public:
+    WriteGuard(RWSpinlock& l) : lock(l) {
+        flags = lock.WriteLock();
+    }
+    ~WriteGuard() {
+        lock.WriteUnlock(flags);
+    }
+};
+
+#endif  // SPINLOCK_H
@@ -0,0 +1,134 @@
+#ifndef SYNC_H
+#define SYNC_H
+
+#include <core/process_types.h>
+#include <core/spinlock.h>
+#include <types.h>
+#include <utils/linkedList.h>
+
+// Timeout value meaning "until woken"
+#define WAIT_FOREVER 0xFFFFFFFF
+
+/**
+ * @class WaitQueue
+ * @brief A list of threads sleeping until some condition is signalled.
+ *
+ * Waiters are BLOCKED in the scheduler and take no CPU until WakeOne/WakeAll
+ * (or their timeout) makes them READY again. Wake* may be called from IRQ
+ * handlers. If the caller cannot block (boot code, IRQ context, idle thread),
+ * Wait returns false immediately and the caller is expected to poll.
+ */
+class WaitQueue {
+    LinkedList<ThreadControlBlock*> waiters;
+
+public:
+    Spinlock lock;
+
+    WaitQueue() : lock("waitqueue", LOCK_LEVEL_WAITQ) {}
+
+    /**
+     * @brief Sleep until woken or timed out.
+     * @return true if woken by WakeOne/WakeAll, false on timeout or if blocking is not possible.
+     */
+    bool Wait(uint32_t timeoutMs = WAIT_FOREVER);
+
+    /**
+     * @brief Same as Wait, but the caller already holds 'lock' (flags from lock.Lock()).
+     *
+     * Lets a caller test its condition and queue itself atomically. The lock is
+     * always released on return.
+     */
+    bool SleepLocked(uint32_t flags, uint32_t timeoutMs = WAIT_FOREVER);
+
+    void WakeOne();
+    void WakeAll();
+
+    // Variants for callers that hold 'lock'
+    bool WakeOneLocked();
+    uint32_t WakeAllLocked();
+
+    // Drop a thread that is being torn down (called by the scheduler)
+    void Remove(ThreadControlBlock* thread);
+
+    bool HasWaiters() const {
+        return !waiters.IsEmpty();
+    }
+};
+
+/**
+ * @class Mutex
+ * @brief Sleeping lock. Contended lockers block instead of spinning.
+ *
+ * Must not be taken from IRQ context or while holding a Spinlock.
+ */
+class Mutex {
+    WaitQueue queue;
+    volatile bool locked;
+    ThreadControlBlock* owner;
+
+public:
+    Mutex() : locked(false), owner(nullptr) {}
+
+    void Lock();
+    bool TryLock();
+    void Unlock();
+
+    bool IsLocked() const {
+        return locked;
+    }
+};
+
+class MutexGuard {
+    Mutex& mutex;
+
+public:
+    MutexGuard(Mutex& m) : mutex(m) {
+        mutex.Lock();
+    }
+    ~MutexGuard() {
+        mutex.Unlock();
+    }
+};
+
+/**
+ * @class Semaphore
+ * @brief Counting semaphore. Signal() is safe from IRQ handlers.
+ */
+class Semaphore {
+    WaitQueue queue;
+    volatile int32_t count;
+
+public:
+    Semaphore(int32_t initial = 0) : count(initial) {}
+
+    // Decrement, sleeping while the count is zero. Returns false on timeout.
+    bool Wait(uint32_t timeoutMs = WAIT_FOREVER);
+    bool TryWait();
+    void Signal();
+
+    int32_t GetCount() const {
+        return count;
+    }
+};
+
+/**
+ * @class CondVar
+ * @brief Condition variable used together with a Mutex.
+ *
+ * A sequence number closes the window between releasing the mutex and
+ * queueing on the condition, so a Signal in that window is not lost.
+ */
+class CondVar {
+    WaitQueue queue;
+    volatile uint32_t sequence;
+
+public:
+    CondVar() : sequence(0) {}
+
+    // Atomically release 'mutex' and sleep, re-acquire before returning.
+    bool Wait(Mutex& mutex, uint32_t timeoutMs = WAIT_FOREVER);
+    void Signal();
+    void Broadcast();
+};
+
+#endif  // SYNC_H
@@ -19,7 +19,18 @@ typedef enum {
     sys_sleep = 7,
     sys_sbrk = 8,
     sys_peek_memory = 9,
+    sys_lseek = 19,
+    sys_sync = 36,
     sys_clone = 41,
+    sys_futex_wait = 42,
+    sys_futex_wake = 43,
+    sys_sched_stats = 44,
+    sys_yield = 45,
+    sys_thread_join = 46,
+    sys_ring_setup = 47,
+    sys_ring_enter = 48,
+    sys_trace = 49,
+    sys_input_wait = 50,
     sys_Hcall = 199,
     sys_debug = 200,
 } SYSCALL;
@@ -32,6 +43,27 @@ typedef enum {
     Hsys_readFile = 4
 } HSYSCALL;
 
+// System call ABI version, bits 24-30 of EAX (bit 31 is SYSENTER_HGUI)
+//   V1: the result is written to the int32_t that EDX points to (older binaries)
+//   V2: the result comes back in EAX, up to two extra values in EDX and ECX
+//       (EBX and ESI on the SYSENTER path, where SYSEXIT needs EDX/ECX)
+#define SYSCALL_ABI_SHIFT 24
+#define SYSCALL_ABI_MASK 0x7F000000
+#define SYSCALL_NUMBER_MASK 0x00FFFFFF
+#define SYSCALL_ABI_V1 0
+#define SYSCALL_ABI_V2 1
+#define SYSCALL_ABI_RETURNED 0x80000000  // Set in CPUState::syscallAbi once a result is out
+
+#define SYSCALL_ENOSYS -38  // Unknown call number or ABI version
+
+// SYSENTER path: set in EAX to reach the Hgui (int 0x81) handler instead of int 0x80
+#define SYSENTER_HGUI 0x80000000
+
+// SYSENTER MSRs
+#define MSR_SYSENTER_CS 0x174
+#define MSR_SYSENTER_ESP 0x175
+#define MSR_SYSENTER_EIP 0x176
+
 struct multi_para_model {
     uint32_t param0;
     uint32_t param1;
@@ -46,14 +78,42 @@ public:
     ~SyscallHandler();
 
     virtual uint32_t HandleInterrupt(uint32_t esp);
+
+    // Program the SYSENTER MSRs if the CPU has them. int 0x80 keeps working either way.
+    static bool EnableSysenter();
+
+    // Called from the SYSENTER entry stub (asm/common_handler.asm) with a CPUState frame
+    static uint32_t HandleSysenter(uint32_t esp);
 };
 
 class SyscallHandlers {
 public:
+    // Strip the ABI version off EAX. Fails the call and returns false for an unknown version.
+    static bool BeginCall(CPUState* cpu, uint32_t& number);
+    // V2 calls that produced no result return 0
+    static void EndCall(CPUState* cpu);
+    // Hand a result back in the form the caller's ABI expects
+    static void Return(CPUState* cpu, int32_t value, uint32_t extra0 = 0, uint32_t extra1 = 0);
+
     static void Handle_sys_restart(uint32_t esp);
     static void Handle_sys_exit(uint32_t esp);
     static void Handle_sys_clone(uint32_t esp);
     static void Handle_sys_sleep(uint32_t esp);
+    static void Handle_sys_open(uint32_t esp);
+    static void Handle_sys_read(uint32_t esp);
+    static void Handle_sys_write(uint32_t esp);
+    static void Handle_sys_lseek(uint32_t esp);
+    static void Handle_sys_close(uint32_t esp);
+    static void Handle_sys_sync(uint32_t esp);
+    static void Handle_sys_futex_wait(uint32_t esp);
+    static void Handle_sys_futex_wake(uint32_t esp);
+    static void Handle_sys_sched_stats(uint32_t esp);
+    static void Handle_sys_yield(uint32_t esp);
+    static void Handle_sys_thread_join(uint32_t esp);
+    static void Handle_sys_ring_setup(uint32_t esp);
+    static void Handle_sys_ring_enter(uint32_t esp);
+    static void Handle_sys_trace(uint32_t esp);
+    static void Handle_sys_input_wait(uint32_t esp);
     static void Handle_sys_sbrk(uint32_t esp);
     static void Handle_sys_debug(uint32_t esp);
     static void Handle_sys_peek_memory(uint32_t esp);
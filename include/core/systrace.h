@@ -0,0 +1,132 @@
+#ifndef SYSTRACE_H
+#define SYSTRACE_H
+
+#include <core/process_types.h>
+#include <core/spinlock.h>
+#include <types.h>
+
+// Hgui (int 0x81) calls are keyed by element number with this bit set
+#define SYSTRACE_HGUI 0x80000000
+
+// Distinct calls counted per process (open addressing, further calls are only counted as dropped)
+#define SYSTRACE_STAT_SLOTS 64
+
+// Trace records kept until drained, the oldest are overwritten
+#define SYSTRACE_RING_SIZE 512
+
+// Longest program name taken from the "systrace=" boot option
+#define SYSTRACE_APP_MAX 32
+
+// sys_trace operations (EBX)
+#define SYSTRACE_OP_FILTER 0  // ECX = pid to trace, ESI = SYSTRACE_TO_* flags (0 = stop)
+#define SYSTRACE_OP_DRAIN 1   // ECX = SyscallTraceEntry[], ESI = capacity. extra0 = records lost
+#define SYSTRACE_OP_STATS 2   // ECX = pid, ESI = SyscallStatEntry[SYSTRACE_STAT_SLOTS]
+#define SYSTRACE_OP_RESET 3   // ECX = pid, clears its counters
+
+// Trace filter pids
+#define SYSTRACE_PID_NONE 0xFFFFFFFF
+#define SYSTRACE_PID_ALL 0xFFFFFFFE
+#define SYSTRACE_PID_SELF 0xFFFFFFFD
+
+// FILTER, STATS and RESET act on the caller's own pid unless it is a kernel process, and
+// DRAIN only returns the caller's own records. Other programs are traced from boot with
+// "systrace=<name>" on the kernel command line (see SyscallTrace::Configure).
+
+// Where traced calls go
+#define SYSTRACE_TO_RING 0x1    // Trace ring, drained with SYSTRACE_OP_DRAIN
+#define SYSTRACE_TO_SERIAL 0x2  // One "strace:" line per call on the serial log
+
+#define SYSTRACE_EPERM -1
+#define SYSTRACE_EINVAL -22
+#define SYSTRACE_ESRCH -3
+#define SYSTRACE_EFAULT -14
+
+// Per-call counters (layout mirrored in libhx86)
+struct SyscallStatEntry {
+    uint32_t call;  // 0x80 number, or element | SYSTRACE_HGUI
+    uint32_t count;
+    uint64_t totalCycles;
+    uint32_t maxCycles;
+} __attribute__((packed));
+
+// One traced call (layout mirrored in libhx86)
+struct SyscallTraceEntry {
+    uint64_t tsc;  // Entry time
+    uint32_t pid;
+    uint32_t tid;
+    uint32_t call;
+    uint32_t args[3];  // EBX, ECX, ESI on entry
+    int32_t result;
+    uint32_t cycles;
+} __attribute__((packed));
+
+struct SyscallStats {
+    SyscallStatEntry slots[SYSTRACE_STAT_SLOTS];
+    uint32_t dropped;  // Calls that found no free slot
+};
+
+/**
+ * @class SyscallTrace
+ * @brief strace-style accounting for system calls.
+ *
+ * Every call is timed with the TSC and counted in its process's SyscallStats
+ * (count, total and max cycles per call number), allocated on the first call.
+ * Calls of the process selected with SYSTRACE_OP_FILTER, or launched under
+ * the name given with "systrace=", are also recorded, with arguments and
+ * result, in a global ring and/or on the serial log.
+ *
+ * A process's counters are only touched by its own threads from system call
+ * context (interrupts off, one CPU), so they need no lock. The ring does.
+ */
+class SyscallTrace {
+    static SyscallTraceEntry ring[SYSTRACE_RING_SIZE];
+    static uint32_t ringHead;  // Next record to drain
+    static uint32_t ringTail;  // Next free slot
+    static uint32_t lost;      // Overwritten before they were drained
+    static volatile uint32_t tracePid;
+    static volatile uint32_t traceFlags;
+    static Spinlock lock;
+    static char bootApp[SYSTRACE_APP_MAX];  // "systrace=" boot option, empty if none
+
+    static SyscallStatEntry* Slot(SyscallStats* stats, uint32_t call);
+
+public:
+    // Called when a traced call returns
+    static void Record(ThreadControlBlock* thread, uint32_t call, const uint32_t* args,
+                       int32_t result, uint64_t start, uint32_t cycles);
+
+    // sys_trace
+    static int32_t Control(ProcessControlBlock* caller, uint32_t op, uint32_t arg0, uint32_t arg1,
+                           uint32_t& extra);
+
+    // Kernel command line. "systrace=<name>" traces every program launched from a path
+    // containing <name> to the serial log, with a counter summary when it exits.
+    static void Configure(const char* cmdline);
+
+    // A program was just loaded from 'path'
+    static void Launched(ProcessControlBlock* process, const char* path);
+
+    // Process teardown: log a summary if the process was being traced, free the counters
+    static void ReleaseProcess(ProcessControlBlock* process);
+};
+
+/**
+ * @class SyscallTraceScope
+ * @brief Times one system call, from dispatch until the dispatcher returns.
+ *
+ * Declared right after SyscallHandlers::BeginCall so its destructor runs after
+ * EndCall and sees the final result.
+ */
+class SyscallTraceScope {
+    CPUState* cpu;
+    ThreadControlBlock* thread;
+    uint32_t call;
+    uint32_t args[3];
+    uint64_t start;
+
+public:
+    SyscallTraceScope(CPUState* cpu, uint32_t number, bool hgui);
+    ~SyscallTraceScope();
+};
+
+#endif  // SYSTRACE_H
@@ -11,6 +11,13 @@ void static wait(uint32_t milliseconds) {
     }
 }
 
+// CPU timestamp counter (cycles since reset)
+static inline uint64_t ReadTSC() {
+    uint32_t lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
 // GMT/UTC Timezone Offsets (in hours)
 // Offset is added to UTC.
 // Negative values = behind UTC, Positive = ahead of UTC.
@@ -4,6 +4,8 @@
 #include <core/drivers/GraphicsDriver.h>
 #include <core/drivers/keyboard.h>
 #include <core/drivers/mouse.h>
+#include <core/spinlock.h>
+#include <core/sync.h>
 #include <gui/bmp.h>
 #include <gui/taskbar.h>
 #include <gui/widget.h>
@@ -31,6 +33,13 @@ protected:
     LinkedList<EventHandler*> HguiEventHandlers;
     Taskbar* taskbar;
 
+    // Held while compositing and while windows are torn down, so a dying app
+    // cannot free a window the renderer is walking.
+    Spinlock sceneLock{"desktop", LOCK_LEVEL_GUI};
+
+    // The render thread sleeps here while nothing is dirty
+    WaitQueue redrawWait;
+
 public:
     static Desktop* activeInstance;
 
@@ -44,6 +53,10 @@ public:
     // The Master Draw function
     void Draw(GraphicsDriver* gc) override;
 
+    void MarkDirty() override;
+    // Block until a redraw is needed or timeoutMs passes
+    void WaitForRedraw(uint32_t timeoutMs);
+
     uint32_t getNewID();
     void RemoveAppByPID(uint32_t PID);
     void GetFocus(Widget* widget) override;
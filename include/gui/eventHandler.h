@@ -2,6 +2,7 @@
 #define EVENT_HANDLER_H
 
 #include <core/process_types.h>
+#include <core/sync.h>
 #include <utils/linkedList.h>
 
 typedef enum {
@@ -21,6 +22,7 @@ struct EventHandler {
     uint32_t pid;
     ThreadControlBlock* thread;
     LinkedList<Event*> eventQueue;
+    WaitQueue eventWait;  // EVENT GET sleeps here until an event is queued
 };
 
 #endif  // EVENT_HANDLER_H
@@ -5,7 +5,9 @@
 #include <core/KernelSymbolResolver.h>
 #include <core/driver.h>
 #include <core/drivers/AudioDriver.h>
+#include <core/drivers/BlockQueue.h>
 #include <core/drivers/GraphicsDriver.h>
+#include <core/drivers/RamDisk.h>
 #include <core/drivers/ata.h>
 #include <core/drivers/keyboard.h>
 #include <core/drivers/mouse.h>
@@ -15,14 +17,18 @@
 #include <core/filesystem/msdospart.h>
 #include <core/gdt.h>
 #include <core/globals.h>
+#include <core/input.h>
 #include <core/interrupts.h>
+#include <core/kdata.h>
 #include <core/memory.h>
 #include <core/multiboot.h>
 #include <core/paging.h>
 #include <core/pci.h>
 #include <core/pmm.h>
 #include <core/scheduler.h>
+#include <core/softirq.h>
 #include <core/syscalls.h>
+#include <core/systrace.h>
 #include <core/timing.h>
 #include <core/tss.h>
 #include <debug.h>
@@ -13,6 +13,10 @@
 #define PIT_COMMAND_PORT 0x43
 #define PIT_CHANNEL0_PORT 0x40
 
+#ifndef RAMDISK_KB
+#define RAMDISK_KB 0
+#endif
+
 KERNEL_MEMORY_MAP g_kmap;
 
 extern "C" uint32_t pci_find_bar0(uint16_t vendor, uint16_t device);
@@ -208,6 +212,35 @@ void InitializePIT(uint32_t frequency) {
     printf("PIT Initialized at %d Hz\n", (int32_t)frequency);
 }
 
+// Start a storage module and mount the partitions of every disk it reports. The boot
+// volume stays on the IDE disk (modules are loaded from it); these disks are mounted
+// into the remaining partition slots.
+static void start_storage_driver(void* entryPoint, DriverManager* driverManager) {
+    if (!entryPoint) return;
+    GetDriverInstancePtr createDriver = (GetDriverInstancePtr)entryPoint;
+    void* raw = createDriver();
+    if (!raw) return;
+
+    Driver* drv = (Driver*)raw;
+    drv->Activate();
+    driverManager->AddDriver(drv);
+
+    BlockDevice* disk;
+    for (uint32_t i = 0; (disk = drv->GetBlockDevice(i)) != nullptr; i++) {
+        BlockQueue* queue = new BlockQueue(disk);
+        if (!queue) {
+            HALT("CRITICAL: Failed to allocate BlockQueue!\n");
+        }
+        queue->Start(Scheduler::activeInstance);
+
+        MSDOSPartitionTable* table = new MSDOSPartitionTable(queue);
+        if (!table) {
+            HALT("CRITICAL: Failed to allocate MSDOSPartitionTable!\n");
+        }
+        table->ReadPartitions(false);
+    }
+}
+
 void init_pci(FAT32* boot_partition, DriverManager* driverManager) {
     printf("\n[Kernel] Initializing Drivers...\n");
     // ---------------------------------------------------------
@@ -263,6 +296,7 @@ void init_pci(FAT32* boot_partition, DriverManager* driverManager) {
 
                         // UPDATE GLOBAL VARIABLE
                         g_GraphicsDriver = newScreen;
+                        KernelData::SetScreen(newScreen->GetWidth(), newScreen->GetHeight(), 32);
 
                         // Copy Old Screen to New Screen
                         int32_t x, y;
@@ -329,6 +363,8 @@ void init_pci(FAT32* boot_partition, DriverManager* driverManager) {
                         if (!g_AudioMixer) {
                             HALT("CRITICAL: Failed to allocate AudioMixer!\n");
                         }
+                        // Mixing runs in its own realtime thread, driven by the AC97 IRQ
+                        g_AudioMixer->StartThread(Scheduler::activeInstance);
 
                         // Set Master Volume
                         audio->SetVolume(90);
@@ -339,6 +375,53 @@ void init_pci(FAT32* boot_partition, DriverManager* driverManager) {
             delete drvFile;
         }
     }
+    if (dev) delete dev;
+    dev = nullptr;
+
+    // ---------------------------------------------------------
+    // 3. Dynamic SATA (AHCI) Loading
+    // ---------------------------------------------------------
+
+    // Any AHCI controller (class 01, subclass 06)
+    dev = pciCheck->FindClassDevice(0x01, 0x06);
+
+    if (dev->vendor_id != 0) {
+        const char* driverName = "DRIVERS/ahci.sys";
+        printf("[Kernel] SATA Controller Detected. Loading... [%s]\n", driverName);
+
+        File* drvFile = boot_partition->Open((char*)driverName);
+        if (drvFile) {
+            start_storage_driver(
+                ModuleLoader::LoadMatchingClassDriver(drvFile, dev->class_id, dev->subclass_id),
+                driverManager);
+            drvFile->Close();
+            delete drvFile;
+        }
+    }
+    if (dev) delete dev;
+    dev = nullptr;
+
+    // ---------------------------------------------------------
+    // 4. Dynamic virtio-blk Loading
+    // ---------------------------------------------------------
+
+    // Transitional virtio block device (QEMU -drive if=virtio)
+    dev = pciCheck->FindHardwareDevice(0x1AF4, 0x1001);
+
+    if (dev->vendor_id != 0) {
+        const char* driverName = "DRIVERS/virtblk.sys";
+        printf("[Kernel] virtio Block Device Detected. Loading... [%s]\n", driverName);
+
+        File* drvFile = boot_partition->Open((char*)driverName);
+        if (drvFile) {
+            start_storage_driver(
+                ModuleLoader::LoadMatchingDriver(drvFile, dev->vendor_id, dev->device_id),
+                driverManager);
+            drvFile->Close();
+            delete drvFile;
+        }
+    }
+    if (dev) delete dev;
     delete pciCheck;
 };
 
@@ -394,7 +477,9 @@ void pDesktop(void* arg) {
             screen->DrawString(25, 10, "ms", VBE_font, 0xFFFFFFFF);
             screen->Flush();
         } else {
-            Scheduler::activeInstance->Sleep(16);
+            // Nothing changed: sleep until MarkDirty/mouse input or the next clock update
+            uint32_t sinceClock = timerTicks - lastClockTick;
+            desktop->WaitForRedraw(sinceClock < 1000 ? 1000 - sinceClock : 1);
         }
     }
 }
@@ -409,6 +494,8 @@ extern "C" void kernelMain(void* multiboot_structure, uint32_t magicnumber) {
     }
 
     MultibootInfo* mbinfo = (MultibootInfo*)multiboot_structure;
+    // Before the memory holding the command line can be handed out
+    if (mbinfo->flags & 0x4) SyscallTrace::Configure((const char*)mbinfo->cmdline);
 #ifdef DEBUG_ENABLED
     DEBUG_LOG("Initializing Hardware");
 #endif
@@ -429,6 +516,8 @@ extern "C" void kernelMain(void* multiboot_structure, uint32_t magicnumber) {
         HALT("CRITICAL: Failed to allocate Paging object!\n");
     }
     g_paging->Activate();
+    // Before the first process directory is created
+    KernelData::Init();
 
     // Initialize ATA
     AdvancedTechnologyAttachment* ata = nullptr;
@@ -461,8 +550,15 @@ extern "C" void kernelMain(void* multiboot_structure, uint32_t magicnumber) {
             "Error: No ATA drive detected!\nPlease connect an ATA drive and restart the system.\n");
     }
 
+    // Requests to the boot disk are sorted and merged; until the scheduler runs
+    // the queue passes them straight through
+    BlockQueue* bootQueue = new BlockQueue(ata);
+    if (!bootQueue) {
+        HALT("CRITICAL: Failed to allocate BlockQueue!\n");
+    }
+
     // Initialize MBR and Partitions
-    MSDOSPartitionTable* MSDOS = new MSDOSPartitionTable(ata);
+    MSDOSPartitionTable* MSDOS = new MSDOSPartitionTable(bootQueue);
     if (!MSDOS) {
         HALT("CRITICAL: Failed to allocate MSDOSPartitionTable!\n");
     }
@@ -481,6 +577,7 @@ extern "C" void kernelMain(void* multiboot_structure, uint32_t magicnumber) {
     if (!g_GraphicsDriver) {
         HALT("CRITICAL: Failed to allocate VESA_BIOS_Extensions!\n");
     }
+    KernelData::SetScreen(g_GraphicsDriver->GetWidth(), g_GraphicsDriver->GetHeight(), 32);
 
     // Load Boot Image
     char* bootImageName = (char*)"BITMAPS/BOOT.BMP";
@@ -543,6 +640,15 @@ extern "C" void kernelMain(void* multiboot_structure, uint32_t magicnumber) {
     if (!g_interrupts) {
         HALT("CRITICAL: Failed to allocate InterruptManager!\n");
     }
+    // Disk completions can now sleep on IRQ14/15 instead of spinning
+    ata->EnableInterrupts(g_interrupts);
+    // ...and large transfers go by bus-master DMA while other threads run
+    ata->EnableDMA();
+    bootQueue->Start(g_scheduler);
+    // Runs bottom halves that IRQ exit could not finish, and queued work
+    SoftIRQ::StartWorker(g_scheduler);
+    InputQueue::Init();
+
     g_sysCalls = new SyscallHandler(0x80, g_interrupts);
     if (!g_sysCalls) {
         HALT("CRITICAL: Failed to allocate SyscallHandler!\n");
@@ -551,6 +657,7 @@ extern "C" void kernelMain(void* multiboot_structure, uint32_t magicnumber) {
     if (!guiCalls) {
         HALT("CRITICAL: Failed to allocate HguiHandler!\n");
     }
+    SyscallHandler::EnableSysenter();
 
     g_driverManager = new DriverManager();
     if (!g_driverManager) {
@@ -559,6 +666,19 @@ extern "C" void kernelMain(void* multiboot_structure, uint32_t magicnumber) {
 
     init_pci(g_bootPartition, g_driverManager);
 
+#if RAMDISK_KB > 0
+    // Scratch volume without disk latency, for filesystem benchmarks (make RAMDISK_KB=...)
+    RamDisk* ramDisk = new RamDisk(RAMDISK_KB * 2);
+    if (!ramDisk) {
+        HALT("CRITICAL: Failed to allocate RamDisk!\n");
+    }
+    FAT32::FormatRaw(ramDisk, 0, ramDisk->GetSizeInSectors());
+    MSDOSPartitionTable::Mount(ramDisk, 0);
+#endif
+
+    // Every volume is mounted: metadata is written back in the background from now on
+    MSDOSPartitionTable::StartFlushers(g_scheduler);
+
     MouseDriver* mouse = new MouseDriver(g_interrupts, desktop);
     if (!mouse) {
         HALT("CRITICAL: Failed to allocate MouseDriver!\n");
@@ -575,7 +695,8 @@ extern "C" void kernelMain(void* multiboot_structure, uint32_t magicnumber) {
     if (!desktopArgs) {
         HALT("CRITICAL: Failed to allocate DesktopArgs!\n");
     }
-    ProcessControlBlock* process1 = g_scheduler->CreateProcess(true, pDesktop, desktopArgs);
+    ProcessControlBlock* process1 =
+        g_scheduler->CreateProcess(true, pDesktop, desktopArgs, KSTACK_LARGE);
 
     if (mbinfo->mods_count > 0) {
         DEBUG_LOG("Found %d Modules", mbinfo->mods_count);
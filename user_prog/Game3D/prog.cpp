@@ -244,6 +244,8 @@ extern "C" void _start(void* arg) {
     // MAIN GAME LOOP
     // ========================================================================
     while (1) {
+        uint64_t frameStart = kdata_time_ns();
+
         // POLL INPUT
         syscall_get_input(&input);
 
@@ -330,7 +332,8 @@ extern "C" void _start(void* arg) {
         // UPSCALE TO SCREEN
         BlitUpscale(screenBuffer, screenW, screenH, renderBuffer, RENDER_W, RENDER_H);
 
-        // Frame delay (~60fps)
-        syscall_sleep(16);
+        // Frame pacing (~60fps): sleep only what is left of the 16ms budget
+        uint32_t frameMs = (uint32_t)(kdata_time_ns() - frameStart) / 1000000;
+        if (frameMs < 16) syscall_sleep(16 - frameMs);
     }
 }
@@ -62,8 +62,7 @@ void EventHandlerHGUI(void* arg) {
                     break;
             }
         }
-
-        syscall_sleep(50);
+        // No sleep needed: EVENT GET blocks in the kernel until an event arrives
     }
 }
 
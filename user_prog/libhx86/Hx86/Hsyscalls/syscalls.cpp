@@ -8,86 +8,226 @@
 
 #include <Hx86/Hsyscalls/syscalls.h>
 
-void syscall_exit(uint32_t status = 0) {
-    asm volatile("int $0x80" : : "a"(sys_exit), "b"(status));
+// -1 not probed yet, 0 int 0x80/0x81, 1 SYSENTER
+static int32_t sysenterMode = -1;
+
+static bool CpuHasSysenter() {
+    uint32_t eax, ebx, ecx, edx;
+    asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+
+    // SEP (bit 11). Family 6 model < 3 stepping < 3 reports it without supporting it.
+    uint32_t family = (eax >> 8) & 0xF;
+    uint32_t model = (eax >> 4) & 0xF;
+    uint32_t stepping = eax & 0xF;
+    return (edx & (1 << 11)) && !(family == 6 && model < 3 && stepping < 3);
 }
 
-HeapData syscall_heap() {
-    int32_t retun_data = -1;
+/*
+ * Enter the kernel: SYSENTER when the CPU has it, the interrupt gates otherwise.
+ * Calls use ABI v2, so the result comes back in EAX and the extra values in
+ * EDX/ECX (EBX/ESI on SYSENTER, where SYSEXIT consumes EDX/ECX). SYSENTER does
+ * not save a return point, so the kernel gets our ESP in EBP and the address
+ * to come back to in EDI.
+ */
+static inline SyscallResult SyscallEx(uint32_t number, uint32_t ebx = 0, uint32_t ecx = 0,
+                                      uint32_t esi = 0, bool hgui = false) {
+    if (sysenterMode < 0) sysenterMode = CpuHasSysenter() ? 1 : 0;
+
+    uint32_t eax = number | (SYSCALL_ABI_V2 << SYSCALL_ABI_SHIFT);
+    uint32_t edx = 0;
+    SyscallResult result;
+
+    if (sysenterMode == 1) {
+        if (hgui) eax |= SYSENTER_HGUI;
+        asm volatile(
+            "push %%ebp\n\t"
+            "mov %%esp, %%ebp\n\t"
+            "mov $1f, %%edi\n\t"
+            "sysenter\n"
+            "1:\n\t"
+            "pop %%ebp"
+            : "+a"(eax), "+b"(ebx), "+c"(ecx), "+d"(edx), "+S"(esi)
+            :
+            : "edi", "memory");
+        result.extra0 = ebx;
+        result.extra1 = esi;
+    } else {
+        if (hgui) {
+            asm volatile("int $0x81"
+                         : "+a"(eax), "+c"(ecx), "+d"(edx)
+                         : "b"(ebx), "S"(esi)
+                         : "memory");
+        } else {
+            asm volatile("int $0x80"
+                         : "+a"(eax), "+c"(ecx), "+d"(edx)
+                         : "b"(ebx), "S"(esi)
+                         : "memory");
+        }
+        result.extra0 = edx;
+        result.extra1 = ecx;
+    }
+    result.value = (int32_t)eax;
+    return result;
+}
+
+static inline int32_t Syscall(uint32_t number, uint32_t ebx = 0, uint32_t ecx = 0,
+                              uint32_t esi = 0) {
+    return SyscallEx(number, ebx, ecx, esi).value;
+}
+
+bool syscall_use_sysenter(bool enable) {
+    if (enable && !CpuHasSysenter()) {
+        sysenterMode = 0;
+        return false;
+    }
+    sysenterMode = enable ? 1 : 0;
+    return true;
+}
+
+uint32_t syscall_latency(uint32_t iterations) {
+    if (!iterations) return 0;
+    uint32_t lo0, hi0, lo1, hi1;
 
-    uint32_t retun_data1 = 0;
-    uint32_t retun_data2 = 0;
-    multi_para_model data = {retun_data1, retun_data2, 0, 0, 0};
-    asm volatile("int $0x80"
-                 :
-                 : "a"(sys_Hcall), "b"(Hsys_getHeap), "c"((void*)&data), "d"((void*)&retun_data));
+    // sys_peek_memory with size 0 only writes the result back
+    asm volatile("rdtsc" : "=a"(lo0), "=d"(hi0));
+    for (uint32_t i = 0; i < iterations; i++) {
+        Syscall(sys_peek_memory, 0, 0);
+    }
+    asm volatile("rdtsc" : "=a"(lo1), "=d"(hi1));
+
+    // The low 32 bits cover any sane iteration count (no 64-bit division in here)
+    return (lo1 - lo0) / iterations;
+}
+
+void syscall_exit(uint32_t status = 0) {
+    Syscall(sys_exit, status);
+}
 
-    while (retun_data == -1);
-    HeapData heapdata = {data.param0, data.param1};
+HeapData syscall_heap() {
+    SyscallResult r = SyscallEx(sys_Hcall, Hsys_getHeap);
+    HeapData heapdata = {r.extra0, r.extra1};
     return heapdata;
 }
 
 uint32_t syscall_register_event_handler(void (*entrypoint)(void*), void* arg) {
-    int32_t retun_data = -1;
     multi_para_model data = {(uint32_t)arg, (uint32_t)entrypoint, 0, 0, 0};
-    asm volatile("int $0x80"
-                 :
-                 : "a"(sys_Hcall), "b"(Hsys_regEventH), "c"(&data), "d"((void*)&retun_data));
-
-    while (retun_data == -1);
-    return (uint32_t)retun_data;
+    return (uint32_t)Syscall(sys_Hcall, Hsys_regEventH, (uint32_t)&data);
 }
 
 uint32_t syscall_clone(void (*entrypoint)(void*), void* arg) {
-    int32_t retun_data = -1;
-    asm volatile("int $0x80"
-                 :
-                 : "a"(sys_clone), "b"(entrypoint), "c"(arg), "d"((void*)&retun_data));
-
-    while (retun_data == -1);
-    return (uint32_t)retun_data;
+    return (uint32_t)Syscall(sys_clone, (uint32_t)entrypoint, (uint32_t)arg);
 }
 
 void syscall_sleep(uint32_t ms) {
-    asm volatile("int $0x80" : : "a"(sys_sleep), "b"(ms));
+    Syscall(sys_sleep, ms);
+}
+
+void syscall_yield() {
+    Syscall(sys_yield);
+}
+
+int32_t syscall_thread_join(uint32_t tid, int32_t* exitCode) {
+    SyscallResult r = SyscallEx(sys_thread_join, tid);
+    if (r.value == THREAD_JOIN_OK && exitCode) *exitCode = (int32_t)r.extra0;
+    return r.value;
+}
+
+int32_t syscall_open(const char* path, uint32_t* size) {
+    SyscallResult r = SyscallEx(sys_open, (uint32_t)path);
+    if (size) *size = r.value >= 0 ? r.extra0 : 0;
+    return r.value;
+}
+
+int32_t syscall_read(int32_t fd, void* buffer, uint32_t length) {
+    return Syscall(sys_read, (uint32_t)fd, (uint32_t)buffer, length);
+}
+
+int32_t syscall_write(int32_t fd, const void* buffer, uint32_t length) {
+    return Syscall(sys_write, (uint32_t)fd, (uint32_t)buffer, length);
+}
+
+int32_t syscall_lseek(int32_t fd, int32_t offset, uint32_t whence) {
+    return Syscall(sys_lseek, (uint32_t)fd, (uint32_t)offset, whence);
+}
+
+int32_t syscall_close(int32_t fd) {
+    return Syscall(sys_close, (uint32_t)fd);
+}
+
+void syscall_sync() {
+    Syscall(sys_sync);
+}
+
+// sys_trace operations (core/systrace.h)
+#define SYSTRACE_OP_FILTER 0
+#define SYSTRACE_OP_DRAIN 1
+#define SYSTRACE_OP_STATS 2
+#define SYSTRACE_OP_RESET 3
+
+int32_t syscall_trace_filter(uint32_t pid, uint32_t flags) {
+    return Syscall(sys_trace, SYSTRACE_OP_FILTER, pid, flags);
+}
+
+int32_t syscall_trace_drain(SyscallTraceEntry* entries, uint32_t max, uint32_t* lost) {
+    SyscallResult r = SyscallEx(sys_trace, SYSTRACE_OP_DRAIN, (uint32_t)entries, max);
+    if (lost) *lost = r.value >= 0 ? r.extra0 : 0;
+    return r.value;
+}
+
+int32_t syscall_trace_stats(uint32_t pid, SyscallStatEntry* entries) {
+    return Syscall(sys_trace, SYSTRACE_OP_STATS, pid, (uint32_t)entries);
+}
+
+int32_t syscall_trace_reset(uint32_t pid) {
+    return Syscall(sys_trace, SYSTRACE_OP_RESET, pid);
+}
+
+int32_t syscall_ring_setup(void* ring, uint32_t entries) {
+    return Syscall(sys_ring_setup, (uint32_t)ring, entries);
+}
+
+int32_t syscall_ring_enter(uint32_t toSubmit) {
+    return Syscall(sys_ring_enter, toSubmit);
+}
+
+int32_t syscall_futex_wait(volatile uint32_t* addr, uint32_t expected, uint32_t timeoutMs) {
+    return Syscall(sys_futex_wait, (uint32_t)addr, expected, timeoutMs);
+}
+
+int32_t syscall_futex_wake(volatile uint32_t* addr, uint32_t count) {
+    return Syscall(sys_futex_wake, (uint32_t)addr, count);
+}
+
+int32_t syscall_sched_stats(SchedStatsInfo* info, ThreadStatsInfo* threads, uint32_t maxThreads) {
+    return Syscall(sys_sched_stats, (uint32_t)info, (uint32_t)threads, maxThreads);
 }
 
 void syscall_debug(const char* str) {
-    asm volatile("int $0x80" : : "a"(sys_debug), "b"(str));
+    Syscall(sys_debug, (uint32_t)str);
 }
 
 int32_t syscall_sbrk(int32_t increment) {
-    int32_t return_data;
-    asm volatile("int $0x80" : : "a"(sys_sbrk), "b"(increment), "d"(&return_data));
-    return return_data;
+    return Syscall(sys_sbrk, (uint32_t)increment);
 }
 
 uint32_t syscall_peek_memory(uint32_t address, uint32_t size) {
-    int32_t return_data = 0;
-    asm volatile("int $0x80"
-                 :
-                 : "a"(sys_peek_memory), "b"(address), "c"(size), "d"((void*)&return_data)
-                 : "memory");
-    return (uint32_t)return_data;
+    return (uint32_t)Syscall(sys_peek_memory, address, size);
 }
 
 uint32_t syscall_Hgui(uint32_t element, uint32_t mode, void* data) {
-    int32_t retun_data;
-    asm volatile("int $0x81" : : "a"(element), "b"(mode), "c"(data), "d"((void*)&retun_data));
+    return (uint32_t)SyscallEx(element, mode, (uint32_t)data, 0, true).value;
+}
 
-    while (!retun_data);
-    return (uint32_t)retun_data;
+int32_t syscall_input_wait(InputEvent* events, uint32_t max, uint32_t timeoutMs, uint32_t* lost) {
+    SyscallResult r = SyscallEx(sys_input_wait, (uint32_t)events, max, timeoutMs);
+    if (lost) *lost = r.value >= 0 ? r.extra0 : 0;
+    return r.value;
 }
 
 FramebufferInfo syscall_get_framebuffer() {
-    int32_t retun_data = -1;
+    // Three values, more than fit in registers: the kernel fills 'data'
     multi_para_model data = {0, 0, 0, 0, 0};
-    asm volatile("int $0x80"
-                 :
-                 : "a"(sys_Hcall), "b"(Hsys_getFramebuffer), "c"((void*)&data),
-                   "d"((void*)&retun_data)
-                 : "memory");
-    while (retun_data == -1);
+    Syscall(sys_Hcall, Hsys_getFramebuffer, (uint32_t)&data);
     FramebufferInfo info;
     info.buffer = data.param0;
     info.width = data.param1;
@@ -96,24 +236,15 @@ FramebufferInfo syscall_get_framebuffer() {
 }
 
 void syscall_get_input(InputState* state) {
-    int32_t retun_data = -1;
     multi_para_model data = {(uint32_t)state, 0, 0, 0, 0};
-    asm volatile("int $0x80"
-                 :
-                 : "a"(sys_Hcall), "b"(Hsys_getInput), "c"((void*)&data), "d"((void*)&retun_data)
-                 : "memory");
-    while (retun_data == -1);
+    Syscall(sys_Hcall, Hsys_getInput, (uint32_t)&data);
 }
 
 int32_t syscall_read_file(const char* filename, uint8_t* buffer, uint32_t maxSize,
                           uint32_t* actualSize) {
-    int32_t retun_data = -1;
     multi_para_model data = {(uint32_t)filename, (uint32_t)buffer, maxSize, 0, 0};
-    asm volatile("int $0x80"
-                 :
-                 : "a"(sys_Hcall), "b"(Hsys_readFile), "c"((void*)&data), "d"((void*)&retun_data)
-                 : "memory");
-    // retun_data == -1 means failure; don't spin-wait
-    if (actualSize) *actualSize = data.param3;
-    return retun_data;
+    SyscallResult r = SyscallEx(sys_Hcall, Hsys_readFile, (uint32_t)&data);
+    // -1 means failure, the file size is the extra value
+    if (actualSize) *actualSize = r.value >= 0 ? r.extra0 : 0;
+    return r.value;
 }
@@ -0,0 +1,77 @@
+/**
+ * @file        ioring.cpp
+ * @brief       Hx86 batched system calls over the kernel submission/completion ring
+ *
+ * @date        18/10/2026
+ * @version     1.0.0
+ */
+
+#include <Hx86/ioring.h>
+#include <Hx86/memory.h>
+
+int32_t IORing::Init(uint32_t entries) {
+    if (header) return IORING_EBUSY;
+    if (entries == 0 || entries > IORING_MAX_ENTRIES || (entries & (entries - 1))) {
+        return IORING_EINVAL;
+    }
+
+    uint32_t size = sizeof(IORingHeader) + entries * (sizeof(IORingSQE) + sizeof(IORingCQE));
+    IORingHeader* mem = (IORingHeader*)kmalloc(size);
+    if (!mem) return IORING_EINVAL;
+    memset(mem, 0, size);
+
+    int32_t result = syscall_ring_setup(mem, entries);
+    if (result != 0) {
+        kfree(mem);
+        return result;
+    }
+
+    header = mem;
+    sq = (IORingSQE*)(header + 1);
+    cq = (IORingCQE*)(sq + entries);
+    mask = entries - 1;
+    return 0;
+}
+
+IORingSQE* IORing::GetSQE() {
+    if (!header) return nullptr;
+    if (header->sqTail - header->sqHead > mask) return nullptr;
+    return &sq[header->sqTail & mask];
+}
+
+bool IORing::Prep(uint32_t number, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t userData) {
+    IORingSQE* sqe = GetSQE();
+    if (!sqe) return false;
+    sqe->opcode = number;
+    sqe->args[0] = a0;
+    sqe->args[1] = a1;
+    sqe->args[2] = a2;
+    sqe->userData = userData;
+
+    // Publish after the entry is written
+    __atomic_store_n(&header->sqTail, header->sqTail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool IORing::PrepHgui(uint32_t element, uint32_t mode, void* data, uint32_t userData) {
+    return Prep(element | IORING_OP_HGUI, mode, (uint32_t)data, 0, userData);
+}
+
+bool IORing::PrepSleep(uint32_t ms, uint32_t userData) {
+    return Prep(sys_sleep, ms, 0, 0, userData);
+}
+
+int32_t IORing::Submit() {
+    if (!header) return IORING_ENXIO;
+    if (header->sqTail == header->sqHead) return 0;
+    return syscall_ring_enter(0);
+}
+
+bool IORing::Reap(IORingCQE& out) {
+    if (!header) return false;
+    uint32_t head = header->cqHead;
+    if (head == __atomic_load_n(&header->cqTail, __ATOMIC_ACQUIRE)) return false;
+    out = cq[head & mask];
+    header->cqHead = head + 1;
+    return true;
+}
@@ -0,0 +1,78 @@
+/**
+ * @file        kdata.cpp
+ * @brief       Hx86 readers for the shared kernel data page
+ *
+ * @date        18/10/2026
+ * @version     1.0.0
+ */
+
+#include <Hx86/kdata.h>
+
+static inline const volatile KernelDataPage* Page() {
+    return (const volatile KernelDataPage*)KDATA_USER_VIRT;
+}
+
+// Sequence value to read under, waits out a write in progress
+static inline uint32_t ReadBegin() {
+    uint32_t seq;
+    while ((seq = Page()->sequence) & 1) asm volatile("pause");
+    asm volatile("" ::: "memory");
+    return seq;
+}
+
+static inline bool ReadRetry(uint32_t seq) {
+    asm volatile("" ::: "memory");
+    return Page()->sequence != seq;
+}
+
+void kdata_snapshot(KernelDataPage* out) {
+    uint32_t seq;
+    do {
+        seq = ReadBegin();
+        const volatile uint8_t* src = (const volatile uint8_t*)Page();
+        uint8_t* dst = (uint8_t*)out;
+        for (uint32_t i = 0; i < sizeof(KernelDataPage); i++) dst[i] = src[i];
+    } while (ReadRetry(seq));
+}
+
+uint64_t kdata_ticks() {
+    uint32_t seq;
+    uint64_t ticks;
+    do {
+        seq = ReadBegin();
+        ticks = Page()->timerTicks;
+    } while (ReadRetry(seq));
+    return ticks;
+}
+
+uint64_t kdata_time_ns() {
+    uint32_t seq;
+    uint64_t ticks, tscAtTick;
+    uint32_t tscPerMs, mult;
+    do {
+        seq = ReadBegin();
+        ticks = Page()->timerTicks;
+        tscAtTick = Page()->tscAtTick;
+        tscPerMs = Page()->tscPerMs;
+        mult = Page()->nsPerTscMult;
+    } while (ReadRetry(seq));
+
+    uint64_t ns = ticks * 1000000ULL;
+    if (!tscPerMs) return ns;
+
+    // Clamp to one tick so a late timer IRQ never makes time run ahead of the next tick
+    uint64_t delta = kdata_rdtsc() - tscAtTick;
+    if (delta > tscPerMs) delta = tscPerMs;
+    return ns + (((uint64_t)(uint32_t)delta * mult) >> KDATA_NS_SHIFT);
+}
+
+void kdata_screen(uint32_t* width, uint32_t* height) {
+    uint32_t seq, w, h;
+    do {
+        seq = ReadBegin();
+        w = Page()->screenWidth;
+        h = Page()->screenHeight;
+    } while (ReadRetry(seq));
+    if (width) *width = w;
+    if (height) *height = h;
+}
@@ -0,0 +1,83 @@
+/**
+ * @file        sync.cpp
+ * @brief       Hx86 user-space Mutex / CondVar / Barrier on futexes
+ *
+ * @date        18/10/2026
+ * @version     1.0.0
+ */
+
+#include <Hx86/sync.h>
+
+static inline uint32_t CompareExchange(volatile uint32_t* addr, uint32_t expected,
+                                       uint32_t desired) {
+    __atomic_compare_exchange_n(addr, &expected, desired, false, __ATOMIC_ACQUIRE,
+                                __ATOMIC_RELAXED);
+    return expected;  // Value seen before the exchange
+}
+
+// --- Mutex ---
+
+void Mutex::Lock() {
+    // Fast path: 0 -> 1 without a syscall
+    uint32_t c = CompareExchange(&state, 0, 1);
+    if (c == 0) return;
+
+    // Slow path: mark contended and sleep until the owner hands over
+    if (c != 2) c = __atomic_exchange_n(&state, 2, __ATOMIC_ACQUIRE);
+    while (c != 0) {
+        syscall_futex_wait(&state, 2);
+        c = __atomic_exchange_n(&state, 2, __ATOMIC_ACQUIRE);
+    }
+}
+
+bool Mutex::TryLock() {
+    return CompareExchange(&state, 0, 1) == 0;
+}
+
+void Mutex::Unlock() {
+    // Only enter the kernel if somebody may be sleeping
+    if (__atomic_fetch_sub(&state, 1, __ATOMIC_RELEASE) != 1) {
+        __atomic_store_n(&state, 0, __ATOMIC_RELEASE);
+        syscall_futex_wake(&state, 1);
+    }
+}
+
+// --- CondVar ---
+
+bool CondVar::Wait(Mutex& mutex, uint32_t timeoutMs) {
+    uint32_t seq = __atomic_load_n(&sequence, __ATOMIC_RELAXED);
+    mutex.Unlock();
+    // Returns at once if a Signal bumped the sequence after we sampled it
+    int32_t r = syscall_futex_wait(&sequence, seq, timeoutMs);
+    mutex.Lock();
+    return r != FUTEX_ETIMEDOUT;
+}
+
+void CondVar::Signal() {
+    __atomic_fetch_add(&sequence, 1, __ATOMIC_RELEASE);
+    syscall_futex_wake(&sequence, 1);
+}
+
+void CondVar::Broadcast() {
+    __atomic_fetch_add(&sequence, 1, __ATOMIC_RELEASE);
+    syscall_futex_wake(&sequence, 0xFFFFFFFF);
+}
+
+// --- Barrier ---
+
+bool Barrier::Wait() {
+    uint32_t gen = __atomic_load_n(&generation, __ATOMIC_ACQUIRE);
+
+    if (__atomic_add_fetch(&arrived, 1, __ATOMIC_ACQ_REL) == count) {
+        // Last one in: reset for the next round and release everybody
+        __atomic_store_n(&arrived, 0, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&generation, 1, __ATOMIC_RELEASE);
+        syscall_futex_wake(&generation, 0xFFFFFFFF);
+        return true;
+    }
+
+    while (__atomic_load_n(&generation, __ATOMIC_ACQUIRE) == gen) {
+        syscall_futex_wait(&generation, gen);
+    }
+    return false;
+}
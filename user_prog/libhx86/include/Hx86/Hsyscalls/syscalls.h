@@ -14,7 +14,18 @@ typedef enum {
     sys_sleep = 7,
     sys_sbrk = 8,
     sys_peek_memory = 9,
+    sys_lseek = 19,
+    sys_sync = 36,
     sys_clone = 41,
+    sys_futex_wait = 42,
+    sys_futex_wake = 43,
+    sys_sched_stats = 44,
+    sys_yield = 45,
+    sys_thread_join = 46,
+    sys_ring_setup = 47,
+    sys_ring_enter = 48,
+    sys_trace = 49,
+    sys_input_wait = 50,
     sys_Hcall = 199,
     sys_debug = 200,
 } SYSCALL;
@@ -35,6 +46,25 @@ struct InputState {
     uint8_t mouseButtons;
 } __attribute__((packed));
 
+// Input events from sys_input_wait (match the kernel's core/input.h)
+#define INPUT_KEY_DOWN 1    // code = scancode
+#define INPUT_KEY_UP 2      // code = scancode
+#define INPUT_MOUSE_MOVE 3  // dx/dy, screen Y grows downwards
+#define INPUT_MOUSE_DOWN 4  // code = button (1 left, 2 right, 3 middle)
+#define INPUT_MOUSE_UP 5
+#define INPUT_FLAG_EXTENDED 0x1  // 0xE0-prefixed key (arrows, right Ctrl/Alt...)
+#define INPUT_WAIT_FOREVER 0xFFFFFFFF
+
+struct InputEvent {
+    uint64_t tsc;  // When the IRQ saw it
+    uint8_t type;
+    uint8_t code;
+    uint8_t flags;
+    uint8_t buttons;  // Mouse buttons after the event
+    int16_t dx;
+    int16_t dy;
+} __attribute__((packed));
+
 // Framebuffer info structure
 struct FramebufferInfo {
     uint32_t buffer;
@@ -42,6 +72,46 @@ struct FramebufferInfo {
     uint32_t height;
 };
 
+// CPU accounting snapshot for sys_sched_stats (matches the kernel layout)
+#define SCHED_LATENCY_BUCKETS 16
+#define SCHED_LATENCY_SHIFT 12  // Bucket i: run-queue wait < 2^(i + 12) TSC cycles
+
+struct SchedStatsInfo {
+    uint64_t totalCycles;
+    uint64_t idleCycles;
+    uint32_t idlePermille;  // Idle share of the last second, 0..1000
+    uint32_t tscPerMs;      // 0 until the kernel has calibrated the TSC
+    uint32_t contextSwitches;
+    uint32_t threadCount;
+    uint32_t runQueueLatency[SCHED_LATENCY_BUCKETS];
+} __attribute__((packed));
+
+struct ThreadStatsInfo {
+    uint32_t tid;
+    uint32_t pid;
+    uint32_t state;  // 1 ready, 2 running, 3 blocked, 4 terminated
+    uint32_t voluntarySwitches;
+    uint32_t involuntarySwitches;
+    uint64_t cpuCycles;
+    uint64_t processCycles;
+} __attribute__((packed));
+
+// System call ABI version in bits 24-30 of EAX (matches the kernel). V2 returns the
+// result in EAX plus up to two extra values, V1 wrote it through a pointer in EDX.
+#define SYSCALL_ABI_SHIFT 24
+#define SYSCALL_ABI_V1 0
+#define SYSCALL_ABI_V2 1
+#define SYSCALL_ENOSYS -38
+
+// Set in EAX on the SYSENTER path to reach the Hgui handler (int 0x81)
+#define SYSENTER_HGUI 0x80000000
+
+struct SyscallResult {
+    int32_t value;
+    uint32_t extra0;
+    uint32_t extra1;
+};
+
 struct HeapData {
     uint32_t param0;
     uint32_t param1;
@@ -60,13 +130,118 @@ struct multi_para_model {
 void syscall_exit(uint32_t status);
 HeapData syscall_heap();
 uint32_t syscall_register_event_handler(void (*entrypoint)(void*), void* arg);
+// Returns the new thread's TID, 0 on failure
 uint32_t syscall_clone(void (*entrypoint)(void*), void* arg);
 void syscall_sleep(uint32_t ms);
+void syscall_yield();
+
+// Join results (match the kernel)
+#define THREAD_JOIN_OK 0
+#define THREAD_JOIN_ESRCH -3  // Not a thread of this process, or already joined
+#define THREAD_JOIN_EDEADLK -35
+#define THREAD_JOIN_EFAULT -14
+
+// Wait for thread 'tid' to exit. Its syscall_exit status goes to *exitCode (may be null).
+int32_t syscall_thread_join(uint32_t tid, int32_t* exitCode = nullptr);
+
+// Futex results (match the kernel)
+#define FUTEX_OK 0
+#define FUTEX_EAGAIN -11
+#define FUTEX_ETIMEDOUT -110
+#define FUTEX_EINVAL -22
+
+// Sleep while *addr == expected (timeoutMs 0 = no timeout)
+int32_t syscall_futex_wait(volatile uint32_t* addr, uint32_t expected, uint32_t timeoutMs = 0);
+// Wake up to 'count' threads sleeping on addr, returns how many were woken
+int32_t syscall_futex_wake(volatile uint32_t* addr, uint32_t count);
+// Fills 'info' and up to maxThreads entries of 'threads' (at most 256), returns
+// entries written or SCHED_STATS_EFAULT
+#define SCHED_STATS_EFAULT -14
+int32_t syscall_sched_stats(SchedStatsInfo* info, ThreadStatsInfo* threads, uint32_t maxThreads);
+// File descriptor results and seek origins (match the kernel)
+#define FD_STDIN 0
+#define FD_STDOUT 1
+#define FD_STDERR 2
+#define FD_ENOENT -2
+#define FD_EIO -5
+#define FD_EBADF -9
+#define FD_EFAULT -14
+#define FD_EISDIR -21
+#define FD_EINVAL -22
+#define FD_EMFILE -24
+#define FD_EROFS -30
+#define FD_SEEK_SET 0
+#define FD_SEEK_CUR 1
+#define FD_SEEK_END 2
+
+// Open a file on the boot partition for reading. Returns a descriptor or FD_E*,
+// the file size goes to *size (may be null).
+int32_t syscall_open(const char* path, uint32_t* size = nullptr);
+// Read from the current position. Returns bytes read, 0 at end of file, or FD_E*.
+int32_t syscall_read(int32_t fd, void* buffer, uint32_t length);
+// Only FD_STDOUT/FD_STDERR (the kernel console) accept writes
+int32_t syscall_write(int32_t fd, const void* buffer, uint32_t length);
+// Returns the new position or FD_E*
+int32_t syscall_lseek(int32_t fd, int32_t offset, uint32_t whence);
+int32_t syscall_close(int32_t fd);
+// Returns once everything written so far is on the disk
+void syscall_sync();
+// Register a batched-syscall ring (see Hx86/ioring.h), entries 0 unregisters
+int32_t syscall_ring_setup(void* ring, uint32_t entries);
+// Run up to 'toSubmit' queued ring entries (0 = all), returns how many were consumed
+int32_t syscall_ring_enter(uint32_t toSubmit);
+// System call tracing (match the kernel's core/systrace.h)
+#define SYSTRACE_HGUI 0x80000000  // Set in 'call' for Hgui element calls
+#define SYSTRACE_STAT_SLOTS 64
+#define SYSTRACE_PID_NONE 0xFFFFFFFF
+#define SYSTRACE_PID_ALL 0xFFFFFFFE
+#define SYSTRACE_PID_SELF 0xFFFFFFFD
+#define SYSTRACE_EPERM -1
+#define SYSTRACE_TO_RING 0x1
+#define SYSTRACE_TO_SERIAL 0x2
+
+struct SyscallStatEntry {
+    uint32_t call;
+    uint32_t count;
+    uint64_t totalCycles;
+    uint32_t maxCycles;
+} __attribute__((packed));
+
+struct SyscallTraceEntry {
+    uint64_t tsc;
+    uint32_t pid;
+    uint32_t tid;
+    uint32_t call;
+    uint32_t args[3];
+    int32_t result;
+    uint32_t cycles;
+} __attribute__((packed));
+
+// Trace every call of 'pid' to the given SYSTRACE_TO_* sinks, 0 stops. Filter, stats and
+// reset only accept the caller's own pid (or SYSTRACE_PID_SELF) and fail with SYSTRACE_EPERM.
+int32_t syscall_trace_filter(uint32_t pid, uint32_t flags);
+// Take up to 'max' of the caller's own records off the trace ring. Records overwritten
+// since the last drain are counted in *lost (may be null).
+int32_t syscall_trace_drain(SyscallTraceEntry* entries, uint32_t max, uint32_t* lost = nullptr);
+// Copy the per-call counters of 'pid' into entries[SYSTRACE_STAT_SLOTS], returns entries used
+int32_t syscall_trace_stats(uint32_t pid, SyscallStatEntry* entries);
+int32_t syscall_trace_reset(uint32_t pid);
+// Pick SYSENTER (default when the CPU has it) or int 0x80. False if SYSENTER is unavailable.
+bool syscall_use_sysenter(bool enable);
+// Average round trip of a no-op system call in TSC cycles on the current path. Switch
+// paths with syscall_use_sysenter() to compare the two on a given machine.
+uint32_t syscall_latency(uint32_t iterations);
 void syscall_debug(const char* str);
 uint32_t syscall_peek_memory(uint32_t address, uint32_t size);
 int32_t syscall_sbrk(int32_t increment);
 uint32_t syscall_Hgui(uint32_t element, uint32_t mode, void* data);
 
+// Wait up to timeoutMs (0 polls) for keyboard/mouse events, returns how many were copied.
+// The first call starts queueing for this process. *lost (may be null) gets the events
+// dropped because the queue filled up.
+int32_t syscall_input_wait(InputEvent* events, uint32_t max, uint32_t timeoutMs,
+                           uint32_t* lost = nullptr);
+
 FramebufferInfo syscall_get_framebuffer();
 void syscall_get_input(InputState* state);
 int32_t syscall_read_file(const char* filename, uint8_t* buffer, uint32_t maxSize,
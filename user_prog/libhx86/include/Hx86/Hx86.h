@@ -5,7 +5,10 @@
 #include <Hx86/Hsyscalls/syscalls.h>
 #include <Hx86/debug.h>
 #include <Hx86/globals.h>
+#include <Hx86/ioring.h>
+#include <Hx86/kdata.h>
 #include <Hx86/memory.h>
+#include <Hx86/sync.h>
 
 void init_sys(void* arg);
 
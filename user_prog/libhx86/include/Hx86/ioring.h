@@ -0,0 +1,75 @@
+#ifndef HX86_IORING_H
+#define HX86_IORING_H
+
+#include <Hx86/Hsyscalls/syscalls.h>
+#include <Hx86/types.h>
+
+// Ring layout shared with the kernel (matches include/core/ioring.h)
+#define IORING_MAX_ENTRIES 256
+#define IORING_OP_HGUI 0x80000000
+
+#define IORING_EINVAL -22
+#define IORING_EBUSY -16
+#define IORING_ENXIO -6
+
+struct IORingHeader {
+    volatile uint32_t sqHead;  // Kernel consumes from here
+    volatile uint32_t sqTail;  // We queue here
+    volatile uint32_t cqHead;  // We reap from here
+    volatile uint32_t cqTail;  // Kernel posts here
+    uint32_t entries;
+    uint32_t reserved[3];
+} __attribute__((packed));
+
+struct IORingSQE {
+    uint32_t opcode;    // SYSCALL number, | IORING_OP_HGUI for Hgui element calls
+    uint32_t args[3];   // EBX, ECX, ESI
+    uint32_t userData;  // Handed back in the completion
+} __attribute__((packed));
+
+struct IORingCQE {
+    uint32_t userData;
+    int32_t result;
+    uint32_t extra0;
+    uint32_t extra1;
+} __attribute__((packed));
+
+/**
+ * @class IORing
+ * @brief Batch system calls: queue many, enter the kernel once.
+ *
+ * Queue calls with the Prep* helpers, then Submit() runs them all in one trap,
+ * in order. Results are reaped with Reap(). Pointers passed in a call (widget
+ * data, file buffers) must stay valid until Submit() returns.
+ */
+class IORing {
+    IORingHeader* header;
+    IORingSQE* sq;
+    IORingCQE* cq;
+    uint32_t mask;
+
+public:
+    IORing() : header(nullptr), sq(nullptr), cq(nullptr), mask(0) {}
+
+    // entries: power of two up to IORING_MAX_ENTRIES. Returns 0 or an IORING_E* code.
+    int32_t Init(uint32_t entries);
+
+    // Free slot in the submission queue, or null when it is full
+    IORingSQE* GetSQE();
+
+    bool Prep(uint32_t number, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t userData);
+    bool PrepHgui(uint32_t element, uint32_t mode, void* data, uint32_t userData);
+    bool PrepSleep(uint32_t ms, uint32_t userData);
+
+    // Enter the kernel once for everything queued. Returns SQEs consumed or IORING_E*.
+    int32_t Submit();
+
+    // Pop one completion. False when none are waiting.
+    bool Reap(IORingCQE& out);
+
+    uint32_t Pending() const {
+        return header ? header->sqTail - header->sqHead : 0;
+    }
+};
+
+#endif  // HX86_IORING_H
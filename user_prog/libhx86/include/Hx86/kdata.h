@@ -0,0 +1,54 @@
+#ifndef HX86_KDATA_H
+#define HX86_KDATA_H
+
+#include <Hx86/types.h>
+
+// Kernel data page, mapped read-only into every process (matches include/core/kdata.h)
+#define KDATA_USER_VIRT 0x40001000
+
+#define KDATA_MAGIC 0x4B444154  // "KDAT"
+#define KDATA_VERSION 1
+
+#define KDATA_NS_SHIFT 12
+
+struct KernelDataPage {
+    uint32_t magic;
+    uint32_t version;
+    volatile uint32_t sequence;  // Odd while the kernel is writing
+
+    uint64_t timerTicks;  // Milliseconds since boot
+    uint64_t tscAtTick;   // TSC read at the last tick
+
+    uint32_t tscPerMs;      // 0 until the kernel has measured it
+    uint32_t nsPerTscMult;  // ns = (cycles * nsPerTscMult) >> KDATA_NS_SHIFT
+
+    uint32_t screenWidth;
+    uint32_t screenHeight;
+    uint32_t screenBpp;
+
+    uint32_t contextSwitches;
+    uint32_t idlePermille;
+    uint32_t usedPages;
+    uint32_t totalPages;
+} __attribute__((packed));
+
+// None of these enter the kernel.
+
+// Consistent copy of the whole page
+void kdata_snapshot(KernelDataPage* out);
+
+// Milliseconds since boot
+uint64_t kdata_ticks();
+
+// Nanoseconds since boot: the tick count refined with the TSC
+uint64_t kdata_time_ns();
+
+void kdata_screen(uint32_t* width, uint32_t* height);
+
+static inline uint64_t kdata_rdtsc() {
+    uint32_t lo, hi;
+    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+#endif  // HX86_KDATA_H
@@ -0,0 +1,70 @@
+#ifndef HX86_SYNC_H
+#define HX86_SYNC_H
+
+#include <Hx86/Hsyscalls/syscalls.h>
+#include <Hx86/types.h>
+
+/**
+ * @class Mutex
+ * @brief Futex-backed mutex. Uncontended Lock/Unlock never enter the kernel.
+ *
+ * state: 0 = unlocked, 1 = locked, 2 = locked with (possible) sleepers.
+ */
+class Mutex {
+    volatile uint32_t state;
+
+public:
+    Mutex() : state(0) {}
+
+    void Lock();
+    bool TryLock();
+    void Unlock();
+};
+
+class MutexGuard {
+    Mutex& mutex;
+
+public:
+    MutexGuard(Mutex& m) : mutex(m) {
+        mutex.Lock();
+    }
+    ~MutexGuard() {
+        mutex.Unlock();
+    }
+};
+
+/**
+ * @class CondVar
+ * @brief Condition variable on a futex sequence counter.
+ *
+ * Always re-check the predicate after Wait returns; wake-ups may be spurious.
+ */
+class CondVar {
+    volatile uint32_t sequence;
+
+public:
+    CondVar() : sequence(0) {}
+
+    // Returns false if timeoutMs (0 = none) expired
+    bool Wait(Mutex& mutex, uint32_t timeoutMs = 0);
+    void Signal();
+    void Broadcast();
+};
+
+/**
+ * @class Barrier
+ * @brief Blocks until 'count' threads have called Wait, then releases them all.
+ */
+class Barrier {
+    uint32_t count;
+    volatile uint32_t arrived;
+    volatile uint32_t generation;
+
+public:
+    Barrier(uint32_t count) : count(count), arrived(0), generation(0) {}
+
+    // Returns true in exactly one thread per round (the last to arrive)
+    bool Wait();
+};
+
+#endif  // HX86_SYNC_H